@@ -0,0 +1,307 @@
+#include "allocator.h"
+#include "storage.h"
+#include "copy_engine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kAlignment = 64;
+// Larger storages get their own page-aligned mapping, so copy-on-write
+// after fork() never shares pages with unrelated heap objects
+constexpr size_t kMmapThreshold = size_t(1) << 20;
+constexpr size_t kSwapPage = 4096;
+constexpr size_t kSwapMinGrowth = size_t(64) << 20;
+
+size_t round_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+// Parses sizes such as "512M", "8G" or "1073741824"
+size_t parse_bytes(const char* text) {
+    char* end = nullptr;
+    const double value = std::strtod(text, &end);
+    if (end == text || value < 0) return 0;
+    double scale = 1.0;
+    switch (*end) {
+        case 'k': case 'K': scale = 1024.0; break;
+        case 'm': case 'M': scale = 1024.0 * 1024.0; break;
+        case 'g': case 'G': scale = 1024.0 * 1024.0 * 1024.0; break;
+        default: break;
+    }
+    return static_cast<size_t>(value * scale);
+}
+
+} // namespace
+
+// ========================================
+// Swap file: one unlinked, mmap-backed file with first-fit slots
+// ========================================
+struct TensorAllocator::SwapFile {
+    int fd = -1;
+    uint8_t* base = nullptr;
+    size_t capacity = 0;
+    std::map<size_t, size_t> free_blocks; // offset -> length
+
+    explicit SwapFile(const std::string& dir) {
+        std::string path = dir + "/tensor-swap-XXXXXX";
+        std::vector<char> buf(path.begin(), path.end());
+        buf.push_back('\0');
+        fd = ::mkstemp(buf.data());
+        if (fd < 0) throw std::runtime_error("Cannot create tensor swap file in " + dir);
+        ::unlink(buf.data()); // removed from disk when the process exits
+    }
+
+    ~SwapFile() {
+        if (base) ::munmap(base, capacity);
+        if (fd >= 0) ::close(fd);
+    }
+
+    void grow(size_t needed) {
+        const size_t new_capacity = round_up(
+            std::max({capacity * 2, capacity + needed, kSwapMinGrowth}), kSwapPage);
+        if (::ftruncate(fd, static_cast<off_t>(new_capacity)) != 0) {
+            throw std::runtime_error("Cannot grow tensor swap file.");
+        }
+        void* mapped = ::mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) throw std::runtime_error("Cannot map tensor swap file.");
+        if (base) ::munmap(base, capacity);
+        base = static_cast<uint8_t*>(mapped);
+        release(capacity, new_capacity - capacity);
+        capacity = new_capacity;
+    }
+
+    size_t acquire(size_t nbytes) {
+        const size_t len = round_up(std::max<size_t>(nbytes, 1), kSwapPage);
+        for (;;) {
+            for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it) {
+                if (it->second < len) continue;
+                const size_t offset = it->first;
+                const size_t rest = it->second - len;
+                free_blocks.erase(it);
+                if (rest > 0) free_blocks.emplace(offset + len, rest);
+                return offset;
+            }
+            grow(len);
+        }
+    }
+
+    void release(size_t offset, size_t nbytes) {
+        size_t len = round_up(std::max<size_t>(nbytes, 1), kSwapPage);
+        if (base && offset < capacity) {
+            // Drop the file pages so page cache does not hold dead slots
+            ::madvise(base + offset, len, MADV_REMOVE);
+        }
+        auto next = free_blocks.lower_bound(offset);
+        if (next != free_blocks.end() && offset + len == next->first) {
+            len += next->second;
+            next = free_blocks.erase(next);
+        }
+        if (next != free_blocks.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += len;
+                return;
+            }
+        }
+        free_blocks.emplace(offset, len);
+    }
+};
+
+// ========================================
+// Construction
+// ========================================
+TensorAllocator& TensorAllocator::instance() {
+    static TensorAllocator allocator;
+    return allocator;
+}
+
+TensorAllocator::TensorAllocator() {
+    if (const char* limit = std::getenv("TENSOR_MEMORY_LIMIT")) {
+        limit_.store(parse_bytes(limit));
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    swap_dir_ = (tmp && *tmp) ? tmp : "/tmp";
+}
+
+TensorAllocator::~TensorAllocator() {
+    delete swap_;
+}
+
+// ========================================
+// Allocation
+// ========================================
+void* TensorAllocator::allocate(size_t nbytes) {
+    clock_.fetch_add(1, std::memory_order_relaxed);
+
+    // Make room first so usage never peaks above the limit needlessly
+    const size_t limit = limit_.load();
+    if (limit > 0 && allocated_.load() + nbytes > limit) {
+        const size_t target = static_cast<size_t>(static_cast<double>(limit) * low_watermark_.load());
+        spill_until(target > nbytes ? target - nbytes : 0, nullptr);
+    }
+    return allocate_resident(nbytes);
+}
+
+void* TensorAllocator::allocate_resident(size_t nbytes) {
+    void* ptr = nullptr;
+    if (nbytes >= kMmapThreshold) {
+        ptr = ::mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) throw std::bad_alloc();
+    } else {
+        ptr = ::operator new(std::max<size_t>(nbytes, 1), std::align_val_t(kAlignment));
+    }
+    const size_t now = allocated_.fetch_add(nbytes) + nbytes;
+    size_t peak = peak_.load();
+    while (now > peak && !peak_.compare_exchange_weak(peak, now)) {}
+    return ptr;
+}
+
+void TensorAllocator::deallocate(void* ptr, size_t nbytes) {
+    if (!ptr) return;
+    if (nbytes >= kMmapThreshold) {
+        ::munmap(ptr, nbytes);
+    } else {
+        ::operator delete(ptr, std::align_val_t(kAlignment));
+    }
+    allocated_.fetch_sub(nbytes);
+}
+
+// ========================================
+// Limit configuration
+// ========================================
+void TensorAllocator::set_memory_limit(size_t bytes) {
+    limit_.store(bytes);
+    enforce_limit(nullptr);
+}
+
+void TensorAllocator::set_low_watermark(double fraction) {
+    if (fraction <= 0.0 || fraction > 1.0) {
+        throw std::invalid_argument("Low watermark must be in (0, 1].");
+    }
+    low_watermark_.store(fraction);
+}
+
+void TensorAllocator::set_swap_directory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    swap_dir_ = dir;
+}
+
+void TensorAllocator::enforce_limit(const Storage* keep) {
+    const size_t limit = limit_.load();
+    if (limit == 0 || allocated_.load() <= limit) return;
+    spill_until(static_cast<size_t>(static_cast<double>(limit) * low_watermark_.load()), keep);
+}
+
+// ========================================
+// Spilling
+// ========================================
+void TensorAllocator::register_spillable(Storage* s) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    spillable_.insert(s);
+}
+
+void TensorAllocator::unregister_spillable(Storage* s) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    spillable_.erase(s);
+}
+
+size_t TensorAllocator::spill(size_t bytes) {
+    const size_t current = allocated_.load();
+    return spill_until(current > bytes ? current - bytes : 0, nullptr);
+}
+
+size_t TensorAllocator::spill_until(size_t target, const Storage* keep) {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+
+    std::vector<std::pair<uint64_t, Storage*>> candidates;
+    candidates.reserve(spillable_.size());
+    for (Storage* s : spillable_) {
+        if (s != keep && s->is_resident() && !s->pinned()) {
+            candidates.emplace_back(s->last_access(), s);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    size_t released = 0;
+    for (const auto& c : candidates) {
+        if (allocated_.load() <= target) break;
+        const size_t n = c.second->try_spill();
+        if (n == 0) continue;
+        released += n;
+        spill_count_.fetch_add(1);
+        spill_bytes_.fetch_add(n);
+    }
+    return released;
+}
+
+int64_t TensorAllocator::swap_write(const void* src, size_t nbytes) {
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    if (!swap_) swap_ = new SwapFile(swap_dir_);
+    const size_t offset = swap_->acquire(nbytes);
+    tensor_copy(swap_->base + offset, src, nbytes);
+    swapped_.fetch_add(nbytes);
+    return static_cast<int64_t>(offset);
+}
+
+void TensorAllocator::swap_read(int64_t offset, void* dst, size_t nbytes) {
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    tensor_copy(dst, swap_->base + offset, nbytes);
+}
+
+void TensorAllocator::swap_release(int64_t offset, size_t nbytes) {
+    if (offset < 0) return;
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    swap_->release(static_cast<size_t>(offset), nbytes);
+    swapped_.fetch_sub(nbytes);
+}
+
+void TensorAllocator::note_page_in(size_t nbytes) {
+    page_in_count_.fetch_add(1);
+    page_in_bytes_.fetch_add(nbytes);
+}
+
+void TensorAllocator::note_compressed(size_t raw, size_t packed) {
+    compressed_.fetch_add(packed);
+    compressed_raw_.fetch_add(raw);
+    compress_count_.fetch_add(1);
+}
+
+void TensorAllocator::note_decompressed(size_t raw, size_t packed, bool restored) {
+    compressed_.fetch_sub(packed);
+    compressed_raw_.fetch_sub(raw);
+    if (restored) decompress_count_.fetch_add(1);
+}
+
+MemoryStats TensorAllocator::stats() const {
+    MemoryStats s;
+    s.allocated_bytes = allocated_.load();
+    s.peak_bytes = peak_.load();
+    s.limit_bytes = limit_.load();
+    s.swapped_bytes = swapped_.load();
+    s.spill_count = spill_count_.load();
+    s.spill_bytes = spill_bytes_.load();
+    s.page_in_count = page_in_count_.load();
+    s.page_in_bytes = page_in_bytes_.load();
+    s.compressed_bytes = compressed_.load();
+    s.compressed_raw_bytes = compressed_raw_.load();
+    s.compress_count = compress_count_.load();
+    s.decompress_count = decompress_count_.load();
+    return s;
+}
+
+void set_memory_limit(size_t bytes) {
+    TensorAllocator::instance().set_memory_limit(bytes);
+}
+
+MemoryStats memory_stats() {
+    return TensorAllocator::instance().stats();
+}
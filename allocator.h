@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+class Storage;
+
+// =============================
+// Memory Statistics
+// =============================
+
+struct MemoryStats {
+    size_t allocated_bytes = 0;    // resident tensor storage
+    size_t peak_bytes = 0;
+    size_t limit_bytes = 0;        // soft limit (0 = unlimited)
+    size_t swapped_bytes = 0;      // storage currently held in the swap file
+    size_t spill_count = 0;        // storages written out
+    size_t spill_bytes = 0;        // total bytes written out
+    size_t page_in_count = 0;      // storages read back
+    size_t page_in_bytes = 0;      // total bytes read back
+    size_t compressed_bytes = 0;   // in-memory size of compressed storages
+    size_t compressed_raw_bytes = 0; // their uncompressed size
+    size_t compress_count = 0;
+    size_t decompress_count = 0;
+};
+
+// =============================
+// Tensor Allocator
+// =============================
+
+// Process-wide allocator behind every CPU Storage. It tracks resident bytes
+// against an optional soft limit; when an allocation pushes usage over the
+// limit, the least recently used spill-eligible storages are written to an
+// mmap-backed swap file and their memory is released until usage drops
+// below the low watermark. Spilled storages are paged back on next access.
+class TensorAllocator {
+public:
+    static TensorAllocator& instance();
+
+    // Raw 64-byte aligned allocation; may spill other storages afterwards
+    void* allocate(size_t nbytes);
+    void deallocate(void* ptr, size_t nbytes);
+
+    // Soft limit in bytes (0 disables spilling). The TENSOR_MEMORY_LIMIT
+    // environment variable provides the initial value.
+    void set_memory_limit(size_t bytes);
+    size_t memory_limit() const { return limit_.load(); }
+
+    // Fraction of the limit that spilling brings usage back down to
+    void set_low_watermark(double fraction);
+
+    // Directory for the swap file (default: $TMPDIR or /tmp)
+    void set_swap_directory(const std::string& dir);
+
+    // Spills cold storages until at least `bytes` have been released
+    size_t spill(size_t bytes);
+
+    MemoryStats stats() const;
+
+    // Coarse access clock used for LRU ordering
+    uint64_t now() const { return clock_.load(std::memory_order_relaxed); }
+
+private:
+    friend class Storage;
+
+    TensorAllocator();
+    ~TensorAllocator();
+
+    // Allocation that never spills. Used to page a storage back in: the
+    // caller may be holding raw pointers into other storages (the other
+    // inputs of an op), so eviction waits for the next ordinary allocation.
+    void* allocate_resident(size_t nbytes);
+
+    void register_spillable(Storage* s);
+    void unregister_spillable(Storage* s);
+
+    // Spills until resident bytes <= target; never touches `keep`
+    size_t spill_until(size_t target, const Storage* keep);
+    void enforce_limit(const Storage* keep);
+
+    // Swap file slots
+    int64_t swap_write(const void* src, size_t nbytes);
+    void swap_read(int64_t offset, void* dst, size_t nbytes);
+    void swap_release(int64_t offset, size_t nbytes);
+
+    void note_page_in(size_t nbytes);
+    void note_compressed(size_t raw, size_t packed);
+    void note_decompressed(size_t raw, size_t packed, bool restored);
+
+    std::atomic<size_t> allocated_{0};
+    std::atomic<size_t> peak_{0};
+    std::atomic<size_t> limit_{0};
+    std::atomic<double> low_watermark_{0.9};
+    std::atomic<uint64_t> clock_{0};
+
+    std::atomic<size_t> swapped_{0};
+    std::atomic<size_t> spill_count_{0};
+    std::atomic<size_t> spill_bytes_{0};
+    std::atomic<size_t> page_in_count_{0};
+    std::atomic<size_t> page_in_bytes_{0};
+    std::atomic<size_t> compressed_{0};
+    std::atomic<size_t> compressed_raw_{0};
+    std::atomic<size_t> compress_count_{0};
+    std::atomic<size_t> decompress_count_{0};
+
+    // Spill-eligible storages; held while spilling so none is destroyed mid-way
+    std::mutex registry_mutex_;
+    std::unordered_set<Storage*> spillable_;
+
+    struct SwapFile;
+    std::mutex swap_mutex_;
+    SwapFile* swap_ = nullptr;
+    std::string swap_dir_;
+};
+
+// Convenience wrappers around TensorAllocator::instance()
+void set_memory_limit(size_t bytes);
+MemoryStats memory_stats();
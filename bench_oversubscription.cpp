@@ -0,0 +1,68 @@
+#include "parallel.h"
+#include "thread_budget.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Runs kernels that call into OpenMP from inside parallel_for (as a BLAS
+// call inside one of our kernels would), from several caller threads at
+// once. Both runs use the default thread budget. The first leaves OpenMP at
+// its defaults, so every pool thread fans out into a full OpenMP team; the
+// second serializes nested runtimes, which is the library default.
+//
+// Needs OpenMP, which the library itself does not: build it with -fopenmp,
+// e.g. g++ -O2 -fopenmp bench_oversubscription.cpp <library sources>.
+// Without it the kernel below is serial and there is nothing to measure.
+
+namespace {
+
+// Stand-in for a multithreaded BLAS call
+float external_kernel(const std::vector<float>& x) {
+    float sum = 0.0f;
+#pragma omp parallel for reduction(+ : sum)
+    for (int64_t i = 0; i < static_cast<int64_t>(x.size()); ++i) sum += std::sqrt(x[i]);
+    return sum;
+}
+
+double run(int callers, int items) {
+    std::vector<float> x(size_t(1) << 16, 2.0f);
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < callers; ++c) {
+        threads.emplace_back([&] {
+            parallel_for(0, items, 1, [&](int64_t b, int64_t e) {
+                volatile float sink = 0.0f;
+                for (int64_t i = b; i < e; ++i) sink = sink + external_kernel(x);
+            });
+        });
+    }
+    for (auto& t : threads) t.join();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main() {
+    const ExternalRuntimes& rt = external_runtimes();
+    const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "openmp " << rt.openmp << ", openblas " << rt.openblas << ", mkl " << rt.mkl
+              << ", hardware threads " << hw << "\n";
+
+#ifndef _OPENMP
+    std::cerr << "built without OpenMP; rebuild with -fopenmp\n";
+    return 1;
+#endif
+
+    const int callers = 4, items = 64;
+    std::cout << "thread budget " << thread_budget() << "\n";
+    set_serialize_nested_runtimes(false);
+    const double nested = run(callers, items);
+
+    set_serialize_nested_runtimes(true);
+    const double serialized = run(callers, items);
+
+    std::cout << "openmp defaults ms\tserialized ms\n" << nested << "\t" << serialized << "\n";
+    return 0;
+}
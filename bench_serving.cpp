@@ -0,0 +1,175 @@
+#include "model_runtime.h"
+#include "test_util.h"
+#include "thread_budget.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Serves a small MLP (the shape of a ranking or embedding head) and a small
+// pooled CNN, each saved with save_graph. It compares run_graph, which
+// allocates every intermediate, against ModelRuntime, which maps the weights
+// and plans all activations at load. It reports latency, planned memory and
+// heap allocations per request, and exits non-zero if the runtime allocates
+// while serving, so it can guard the allocation-free path in CI. It runs on
+// at least two pool threads so that path includes dispatch.
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+Graph mlp(int layers, int32_t width, std::mt19937& rng) {
+    Graph g;
+    ValueId h = g.input("x");
+    for (int l = 0; l < layers; ++l) {
+        const std::string name = "layer" + std::to_string(l);
+        h = g.linear(h, g.constant(name + ".w", random_tensor({width, width}, rng)),
+                     g.constant(name + ".b", random_tensor({width}, rng)));
+        h = g.relu(random_batch_norm(g, h, name, width, rng));
+    }
+    g.output("y", h);
+    return g;
+}
+
+// Two conv blocks, one ending in max pooling and one in avg pooling, and
+// a classifier: the image path, with pools sized at load
+Graph cnn(int32_t image, std::mt19937& rng) {
+    Graph g;
+    ValueId h = g.input("x");
+    int32_t channels = 3, size = image;
+    for (int b = 0; b < 2; ++b) {
+        const std::string name = "block" + std::to_string(b);
+        const int32_t out = channels == 3 ? 16 : 2 * channels;
+        h = g.conv2d(h, g.constant(name + ".w", random_tensor({out, channels, 3, 3}, rng)),
+                     g.constant(name + ".b", random_tensor({out}, rng)), 1, 1);
+        h = g.relu(random_batch_norm(g, h, name, out, rng));
+        Pool2dParams pool;
+        pool.kernel_h = pool.kernel_w = 2;
+        h = b == 0 ? g.max_pool2d(h, pool) : g.avg_pool2d(h, pool);
+        channels = out;
+        size /= 2;
+    }
+    const int32_t features = channels * size * size;
+    h = g.reshape(h, {-1, features});
+    g.output("y", g.linear(h, g.constant("fc.w", random_tensor({10, features}, rng)),
+                           g.constant("fc.b", random_tensor({10}, rng))));
+    return g;
+}
+
+struct Result {
+    double median_us = 0.0;
+    double allocations = 0.0;
+};
+
+template <typename F>
+Result measure(int runs, F&& fn) {
+    std::vector<double> times;
+    times.reserve(static_cast<size_t>(runs));
+    const size_t before = g_allocations.load();
+    for (int i = 0; i < runs; ++i) {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+    Result r;
+    r.allocations = static_cast<double>(g_allocations.load() - before) / runs;
+    std::sort(times.begin(), times.end());
+    r.median_us = times[times.size() / 2];
+    return r;
+}
+
+} // namespace
+
+// Counting replacements of every global allocation function, so no form
+// is left to a sanitizer's allocator while its delete comes here. GCC
+// cannot tell that the pairs match once std::allocator is inlined.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace {
+
+void* counted_alloc(size_t n, size_t alignment = 0) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (n == 0) n = 1;
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(n);
+    void* p = nullptr;
+    return ::posix_memalign(&p, alignment, n) == 0 ? p : nullptr;
+}
+
+void* counted_alloc_or_throw(size_t n, size_t alignment = 0) {
+    if (void* p = counted_alloc(n, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t n) { return counted_alloc_or_throw(n); }
+void* operator new[](size_t n) { return counted_alloc_or_throw(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept { return counted_alloc(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { return counted_alloc(n); }
+void* operator new(size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, static_cast<size_t>(a)); }
+void* operator new[](size_t n, std::align_val_t a) { return counted_alloc_or_throw(n, static_cast<size_t>(a)); }
+void* operator new(size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return counted_alloc(n, static_cast<size_t>(a));
+}
+void* operator new[](size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return counted_alloc(n, static_cast<size_t>(a));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+// Saves `graph`, loads it into a runtime for `x` and prints one row per
+// executor. Returns the runtime's allocations per request.
+double serve(const std::string& label, const Graph& graph, const std::string& path,
+             const Tensor& x, int runs) {
+    save_graph(graph, path);
+    const std::map<std::string, Tensor> inputs = {{"x", x}};
+    ModelRuntime runtime(path, {{"x", Shape(x.shape())}});
+    Tensor& slot = runtime.input("x");
+    std::copy(x.data<float>(), x.data<float>() + x.numel(), slot.data<float>());
+
+    const Result reference = measure(runs, [&] { run_graph(graph, inputs); });
+    const Result served = measure(runs, [&] { runtime.run(); });
+    const ModelRuntime::Stats s = runtime.stats();
+    std::cout << label << ": arena " << s.arena_bytes << " B (unplanned " << s.unplanned_bytes
+              << " B), weights " << s.weight_bytes << " B, " << s.steps << " kernels, " << s.in_place
+              << " in place\n";
+    std::cout << "\tmedian us\tallocs/request\n"
+              << "run_graph\t" << reference.median_us << "\t" << reference.allocations << "\n"
+              << "runtime\t" << served.median_us << "\t" << served.allocations << "\n";
+    return served.allocations;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "/tmp/bench_serving.model";
+    const int runs = 200;
+    const int32_t batch = 4, width = 256, image = 32;
+    // Requests must fan out over the pool, or the guard below would miss
+    // the dispatch path
+    set_thread_budget(std::max<size_t>(2, thread_budget()));
+    std::mt19937 rng(11);
+    const Graph head = mlp(6, width, rng);
+    const Graph image_model = cnn(image, rng);
+
+    double allocations = serve("mlp", head, path, random_tensor({batch, width}, rng), runs);
+    allocations += serve("cnn", image_model, path, random_tensor({batch, 3, image, image}, rng), runs);
+    return allocations == 0.0 ? 0 : 1;
+}
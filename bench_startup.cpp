@@ -0,0 +1,94 @@
+#include "tensor.h"
+#include "warmup.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Measures the cost of starting a short-lived process that does one small
+// tensor op, with and without warmup(). Exits non-zero when the lazy
+// start spawns threads or its median exceeds --max-ms, so it can guard
+// start-up time in CI.
+
+namespace {
+
+int thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) return std::atoi(line.c_str() + 8);
+    }
+    return -1;
+}
+
+// Child body: one small op, then report the thread count as the exit code
+int child(bool warm) {
+    if (warm) warmup();
+    Tensor t(Shape({64}), Dtype::Float32);
+    std::fill(t.data<float>(), t.data<float>() + 64, 1.0f);
+    Tensor c = t.clone();
+    if (c.data<float>()[63] != 1.0f) return 0;
+    return std::min(thread_count(), 255);
+}
+
+struct Result {
+    double median_ms = 0.0;
+    int threads = 0;
+};
+
+Result spawn(const char* mode, int runs) {
+    std::vector<double> times;
+    Result r;
+    for (int i = 0; i < runs; ++i) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::execl("/proc/self/exe", "bench_startup", mode, static_cast<char*>(nullptr));
+            ::_exit(255);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        const auto t1 = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        r.threads = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+    std::sort(times.begin(), times.end());
+    r.median_ms = times[times.size() / 2];
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--child") == 0) return child(false);
+    if (argc > 1 && std::strcmp(argv[1], "--child-warm") == 0) return child(true);
+
+    double max_ms = 0.0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-ms") == 0) max_ms = std::atof(argv[i + 1]);
+    }
+
+    const int runs = 30;
+    const Result lazy = spawn("--child", runs);
+    const Result warm = spawn("--child-warm", runs);
+    std::cout << "mode\tmedian ms\tthreads\n";
+    std::cout << "lazy\t" << lazy.median_ms << "\t" << lazy.threads << "\n";
+    std::cout << "warmup\t" << warm.median_ms << "\t" << warm.threads << "\n";
+
+    int rc = 0;
+    if (lazy.threads != 1) {
+        std::cout << "FAIL: a single small op started " << lazy.threads << " threads\n";
+        rc = 1;
+    }
+    if (max_ms > 0.0 && lazy.median_ms > max_ms) {
+        std::cout << "FAIL: start-up median " << lazy.median_ms << " ms exceeds " << max_ms << " ms\n";
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,64 @@
+#include "cancellation.h"
+
+namespace {
+
+thread_local std::shared_ptr<const CancellationScope::Chain> tls_chain;
+
+} // namespace
+
+// ========================================
+// CancellationToken
+// ========================================
+CancellationToken::CancellationToken() : state_(std::make_shared<State>()) {}
+
+CancellationToken CancellationToken::with_deadline(Clock::time_point deadline) {
+    CancellationToken token;
+    token.state_->deadline = deadline;
+    return token;
+}
+
+CancellationToken CancellationToken::with_timeout(Clock::duration timeout) {
+    return with_deadline(Clock::now() + timeout);
+}
+
+bool CancellationToken::is_cancelled() const {
+    if (state_->cancelled.load(std::memory_order_relaxed)) return true;
+    if (state_->deadline != Clock::time_point::max() && Clock::now() >= state_->deadline) {
+        state_->cancelled.store(true, std::memory_order_relaxed); // skip the clock next time
+        return true;
+    }
+    return false;
+}
+
+// ========================================
+// CancellationScope
+// ========================================
+CancellationScope::CancellationScope(CancellationToken token) : previous_(tls_chain) {
+    tls_chain = std::make_shared<const Chain>(Chain{std::move(token), previous_});
+}
+
+CancellationScope::CancellationScope(std::shared_ptr<const Chain> chain) : previous_(tls_chain) {
+    tls_chain = std::move(chain);
+}
+
+CancellationScope::~CancellationScope() {
+    tls_chain = std::move(previous_);
+}
+
+std::shared_ptr<const CancellationScope::Chain> CancellationScope::current() {
+    return tls_chain;
+}
+
+// ========================================
+// Checks
+// ========================================
+bool cancellation_requested() {
+    for (const CancellationScope::Chain* c = tls_chain.get(); c; c = c->outer.get()) {
+        if (c->token.is_cancelled()) return true;
+    }
+    return false;
+}
+
+void throw_if_cancelled() {
+    if (cancellation_requested()) throw OperationCancelled("Operation cancelled or past its deadline.");
+}
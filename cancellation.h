@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+// =============================
+// Cancellation and Deadlines
+// =============================
+
+// Thrown by kernels that stop early because their scope was cancelled
+// or ran past its deadline
+class OperationCancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Shared cancellation flag with an optional deadline. Copies refer to the
+// same state, so a request handler can keep one copy and cancel() the op
+// running under another.
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Never expires unless cancelled
+    CancellationToken();
+
+    static CancellationToken with_deadline(Clock::time_point deadline);
+    static CancellationToken with_timeout(Clock::duration timeout);
+
+    void cancel() const { state_->cancelled.store(true, std::memory_order_relaxed); }
+
+    // True once cancelled or past the deadline
+    bool is_cancelled() const;
+
+    Clock::time_point deadline() const { return state_->deadline; }
+
+private:
+    struct State {
+        std::atomic<bool> cancelled{false};
+        Clock::time_point deadline = Clock::time_point::max();
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+// Attaches a token to the calling thread for the lifetime of the scope.
+// parallel_for hands the active tokens to the threads running its chunks
+// and checks them between chunks; an expired token makes the loop throw
+// OperationCancelled, unwinding the kernel's ScratchScopes. Scopes nest:
+// work stops when any enclosing token is cancelled.
+class CancellationScope {
+public:
+    explicit CancellationScope(CancellationToken token);
+    ~CancellationScope();
+
+    CancellationScope(const CancellationScope&) = delete;
+    CancellationScope& operator=(const CancellationScope&) = delete;
+
+    // Chain of tokens active on a thread, innermost first
+    struct Chain {
+        CancellationToken token;
+        std::shared_ptr<const Chain> outer;
+    };
+
+    // Active chain of the calling thread (null when none)
+    static std::shared_ptr<const Chain> current();
+
+    // Installs `chain` on the calling thread (used to carry a caller's
+    // tokens onto worker threads)
+    explicit CancellationScope(std::shared_ptr<const Chain> chain);
+
+private:
+    std::shared_ptr<const Chain> previous_;
+};
+
+// True when any token active on the calling thread has expired
+bool cancellation_requested();
+
+// Throws OperationCancelled when cancellation_requested(); for long
+// kernels to call at natural block boundaries
+void throw_if_cancelled();
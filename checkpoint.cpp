@@ -0,0 +1,252 @@
+#include "checkpoint.h"
+#include "tensor_hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const char kMagic[8] = {'T', 'C', 'K', 'P', 'T', '0', '0', '1'};
+
+// ========================================
+// Helper: binary encoding
+// ========================================
+template <typename T>
+void put(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void put_string(std::ostream& out, const std::string& s) {
+    put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+template <typename T>
+T get(std::istream& in) {
+    T value;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Truncated checkpoint file.");
+    }
+    return value;
+}
+
+std::string get_string(std::istream& in) {
+    const uint32_t n = get<uint32_t>(in);
+    std::string s(n, '\0');
+    if (n && !in.read(&s[0], n)) throw std::runtime_error("Truncated checkpoint file.");
+    return s;
+}
+
+std::string directory_of(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+std::string file_of(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+CheckpointWriter::CheckpointWriter(std::string directory, size_t chunk_bytes)
+    : directory_(std::move(directory)), chunk_bytes_(chunk_bytes)
+{
+    if (chunk_bytes_ == 0) throw std::invalid_argument("Checkpoint chunk size must be positive.");
+}
+
+// ========================================
+// Writing
+// ========================================
+CheckpointStats CheckpointWriter::write(const std::string& name,
+                                        const std::map<std::string, Tensor>& tensors) {
+    const std::string file = name + ".ckpt";
+    const std::string path = directory_ + "/" + file;
+    auto referrers = referrers_.find(file);
+    if (referrers != referrers_.end()) {
+        for (const std::string& other : referrers->second) {
+            if (std::ifstream(directory_ + "/" + other)) {
+                throw std::runtime_error("Cannot rewrite checkpoint " + file + ": " + other + " refers to it.");
+            }
+        }
+    }
+
+    // Written aside and renamed over the old file, so readers never see a
+    // partial checkpoint
+    const std::string staging = path + ".tmp";
+    std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot open checkpoint file " + staging);
+    out.write(kMagic, sizeof(kMagic));
+
+    CheckpointStats stats;
+    std::map<std::string, TensorRecord> current;
+
+    // Chunks in the file being replaced, or in one deleted since, must be
+    // written again
+    std::map<std::string, bool> present;
+    auto reusable = [&](const ChunkRef& c) {
+        if (c.file == file) return false;
+        auto it = present.find(c.file);
+        if (it == present.end()) {
+            it = present.emplace(c.file, static_cast<bool>(std::ifstream(directory_ + "/" + c.file))).first;
+        }
+        return it->second;
+    };
+
+    for (const auto& kv : tensors) {
+        const Tensor& t = kv.second;
+        if (!t.storage()) throw std::invalid_argument("Cannot checkpoint empty tensor " + kv.first);
+        if (!t.is_contiguous()) {
+            throw std::invalid_argument("Cannot checkpoint non-contiguous tensor " + kv.first);
+        }
+        ++stats.tensors;
+
+        TensorRecord rec;
+        rec.storage = t.storage();
+        rec.version = t.storage()->version();
+        rec.dtype = t.dtype();
+        rec.shape = t.shape();
+
+        auto prev_it = previous_.find(kv.first);
+        const TensorRecord* prev = prev_it != previous_.end() ? &prev_it->second : nullptr;
+        const bool same_layout = prev && prev->dtype == rec.dtype && prev->shape == rec.shape;
+
+        // Same storage, same version: nothing can have changed, unless the
+        // bytes can be written without bumping the version
+        const bool tracked = !t.storage()->is_external() && !t.storage()->has_untracked_writers();
+        if (tracked && same_layout && prev->storage.lock() == t.storage() && prev->version == rec.version &&
+            std::all_of(prev->chunks.begin(), prev->chunks.end(), reusable)) {
+            rec.chunks = prev->chunks;
+            ++stats.tensors_unchanged;
+            stats.chunks_referenced += rec.chunks.size();
+            for (const auto& c : rec.chunks) stats.bytes_referenced += c.length;
+            current.emplace(kv.first, std::move(rec));
+            continue;
+        }
+
+        // Const access: reading for a checkpoint must not bump the version
+        const StoragePin keep = t.pin();
+        const uint8_t* bytes = t.data<uint8_t>();
+        const size_t total = t.nbytes();
+        for (size_t off = 0, i = 0; off < total; off += chunk_bytes_, ++i) {
+            const size_t len = std::min(chunk_bytes_, total - off);
+            const uint64_t h = hash_bytes(bytes + off, len);
+            if (same_layout && i < prev->chunks.size() && prev->chunks[i].hash == h &&
+                prev->chunks[i].length == len && reusable(prev->chunks[i])) {
+                rec.chunks.push_back(prev->chunks[i]);
+                ++stats.chunks_referenced;
+                stats.bytes_referenced += len;
+                continue;
+            }
+            ChunkRef c;
+            c.file = file;
+            c.offset = static_cast<uint64_t>(out.tellp());
+            c.length = len;
+            c.hash = h;
+            out.write(reinterpret_cast<const char*>(bytes + off), static_cast<std::streamsize>(len));
+            rec.chunks.push_back(c);
+            ++stats.chunks_written;
+            stats.bytes_written += len;
+        }
+        current.emplace(kv.first, std::move(rec));
+    }
+
+    // Manifest
+    const uint64_t manifest_offset = static_cast<uint64_t>(out.tellp());
+    put<uint32_t>(out, static_cast<uint32_t>(current.size()));
+    for (const auto& kv : current) {
+        const TensorRecord& rec = kv.second;
+        put_string(out, kv.first);
+        put<uint8_t>(out, static_cast<uint8_t>(rec.dtype));
+        put<uint32_t>(out, static_cast<uint32_t>(rec.shape.size()));
+        for (int32_t d : rec.shape) put<int32_t>(out, d);
+        put<uint32_t>(out, static_cast<uint32_t>(rec.chunks.size()));
+        for (const auto& c : rec.chunks) {
+            // Empty name means "this file", so checkpoints can be renamed
+            put_string(out, c.file == file ? std::string() : c.file);
+            put<uint64_t>(out, c.offset);
+            put<uint64_t>(out, c.length);
+            put<uint64_t>(out, c.hash);
+        }
+    }
+    put<uint64_t>(out, manifest_offset);
+    out.write(kMagic, sizeof(kMagic));
+    out.close();
+    if (!out || std::rename(staging.c_str(), path.c_str()) != 0) {
+        std::remove(staging.c_str());
+        throw std::runtime_error("Failed writing checkpoint file " + path);
+    }
+
+    // The old file's references are gone with it
+    for (auto& kv : referrers_) kv.second.erase(file);
+    for (const auto& kv : current) {
+        for (const auto& c : kv.second.chunks) {
+            if (c.file != file) referrers_[c.file].insert(file);
+        }
+    }
+    previous_ = std::move(current);
+    return stats;
+}
+
+// ========================================
+// Loading
+// ========================================
+std::map<std::string, Tensor> load_checkpoint(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open checkpoint file " + path);
+
+    char magic[sizeof(kMagic)];
+    in.seekg(-static_cast<std::streamoff>(sizeof(kMagic) + sizeof(uint64_t)), std::ios::end);
+    const uint64_t manifest_offset = get<uint64_t>(in);
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    in.seekg(static_cast<std::streamoff>(manifest_offset));
+
+    const std::string dir = directory_of(path);
+    const std::string self = file_of(path);
+    std::map<std::string, std::ifstream> others;
+
+    std::map<std::string, Tensor> tensors;
+    const uint32_t count = get<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        const std::string name = get_string(in);
+        const auto dtype = static_cast<Dtype>(get<uint8_t>(in));
+        std::vector<int32_t> shape(get<uint32_t>(in));
+        for (auto& d : shape) d = get<int32_t>(in);
+
+        Tensor t(Shape(shape), dtype);
+        uint8_t* dst = t.data<uint8_t>();
+        size_t filled = 0;
+
+        const uint32_t chunks = get<uint32_t>(in);
+        for (uint32_t k = 0; k < chunks; ++k) {
+            std::string file = get_string(in);
+            const uint64_t offset = get<uint64_t>(in);
+            const uint64_t length = get<uint64_t>(in);
+            get<uint64_t>(in); // hash, only needed by writers
+            if (filled + length > t.nbytes()) throw std::runtime_error("Corrupt checkpoint manifest.");
+
+            std::ifstream* src = &in;
+            if (!file.empty() && file != self) {
+                auto it = others.find(file);
+                if (it == others.end()) {
+                    it = others.emplace(file, std::ifstream(dir + "/" + file, std::ios::binary)).first;
+                    if (!it->second) throw std::runtime_error("Missing referenced checkpoint " + file);
+                }
+                src = &it->second;
+            }
+            const std::streampos resume = in.tellg();
+            src->seekg(static_cast<std::streamoff>(offset));
+            if (!src->read(reinterpret_cast<char*>(dst + filled), static_cast<std::streamsize>(length))) {
+                throw std::runtime_error("Truncated checkpoint data.");
+            }
+            if (src == &in) in.seekg(resume);
+            filled += length;
+        }
+        if (filled != t.nbytes()) throw std::runtime_error("Corrupt checkpoint manifest.");
+        tensors.emplace(name, std::move(t));
+    }
+    return tensors;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "tensor.h"
+#include <map>
+#include <set>
+#include <string>
+
+// =============================
+// Incremental Checkpoints
+// =============================
+
+struct CheckpointStats {
+    size_t tensors = 0;
+    size_t tensors_unchanged = 0;  // skipped via storage version
+    size_t chunks_written = 0;
+    size_t chunks_referenced = 0;  // unchanged chunks pointing at older files
+    size_t bytes_written = 0;
+    size_t bytes_referenced = 0;
+};
+
+// Writes a series of checkpoints into one directory, each storing only what
+// changed since the previous one. A tensor whose storage version is
+// unchanged is not even read; otherwise it is split into fixed-size chunks
+// whose hashes are compared with the previous checkpoint, and only changed
+// chunks are written. Unchanged chunks are recorded as references to the
+// file that physically holds them, so loading never follows more than one
+// hop and old checkpoint files must be kept while newer ones refer to them.
+//
+// Each file is written under a temporary name and renamed into place, so a
+// name can be rewritten (e.g. "latest"): chunks the new file would have
+// referenced in its own previous version, or in a file deleted since, are
+// written again instead. A name
+// that another checkpoint from this writer still refers to cannot be
+// rewritten until that checkpoint is deleted.
+//
+// Unchanged tensors are detected by storage version, which advances when a
+// mutable data() pointer is taken, not on each store through it. Take the
+// pointer again after a checkpoint before writing through it. Tensors over
+// external memory (from_blob) or with a live writable Python buffer are
+// always hashed, since their owners write without the library seeing it.
+//
+// File layout: "TCKPT001" | chunk bytes ... | manifest | manifest offset (u64) | "TCKPT001"
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::string directory, size_t chunk_bytes = size_t(4) << 20);
+
+    // Writes <directory>/<name>.ckpt, replacing any previous file of that
+    // name. Throws std::runtime_error if a checkpoint written earlier by this
+    // writer still refers to that file.
+    CheckpointStats write(const std::string& name, const std::map<std::string, Tensor>& tensors);
+
+    // Forgets history, so the next checkpoint is written in full
+    void reset() { previous_.clear(); }
+
+private:
+    struct ChunkRef {
+        std::string file;   // file name inside the directory
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        uint64_t hash = 0;
+    };
+
+    struct TensorRecord {
+        std::weak_ptr<Storage> storage;
+        uint64_t version = 0;
+        Dtype dtype = Dtype::Float32;
+        std::vector<int32_t> shape;
+        std::vector<ChunkRef> chunks;
+    };
+
+    std::string directory_;
+    size_t chunk_bytes_;
+    std::map<std::string, TensorRecord> previous_;
+    // File name -> files written by this writer that refer into it
+    std::map<std::string, std::set<std::string>> referrers_;
+};
+
+// Reads a checkpoint written by CheckpointWriter, resolving chunk
+// references against files in the same directory
+std::map<std::string, Tensor> load_checkpoint(const std::string& path);
@@ -0,0 +1,102 @@
+#include "cold_storage.h"
+#include <algorithm>
+
+ColdTensorManager& ColdTensorManager::instance() {
+    static ColdTensorManager manager;
+    return manager;
+}
+
+ColdTensorManager::~ColdTensorManager() {
+    stop();
+}
+
+// ========================================
+// Tracking
+// ========================================
+void ColdTensorManager::track(const Tensor& t) {
+    if (!t.storage()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& e : entries_) {
+        if (e.storage.lock() == t.storage()) return;
+    }
+    entries_.push_back({t.storage(), dtype_size(t.dtype()), std::chrono::steady_clock::now()});
+}
+
+void ColdTensorManager::untrack(const Tensor& t) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [&](const Entry& e) {
+                                      auto s = e.storage.lock();
+                                      return !s || s == t.storage();
+                                  }),
+                   entries_.end());
+}
+
+void ColdTensorManager::set_policy(ColdPolicy policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = std::move(policy);
+}
+
+// ========================================
+// Demotion pass
+// ========================================
+size_t ColdTensorManager::scan() {
+    using namespace std::chrono;
+    const auto now = steady_clock::now();
+
+    std::vector<std::pair<std::shared_ptr<Storage>, size_t>> victims;
+    ColdPolicy policy;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        policy = policy_;
+        auto it = entries_.begin();
+        while (it != entries_.end()) {
+            auto s = it->storage.lock();
+            if (!s) {
+                it = entries_.erase(it);
+                continue;
+            }
+            if (s->test_and_clear_referenced()) it->last_used = now;
+            const auto idle = duration_cast<milliseconds>(now - it->last_used);
+            const bool demote = policy.should_demote ? policy.should_demote(*s, idle)
+                                                     : idle >= policy.idle_after;
+            if (demote && s->is_resident() && !s->pinned()) victims.emplace_back(std::move(s), it->element_size);
+            ++it;
+        }
+    }
+
+    // Compress outside the lock; each call parallelises over blocks and
+    // skips a storage pinned since it was picked
+    size_t saved = 0;
+    for (auto& v : victims) saved += v.first->compress(v.second);
+    return saved;
+}
+
+// ========================================
+// Background scanner
+// ========================================
+void ColdTensorManager::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    scanner_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_) {
+            wake_.wait_for(lock, policy_.scan_interval, [this] { return !running_; });
+            if (!running_) break;
+            lock.unlock();
+            scan();
+            lock.lock();
+        }
+    });
+}
+
+void ColdTensorManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (scanner_.joinable()) scanner_.join();
+}
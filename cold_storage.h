@@ -0,0 +1,68 @@
+#pragma once
+
+#include "tensor.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================
+// Cold Tensor Demotion
+// =============================
+
+// Decides when tracked tensors are compressed in memory
+struct ColdPolicy {
+    // Storage untouched for this long is demoted
+    std::chrono::milliseconds idle_after{std::chrono::seconds(60)};
+    // Period of the background scanner started by start()
+    std::chrono::milliseconds scan_interval{std::chrono::seconds(5)};
+    // Optional override: return true to demote a storage that has been idle
+    // for the given time (replaces the idle_after test)
+    std::function<bool(const Storage&, std::chrono::milliseconds)> should_demote;
+};
+
+// Tracks tensors that may be demoted to compressed storage when idle.
+// Idle time is measured with the storage's referenced bit, sampled on each
+// scan, so the data() fast path pays no clock reads.
+//
+// Demotion frees the resident bytes, so it only touches unpinned storages.
+// The library's kernels pin their operands while they run; other code that
+// keeps a raw data() pointer to a tracked tensor must hold a pin() as well.
+class ColdTensorManager {
+public:
+    static ColdTensorManager& instance();
+
+    // Tracks the storage of `t` (weakly; freed tensors drop out)
+    void track(const Tensor& t);
+    void untrack(const Tensor& t);
+
+    void set_policy(ColdPolicy policy);
+
+    // One pass over tracked storages; returns the bytes saved by demotion
+    size_t scan();
+
+    // Runs scan() every policy.scan_interval on a background thread
+    void start();
+    void stop();
+
+    ~ColdTensorManager();
+
+private:
+    ColdTensorManager() = default;
+
+    struct Entry {
+        std::weak_ptr<Storage> storage;
+        size_t element_size;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+    ColdPolicy policy_;
+
+    std::thread scanner_;
+    std::condition_variable wake_;
+    bool running_ = false;
+};
@@ -0,0 +1,207 @@
+#include "compression.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kBlockSize = size_t(256) << 10;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kHashBits = 14;
+constexpr size_t kMaxOffset = 65535;
+// The last bytes of a block are always literals, so matches never run off the end
+constexpr size_t kTailLiterals = 12;
+
+enum BlockMode : uint8_t { kRaw = 0, kLz = 1 };
+
+inline uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - kHashBits); }
+
+// ========================================
+// Byte shuffle: element-major -> byte-plane-major
+// ========================================
+void shuffle(const uint8_t* src, uint8_t* dst, size_t n, size_t es) {
+    const size_t count = n / es;
+    for (size_t b = 0; b < es; ++b) {
+        uint8_t* plane = dst + b * count;
+        for (size_t i = 0; i < count; ++i) plane[i] = src[i * es + b];
+    }
+    std::memcpy(dst + count * es, src + count * es, n - count * es);
+}
+
+void unshuffle(const uint8_t* src, uint8_t* dst, size_t n, size_t es) {
+    const size_t count = n / es;
+    for (size_t b = 0; b < es; ++b) {
+        const uint8_t* plane = src + b * count;
+        for (size_t i = 0; i < count; ++i) dst[i * es + b] = plane[i];
+    }
+    std::memcpy(dst + count * es, src + count * es, n - count * es);
+}
+
+// ========================================
+// LZ block codec (LZ4-style sequences)
+// ========================================
+//
+// sequence := token [literal-length bytes] literals offset(u16) [match-length bytes]
+// token    := (literal length << 4) | (match length - 4), 15 = "more bytes follow"
+// The final sequence carries literals only.
+
+void put_length(std::vector<uint8_t>& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(len));
+}
+
+void put_sequence(std::vector<uint8_t>& out, const uint8_t* lit, size_t lit_len,
+                  size_t offset, size_t match_len) {
+    const size_t ml = match_len ? match_len - kMinMatch : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(lit_len, 15) << 4) |
+                                       std::min<size_t>(ml, 15)));
+    if (lit_len >= 15) put_length(out, lit_len - 15);
+    out.insert(out.end(), lit, lit + lit_len);
+    if (match_len == 0) return;
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (ml >= 15) put_length(out, ml - 15);
+}
+
+void lz_compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+    size_t anchor = 0;
+    size_t i = 0;
+    const size_t limit = n > kTailLiterals ? n - kTailLiterals : 0;
+
+    while (i < limit) {
+        const uint32_t v = read32(in + i);
+        const uint32_t h = hash4(v);
+        const size_t cand = table[h];
+        table[h] = static_cast<uint32_t>(i);
+        if (cand < i && i - cand <= kMaxOffset && read32(in + cand) == v) {
+            size_t len = kMinMatch;
+            while (i + len < limit && in[cand + len] == in[i + len]) ++len;
+            put_sequence(out, in + anchor, i - anchor, i - cand, len);
+            i += len;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    put_sequence(out, in + anchor, n - anchor, 0, 0);
+}
+
+size_t get_length(const uint8_t*& p, const uint8_t* end) {
+    size_t len = 0;
+    uint8_t b;
+    do {
+        if (p >= end) throw std::runtime_error("Corrupt compressed block.");
+        b = *p++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+void lz_decompress(const uint8_t* p, const uint8_t* end, uint8_t* out, size_t n) {
+    uint8_t* o = out;
+    uint8_t* const o_end = out + n;
+    while (p < end) {
+        const uint8_t token = *p++;
+        size_t lit = token >> 4;
+        if (lit == 15) lit += get_length(p, end);
+        if (lit > static_cast<size_t>(end - p) || lit > static_cast<size_t>(o_end - o)) {
+            throw std::runtime_error("Corrupt compressed block.");
+        }
+        std::memcpy(o, p, lit);
+        o += lit;
+        p += lit;
+        if (p >= end) break; // final literal-only sequence
+
+        if (end - p < 2) throw std::runtime_error("Corrupt compressed block.");
+        const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        size_t len = (token & 0x0F);
+        if (len == 15) len += get_length(p, end);
+        len += kMinMatch;
+        if (offset == 0 || offset > static_cast<size_t>(o - out) ||
+            len > static_cast<size_t>(o_end - o)) {
+            throw std::runtime_error("Corrupt compressed block.");
+        }
+        // Byte copy: matches may overlap their own output
+        const uint8_t* m = o - offset;
+        for (size_t k = 0; k < len; ++k) o[k] = m[k];
+        o += len;
+    }
+    if (o != o_end) throw std::runtime_error("Corrupt compressed block.");
+}
+
+} // namespace
+
+// ========================================
+// Public API
+// ========================================
+CompressedBuffer compress_bytes(const void* src, size_t size, size_t element_size) {
+    CompressedBuffer buf;
+    buf.raw_size = size;
+    buf.element_size = std::max<size_t>(element_size, 1);
+    buf.block_size = kBlockSize / buf.element_size * buf.element_size;
+
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    const int64_t blocks = static_cast<int64_t>((size + buf.block_size - 1) / buf.block_size);
+    std::vector<std::vector<uint8_t>> coded(static_cast<size_t>(blocks));
+
+    parallel_for(0, blocks, 1, [&](int64_t b, int64_t e) {
+        std::vector<uint8_t> shuffled;
+        for (int64_t k = b; k < e; ++k) {
+            const size_t off = static_cast<size_t>(k) * buf.block_size;
+            const size_t n = std::min(buf.block_size, size - off);
+            shuffled.resize(n);
+            shuffle(in + off, shuffled.data(), n, buf.element_size);
+
+            std::vector<uint8_t>& out = coded[k];
+            out.reserve(n / 2 + 16);
+            out.push_back(kLz);
+            lz_compress(shuffled.data(), n, out);
+            if (out.size() >= n + 1) {
+                out.assign(1, kRaw);
+                out.insert(out.end(), in + off, in + off + n);
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& c : coded) total += c.size();
+    buf.payload.reserve(total);
+    buf.block_offsets.reserve(coded.size() + 1);
+    for (auto& c : coded) {
+        buf.block_offsets.push_back(buf.payload.size());
+        buf.payload.insert(buf.payload.end(), c.begin(), c.end());
+        std::vector<uint8_t>().swap(c);
+    }
+    buf.block_offsets.push_back(buf.payload.size());
+    return buf;
+}
+
+void decompress_bytes(const CompressedBuffer& buf, void* dst) {
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    const int64_t blocks = static_cast<int64_t>(buf.block_offsets.size()) - 1;
+
+    parallel_for(0, blocks, 1, [&](int64_t b, int64_t e) {
+        std::vector<uint8_t> shuffled;
+        for (int64_t k = b; k < e; ++k) {
+            const uint8_t* p = buf.payload.data() + buf.block_offsets[k];
+            const uint8_t* end = buf.payload.data() + buf.block_offsets[k + 1];
+            const size_t off = static_cast<size_t>(k) * buf.block_size;
+            const size_t n = std::min(buf.block_size, buf.raw_size - off);
+            if (*p == kRaw) {
+                std::memcpy(out + off, p + 1, n);
+                continue;
+            }
+            shuffled.resize(n);
+            lz_decompress(p + 1, end, shuffled.data(), n);
+            unshuffle(shuffled.data(), out + off, n, buf.element_size);
+        }
+    });
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =============================
+// In-Memory Compression
+// =============================
+
+// Compressed image of a byte range. The input is cut into fixed-size blocks
+// that are byte-shuffled by element size (grouping the exponent and
+// mantissa bytes of floats) and then LZ-coded independently, so blocks can
+// be compressed and decompressed in parallel. Blocks that do not shrink are
+// stored raw.
+struct CompressedBuffer {
+    size_t raw_size = 0;
+    size_t element_size = 1;
+    size_t block_size = 0;
+    std::vector<uint8_t> payload;        // concatenated blocks
+    std::vector<size_t> block_offsets;   // start of each block, plus the end
+
+    size_t compressed_size() const {
+        return payload.size() + block_offsets.size() * sizeof(size_t);
+    }
+};
+
+// Compresses `size` bytes made of elements of `element_size` bytes
+CompressedBuffer compress_bytes(const void* src, size_t size, size_t element_size);
+
+// Restores the original bytes into `dst` (which must hold raw_size bytes)
+void decompress_bytes(const CompressedBuffer& buffer, void* dst);
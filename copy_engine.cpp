@@ -0,0 +1,137 @@
+#include "copy_engine.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TENSOR_HAVE_X86_64 1
+#endif
+
+namespace {
+
+constexpr size_t kParallelChunk = size_t(2) << 20;
+constexpr size_t kPrefetchAhead = 1024;
+
+// ========================================
+// Helper: Thresholds
+// ========================================
+struct Config {
+    std::atomic<size_t> streaming;
+    std::atomic<size_t> parallel;
+};
+
+Config& config() {
+    // Streaming stays off until measured to win (see copy_engine.h)
+    static Config c{{SIZE_MAX}, {size_t(16) << 20}};
+    return c;
+}
+
+// ========================================
+// Streaming copies
+// ========================================
+#ifdef TENSOR_HAVE_X86_64
+__attribute__((target("avx")))
+void stream_copy_avx(uint8_t* d, const uint8_t* s, size_t n) {
+    const size_t head = std::min(n, (32 - reinterpret_cast<uintptr_t>(d) % 32) % 32);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    for (; n >= 128; n -= 128, d += 128, s += 128) {
+        _mm_prefetch(reinterpret_cast<const char*>(s + kPrefetchAhead), _MM_HINT_NTA);
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 64));
+        const __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 96), e);
+    }
+    _mm_sfence();
+    std::memcpy(d, s, n);
+}
+
+void stream_copy_sse2(uint8_t* d, const uint8_t* s, size_t n) {
+    const size_t head = std::min(n, (16 - reinterpret_cast<uintptr_t>(d) % 16) % 16);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        _mm_prefetch(reinterpret_cast<const char*>(s + kPrefetchAhead), _MM_HINT_NTA);
+        for (int k = 0; k < 64; k += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + k), v);
+        }
+    }
+    _mm_sfence();
+    std::memcpy(d, s, n);
+}
+#endif
+
+void stream_copy(uint8_t* d, const uint8_t* s, size_t n) {
+#ifdef TENSOR_HAVE_X86_64
+    static const bool avx = cpu_features().avx;
+    if (avx) {
+        stream_copy_avx(d, s, n);
+    } else {
+        stream_copy_sse2(d, s, n);
+    }
+#else
+    std::memcpy(d, s, n);
+#endif
+}
+
+} // namespace
+
+// ========================================
+// Public API
+// ========================================
+void tensor_copy(void* dst, const void* src, size_t n) {
+    if (n == 0 || dst == src) return;
+    auto* d = static_cast<uint8_t*>(dst);
+    const auto* s = static_cast<const uint8_t*>(src);
+    const Config& c = config();
+    const bool streaming = n >= c.streaming.load(std::memory_order_relaxed);
+    auto copy = [streaming](uint8_t* to, const uint8_t* from, size_t len) {
+        if (streaming) {
+            stream_copy(to, from, len);
+        } else {
+            std::memcpy(to, from, len);
+        }
+    };
+
+    if (n < c.parallel.load(std::memory_order_relaxed) || get_num_threads() < 2) {
+        copy(d, s, n);
+        return;
+    }
+
+    // Chunk boundaries on 2 MiB of the destination (huge page size), so no
+    // page is written by two threads
+    const size_t misalign = reinterpret_cast<uintptr_t>(d) % kParallelChunk;
+    const size_t first = std::min(n, misalign ? kParallelChunk - misalign : kParallelChunk);
+    const int64_t chunks = 1 + static_cast<int64_t>((n - first + kParallelChunk - 1) / kParallelChunk);
+    parallel_for(0, chunks, 1, [&](int64_t b, int64_t e) {
+        for (int64_t i = b; i < e; ++i) {
+            const size_t off = i == 0 ? 0 : first + static_cast<size_t>(i - 1) * kParallelChunk;
+            const size_t len = i == 0 ? first : std::min(kParallelChunk, n - off);
+            copy(d + off, s + off, len);
+        }
+    });
+}
+
+CopyThresholds copy_thresholds() {
+    const Config& c = config();
+    return {c.streaming.load(), c.parallel.load()};
+}
+
+void set_copy_thresholds(const CopyThresholds& thresholds) {
+    Config& c = config();
+    if (thresholds.streaming) c.streaming.store(thresholds.streaming);
+    if (thresholds.parallel) c.parallel.store(thresholds.parallel);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// =============================
+// Copy Engine
+// =============================
+
+// Size thresholds used to pick a copy strategy
+struct CopyThresholds {
+    size_t streaming = 0; // >= this: our non-temporal stores (default: never)
+    size_t parallel = 0;  // >= this: split across the thread pool
+};
+
+// Copies `n` bytes between non-overlapping buffers, picking a strategy by
+// size: memcpy on one thread, and for huge copies 2 MiB-aligned chunks on
+// the thread pool. Each destination chunk is written by one thread, so
+// freshly allocated pages are first touched, and therefore placed, on that
+// thread's NUMA node.
+//
+// Non-temporal streaming stores with prefetch are used from the
+// `streaming` threshold up. They are off by default; set_copy_thresholds
+// turns them on.
+void tensor_copy(void* dst, const void* src, size_t n);
+
+CopyThresholds copy_thresholds();
+void set_copy_thresholds(const CopyThresholds& thresholds);
@@ -0,0 +1,22 @@
+#include "cpu_features.h"
+
+// ========================================
+// Helper: Query the CPU through the compiler builtins
+// ========================================
+static CpuFeatures detect_cpu_features() {
+    CpuFeatures f;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    f.sse42 = __builtin_cpu_supports("sse4.2");
+    f.avx = __builtin_cpu_supports("avx");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.fma = __builtin_cpu_supports("fma");
+    f.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+    return f;
+}
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// =============================
+// CPU Feature Detection
+// =============================
+
+// Instruction set extensions relevant to the CPU kernels
+struct CpuFeatures {
+    bool sse42 = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool avx512f = false;
+};
+
+// Returns the features of the host CPU (detected once, on first call)
+const CpuFeatures& cpu_features();
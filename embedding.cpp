@@ -0,0 +1,160 @@
+#include "embedding.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+// ========================================
+// Construction
+// ========================================
+HotEmbeddingTable::HotEmbeddingTable(const Tensor& weights)
+    : HotEmbeddingTable(weights, Options()) {}
+
+HotEmbeddingTable::HotEmbeddingTable(const Tensor& weights, const Options& options)
+    : options_(options)
+{
+    if (weights.dtype() != Dtype::Float32 || weights.shape().size() != 2 ||
+        !weights.is_contiguous()) {
+        throw std::invalid_argument("HotEmbeddingTable expects a contiguous 2D Float32 tensor.");
+    }
+    num_rows_ = static_cast<size_t>(weights.shape()[0]);
+    dim_ = static_cast<size_t>(weights.shape()[1]);
+    if (options_.hot_rows == 0) options_.hot_rows = std::max<size_t>(1, num_rows_ / 100);
+    options_.hot_rows = std::min(options_.hot_rows, num_rows_);
+
+    // Every row starts cold, read from the shared weights; the first repack
+    // fills the hot region
+    table_ = weights;
+    slot_.assign(num_rows_, -1);
+
+    counts_.reset(new std::atomic<uint32_t>[num_rows_]);
+    for (size_t i = 0; i < num_rows_; ++i) counts_[i].store(0, std::memory_order_relaxed);
+}
+
+void HotEmbeddingTable::check_id(int64_t id) const {
+    if (id < 0 || static_cast<size_t>(id) >= num_rows_) {
+        throw std::out_of_range("Embedding row id out of range.");
+    }
+}
+
+// ========================================
+// Lookup
+// ========================================
+Tensor HotEmbeddingTable::gather(const std::vector<int64_t>& ids) {
+    Tensor out(Shape({static_cast<int32_t>(ids.size()), static_cast<int32_t>(dim_)}),
+               Dtype::Float32);
+    gather_into(ids, out.data<float>());
+    return out;
+}
+
+void HotEmbeddingTable::gather_into(const std::vector<int64_t>& ids, float* out) {
+    for (int64_t id : ids) check_id(id);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(layout_mutex_);
+        const StoragePin keep = table_.pin();
+        const float* base = std::as_const(table_).data<float>();
+        const float* hot = std::as_const(hot_).data<float>();
+        auto row = [&](int64_t id) {
+            const int32_t s = slot_[id];
+            return s >= 0 ? hot + static_cast<size_t>(s) * dim_ : base + id * dim_;
+        };
+        const int64_t n = static_cast<int64_t>(ids.size());
+        const int64_t dist = options_.prefetch_distance;
+        const size_t row_bytes = dim_ * sizeof(float);
+        const int64_t grain = std::max<int64_t>(1, 16384 / static_cast<int64_t>(dim_));
+
+        parallel_for(0, n, grain, [&](int64_t b, int64_t e) {
+            for (int64_t i = b; i < e; ++i) {
+                if (dist > 0 && i + dist < e) __builtin_prefetch(row(ids[i + dist]));
+                std::memcpy(out + i * dim_, row(ids[i]), row_bytes);
+                counts_[ids[i]].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    const size_t interval = options_.repack_interval;
+    if (interval > 0 &&
+        lookups_since_repack_.fetch_add(ids.size()) + ids.size() >= interval) {
+        repack();
+    }
+}
+
+void HotEmbeddingTable::prefetch(const std::vector<int64_t>& ids) const {
+    std::shared_lock<std::shared_mutex> lock(layout_mutex_);
+    const float* base = table_.data<float>();
+    const float* hot = hot_.data<float>();
+    const size_t line_floats = 64 / sizeof(float);
+    for (int64_t id : ids) {
+        if (id < 0 || static_cast<size_t>(id) >= num_rows_) continue;
+        const int32_t s = slot_[id];
+        const float* row = s >= 0 ? hot + static_cast<size_t>(s) * dim_ : base + id * dim_;
+        for (size_t k = 0; k < dim_; k += line_floats) __builtin_prefetch(row + k);
+    }
+}
+
+// ========================================
+// Repacking
+// ========================================
+void HotEmbeddingTable::repack() {
+    std::lock_guard<std::mutex> serial(repack_mutex_);
+    lookups_since_repack_.store(0);
+
+    // Rank logical rows by access count, hottest first
+    std::vector<uint32_t> counts(num_rows_);
+    for (size_t i = 0; i < num_rows_; ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    std::vector<int64_t> order(num_rows_);
+    std::iota(order.begin(), order.end(), 0);
+    const size_t hot = options_.hot_rows;
+    std::partial_sort(order.begin(), order.begin() + hot, order.end(),
+                      [&](int64_t a, int64_t b) {
+                          return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+                      });
+    order.resize(hot);
+    std::sort(order.begin(), order.end()); // hot rows in id order
+
+    // Fill the new hot region off to the side; readers keep using the old
+    // one. Only the hot rows are copied, never the whole table.
+    Tensor packed(Shape({static_cast<int32_t>(hot), static_cast<int32_t>(dim_)}),
+                  Dtype::Float32, table_.device());
+    {
+        const StoragePin keep = table_.pin();
+        const float* src = std::as_const(table_).data<float>();
+        float* dst = packed.data<float>();
+        parallel_for(0, static_cast<int64_t>(hot), 1024, [&](int64_t b, int64_t e) {
+            for (int64_t p = b; p < e; ++p) {
+                std::memcpy(dst + p * dim_, src + order[p] * dim_, dim_ * sizeof(float));
+            }
+        });
+    }
+
+    // Swap in: only the slots of the old and new hot rows change
+    {
+        std::unique_lock<std::shared_mutex> lock(layout_mutex_);
+        for (int64_t id : hot_ids_) slot_[id] = -1;
+        for (size_t p = 0; p < hot; ++p) slot_[order[p]] = static_cast<int32_t>(p);
+        hot_ = std::move(packed);
+        hot_ids_ = std::move(order);
+    }
+
+    // Exponential decay so the hot set follows shifting traffic
+    for (size_t i = 0; i < num_rows_; ++i) {
+        counts_[i].store(counts_[i].load(std::memory_order_relaxed) / 2,
+                         std::memory_order_relaxed);
+    }
+    ++repacks_;
+}
+
+int64_t HotEmbeddingTable::hot_slot(int64_t id) const {
+    check_id(id);
+    std::shared_lock<std::shared_mutex> lock(layout_mutex_);
+    return slot_[id];
+}
+
+uint32_t HotEmbeddingTable::access_count(int64_t id) const {
+    check_id(id);
+    return counts_[id].load(std::memory_order_relaxed);
+}
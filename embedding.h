@@ -0,0 +1,76 @@
+#pragma once
+
+#include "tensor.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// =============================
+// Hot-Row Embedding Table
+// =============================
+
+// Float32 embedding table of shape (num_rows, dim) that tracks how often each
+// row is looked up and periodically copies the hottest rows into a small
+// compact hot region. Other rows are read straight from the weights, which
+// are shared rather than copied, so the table adds only the hot region to
+// the weights' footprint. Callers keep using the original row ids, and must
+// not modify the weights while the table is in use.
+class HotEmbeddingTable {
+public:
+    struct Options {
+        size_t hot_rows = 0;           // rows kept in the hot region (0 = 1% of rows)
+        size_t repack_interval = 0;    // lookups between automatic repacks (0 = manual)
+        int prefetch_distance = 8;     // rows ahead to prefetch during gather
+    };
+
+    explicit HotEmbeddingTable(const Tensor& weights);
+    HotEmbeddingTable(const Tensor& weights, const Options& options);
+
+    HotEmbeddingTable(const HotEmbeddingTable&) = delete;
+    HotEmbeddingTable& operator=(const HotEmbeddingTable&) = delete;
+
+    size_t num_rows() const { return num_rows_; }
+    size_t dim() const { return dim_; }
+
+    // Copies rows `ids` into a new (ids.size(), dim) tensor
+    Tensor gather(const std::vector<int64_t>& ids);
+
+    // Same, writing into `out`, which must hold ids.size() * dim floats
+    void gather_into(const std::vector<int64_t>& ids, float* out);
+
+    // Issues cache prefetches for the rows of an upcoming batch
+    void prefetch(const std::vector<int64_t>& ids) const;
+
+    // Copies the most frequently accessed rows into the hot region and decays
+    // the counters. Safe to call concurrently with gather().
+    void repack();
+
+    // Position of a row in the hot region, or -1 if it is read from the weights
+    int64_t hot_slot(int64_t id) const;
+
+    // Accumulated (decayed) access count of a logical row
+    uint32_t access_count(int64_t id) const;
+
+    size_t hot_rows() const { return options_.hot_rows; }
+    size_t repack_count() const { return repacks_.load(); }
+
+private:
+    void check_id(int64_t id) const;
+
+    Options options_;
+    size_t num_rows_ = 0;
+    size_t dim_ = 0;
+
+    Tensor table_;                           // the caller's weights, never written
+
+    mutable std::shared_mutex layout_mutex_; // guards hot_, slot_ and hot_ids_
+    Tensor hot_;                             // copies of the hot rows
+    std::vector<int32_t> slot_;              // row id -> hot slot, or -1
+    std::vector<int64_t> hot_ids_;           // row id in each hot slot
+
+    std::unique_ptr<std::atomic<uint32_t>[]> counts_;
+    std::atomic<size_t> lookups_since_repack_{0};
+    std::atomic<size_t> repacks_{0};
+    std::mutex repack_mutex_;
+};
@@ -0,0 +1,558 @@
+#include "graph.h"
+#include "graph_ops.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kGraphMagic[8] = {'T', 'G', 'R', 'A', 'P', 'H', '0', '1'};
+const char kWeightsMagic[8] = {'T', 'W', 'G', 'H', 'T', '0', '0', '1'};
+constexpr uint64_t kWeightAlignment = 64;
+
+// ========================================
+// Helper: binary encoding
+// ========================================
+template <typename T>
+void put(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void put_string(std::ostream& out, const std::string& s) {
+    put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+template <typename T>
+T get(std::istream& in) {
+    T value;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        throw std::runtime_error("Truncated graph file.");
+    }
+    return value;
+}
+
+std::string get_string(std::istream& in) {
+    const uint32_t n = get<uint32_t>(in);
+    std::string s(n, '\0');
+    if (n && !in.read(&s[0], n)) throw std::runtime_error("Truncated graph file.");
+    return s;
+}
+
+// ========================================
+// Helper: mapped weight files
+// ========================================
+
+// Private, writable mapping of a whole file; unmapped with the last
+// constant that points into it
+struct MappedFile {
+    void* base = MAP_FAILED;
+    size_t size = 0;
+
+    ~MappedFile() {
+        if (base != MAP_FAILED) ::munmap(base, size);
+    }
+};
+
+std::shared_ptr<MappedFile> map_file(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error("Cannot open weight file " + path);
+    auto file = std::make_shared<MappedFile>();
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        file->size = static_cast<size_t>(st.st_size);
+        file->base = ::mmap(nullptr, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (file->base == MAP_FAILED) throw std::runtime_error("Cannot map weight file " + path);
+    return file;
+}
+
+// Inputs each op takes: [min, max]
+std::pair<size_t, size_t> arity(OpKind op) {
+    switch (op) {
+    case OpKind::Input:
+    case OpKind::Constant: return {0, 0};
+    case OpKind::Linear:
+    case OpKind::Conv2d:
+    case OpKind::Scale: return {2, 3};
+    case OpKind::BatchNorm: return {5, 5};
+    case OpKind::Add:
+    case OpKind::Mul: return {2, 2};
+    default: return {1, 1};
+    }
+}
+
+// Inputs are contiguous Float32 for the kernels
+Tensor as_kernel_input(const Tensor& t, const std::string& name) {
+    if (t.dtype() != Dtype::Float32) {
+        throw std::invalid_argument("Graph value '" + name + "' must be Float32.");
+    }
+    return t.is_contiguous() ? t : t.clone();
+}
+
+Attributes pool_attributes(const Pool2dParams& p, bool avg) {
+    Attributes a;
+    a.ints["kernel"] = {p.kernel_h, p.kernel_w};
+    a.ints["stride"] = {p.stride_h, p.stride_w};
+    a.ints["pad"] = {p.pad_h, p.pad_w};
+    a.ints["ceil_mode"] = {p.ceil_mode ? 1 : 0};
+    if (avg) a.ints["count_include_pad"] = {p.count_include_pad ? 1 : 0};
+    return a;
+}
+
+} // namespace
+
+const char* op_name(OpKind op) {
+    switch (op) {
+    case OpKind::Input: return "Input";
+    case OpKind::Constant: return "Constant";
+    case OpKind::Linear: return "Linear";
+    case OpKind::Conv2d: return "Conv2d";
+    case OpKind::BatchNorm: return "BatchNorm";
+    case OpKind::Scale: return "Scale";
+    case OpKind::Add: return "Add";
+    case OpKind::Mul: return "Mul";
+    case OpKind::Relu: return "Relu";
+    case OpKind::Reshape: return "Reshape";
+    case OpKind::Transpose: return "Transpose";
+    case OpKind::MaxPool2d: return "MaxPool2d";
+    case OpKind::AvgPool2d: return "AvgPool2d";
+    }
+    return "Unknown";
+}
+
+// ========================================
+// Attributes
+// ========================================
+int64_t Attributes::get_int(const std::string& key, int64_t fallback) const {
+    auto it = ints.find(key);
+    return it == ints.end() || it->second.empty() ? fallback : it->second[0];
+}
+
+std::vector<int64_t> Attributes::get_ints(const std::string& key) const {
+    auto it = ints.find(key);
+    return it == ints.end() ? std::vector<int64_t>() : it->second;
+}
+
+double Attributes::get_float(const std::string& key, double fallback) const {
+    auto it = floats.find(key);
+    return it == floats.end() ? fallback : it->second;
+}
+
+// ========================================
+// Graph: capture
+// ========================================
+ValueId Graph::input(const std::string& name, const Shape& shape) {
+    Node n;
+    n.op = OpKind::Input;
+    n.name = name;
+    if (!shape.dims.empty()) {
+        n.attrs.ints["shape"] = std::vector<int64_t>(shape.dims.begin(), shape.dims.end());
+    }
+    nodes_.push_back(std::move(n));
+    return static_cast<ValueId>(nodes_.size() - 1);
+}
+
+ValueId Graph::constant(const std::string& name, Tensor value) {
+    if (!value.storage()) throw std::invalid_argument("Graph constant '" + name + "' is empty.");
+    Node n;
+    n.op = OpKind::Constant;
+    n.name = name;
+    n.value = as_kernel_input(value, name);
+    nodes_.push_back(std::move(n));
+    return static_cast<ValueId>(nodes_.size() - 1);
+}
+
+ValueId Graph::add_node(OpKind op, std::vector<ValueId> inputs, Attributes attrs) {
+    if (op == OpKind::Input || op == OpKind::Constant) {
+        throw std::invalid_argument("Use Graph::input and Graph::constant for leaf nodes.");
+    }
+    const auto range = arity(op);
+    if (inputs.size() < range.first || inputs.size() > range.second) {
+        throw std::invalid_argument(std::string(op_name(op)) + ": wrong number of inputs.");
+    }
+    for (ValueId v : inputs) {
+        if (v < 0 || static_cast<size_t>(v) >= nodes_.size()) {
+            throw std::invalid_argument(std::string(op_name(op)) + ": input is not a value of this graph.");
+        }
+    }
+    Node n;
+    n.op = op;
+    n.inputs = std::move(inputs);
+    n.attrs = std::move(attrs);
+    nodes_.push_back(std::move(n));
+    return static_cast<ValueId>(nodes_.size() - 1);
+}
+
+void Graph::output(const std::string& name, ValueId value) {
+    if (value < 0 || static_cast<size_t>(value) >= nodes_.size()) {
+        throw std::invalid_argument("Graph output '" + name + "' is not a value of this graph.");
+    }
+    outputs_.emplace_back(name, value);
+}
+
+ValueId Graph::linear(ValueId x, ValueId weight, ValueId bias) {
+    std::vector<ValueId> in{x, weight};
+    if (bias != kNoValue) in.push_back(bias);
+    return add_node(OpKind::Linear, std::move(in));
+}
+
+ValueId Graph::conv2d(ValueId x, ValueId weight, ValueId bias, int32_t stride, int32_t pad) {
+    std::vector<ValueId> in{x, weight};
+    if (bias != kNoValue) in.push_back(bias);
+    Attributes a;
+    a.ints["stride"] = {stride, stride};
+    a.ints["pad"] = {pad, pad};
+    return add_node(OpKind::Conv2d, std::move(in), std::move(a));
+}
+
+ValueId Graph::batch_norm(ValueId x, ValueId gamma, ValueId beta, ValueId mean, ValueId var,
+                          double eps) {
+    Attributes a;
+    a.floats["eps"] = eps;
+    return add_node(OpKind::BatchNorm, {x, gamma, beta, mean, var}, std::move(a));
+}
+
+ValueId Graph::scale(ValueId x, ValueId scale, ValueId shift) {
+    std::vector<ValueId> in{x, scale};
+    if (shift != kNoValue) in.push_back(shift);
+    return add_node(OpKind::Scale, std::move(in));
+}
+
+ValueId Graph::add(ValueId a, ValueId b) { return add_node(OpKind::Add, {a, b}); }
+ValueId Graph::mul(ValueId a, ValueId b) { return add_node(OpKind::Mul, {a, b}); }
+ValueId Graph::relu(ValueId x) { return add_node(OpKind::Relu, {x}); }
+
+ValueId Graph::reshape(ValueId x, const std::vector<int64_t>& shape) {
+    Attributes a;
+    a.ints["shape"] = shape;
+    return add_node(OpKind::Reshape, {x}, std::move(a));
+}
+
+ValueId Graph::transpose(ValueId x, const std::vector<int64_t>& perm) {
+    Attributes a;
+    a.ints["perm"] = perm;
+    return add_node(OpKind::Transpose, {x}, std::move(a));
+}
+
+ValueId Graph::max_pool2d(ValueId x, const Pool2dParams& params) {
+    return add_node(OpKind::MaxPool2d, {x}, pool_attributes(params, false));
+}
+
+ValueId Graph::avg_pool2d(ValueId x, const Pool2dParams& params) {
+    return add_node(OpKind::AvgPool2d, {x}, pool_attributes(params, true));
+}
+
+// ========================================
+// Graph: rewriting
+// ========================================
+void Graph::replace_uses(ValueId from, ValueId to) {
+    for (Node& n : nodes_) {
+        for (ValueId& v : n.inputs) {
+            if (v == from) v = to;
+        }
+    }
+    for (auto& out : outputs_) {
+        if (out.second == from) out.second = to;
+    }
+}
+
+std::vector<size_t> Graph::use_counts() const {
+    std::vector<size_t> uses(nodes_.size(), 0);
+    for (const Node& n : nodes_) {
+        for (ValueId v : n.inputs) ++uses[v];
+    }
+    for (const auto& out : outputs_) ++uses[out.second];
+    return uses;
+}
+
+size_t Graph::compact() {
+    std::vector<bool> live(nodes_.size(), false);
+    std::vector<ValueId> stack;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i].op == OpKind::Input) stack.push_back(static_cast<ValueId>(i));
+    }
+    for (const auto& out : outputs_) stack.push_back(out.second);
+    while (!stack.empty()) {
+        const ValueId v = stack.back();
+        stack.pop_back();
+        if (live[v]) continue;
+        live[v] = true;
+        for (ValueId in : nodes_[v].inputs) stack.push_back(in);
+    }
+
+    // Leaves first, then ops; both keep their relative order
+    std::vector<ValueId> order;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            const bool leaf = nodes_[i].op == OpKind::Input || nodes_[i].op == OpKind::Constant;
+            if (live[i] && leaf == (pass == 0)) order.push_back(static_cast<ValueId>(i));
+        }
+    }
+    std::vector<ValueId> remap(nodes_.size(), kNoValue);
+    for (size_t i = 0; i < order.size(); ++i) remap[order[i]] = static_cast<ValueId>(i);
+
+    std::vector<Node> compacted;
+    compacted.reserve(order.size());
+    for (ValueId old : order) {
+        Node n = std::move(nodes_[old]);
+        for (ValueId& in : n.inputs) in = remap[in];
+        compacted.push_back(std::move(n));
+    }
+    for (auto& out : outputs_) out.second = remap[out.second];
+    const size_t removed = nodes_.size() - compacted.size();
+    nodes_ = std::move(compacted);
+    return removed;
+}
+
+void Graph::validate() const {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const Node& n = nodes_[i];
+        const std::string where = std::string(op_name(n.op)) + " node " + std::to_string(i);
+        const auto range = arity(n.op);
+        if (n.inputs.size() < range.first || n.inputs.size() > range.second) {
+            throw std::invalid_argument(where + " has the wrong number of inputs.");
+        }
+        for (ValueId v : n.inputs) {
+            if (v < 0 || static_cast<size_t>(v) >= nodes_.size() ||
+                (static_cast<size_t>(v) >= i && nodes_[v].op != OpKind::Constant)) {
+                throw std::invalid_argument(where + " has an input that does not precede it.");
+            }
+        }
+        if (n.op == OpKind::Constant && !n.value.storage()) {
+            throw std::invalid_argument(where + " has no value.");
+        }
+        const char* required = n.op == OpKind::Reshape   ? "shape"
+                             : n.op == OpKind::Transpose ? "perm"
+                             : n.op == OpKind::MaxPool2d || n.op == OpKind::AvgPool2d ? "kernel"
+                             : nullptr;
+        if (required && n.attrs.get_ints(required).empty()) {
+            throw std::invalid_argument(where + " is missing the '" + required + "' attribute.");
+        }
+    }
+    for (const auto& out : outputs_) {
+        if (out.second < 0 || static_cast<size_t>(out.second) >= nodes_.size()) {
+            throw std::invalid_argument("Graph output '" + out.first + "' is dangling.");
+        }
+    }
+}
+
+// ========================================
+// Shape inference / reference execution
+// ========================================
+std::vector<Shape> infer_shapes(const Graph& graph) {
+    const std::vector<Node>& nodes = graph.nodes();
+    std::vector<Shape> shapes(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].op == OpKind::Constant) shapes[i] = Shape(nodes[i].value.shape());
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& n = nodes[i];
+        if (n.op == OpKind::Constant) continue;
+        if (n.op == OpKind::Input) {
+            const std::vector<int64_t> dims = n.attrs.get_ints("shape");
+            shapes[i].dims.assign(dims.begin(), dims.end());
+            continue;
+        }
+        std::vector<Shape> in;
+        bool known = true;
+        for (ValueId v : n.inputs) {
+            known = known && !shapes[v].dims.empty();
+            in.push_back(shapes[v]);
+        }
+        if (known) shapes[i] = infer_node_shape(n, in);
+    }
+    return shapes;
+}
+
+std::vector<Tensor> run_graph(const Graph& graph, const std::map<std::string, Tensor>& inputs) {
+    const std::vector<Node>& nodes = graph.nodes();
+    std::vector<Tensor> values(nodes.size());
+
+    // Intermediates are released after their last use
+    std::vector<size_t> remaining = graph.use_counts();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& n = nodes[i];
+        if (n.op == OpKind::Constant) values[i] = n.value;
+        if (n.op != OpKind::Input) continue;
+        auto it = inputs.find(n.name);
+        if (it == inputs.end()) throw std::invalid_argument("Missing graph input '" + n.name + "'.");
+        const std::vector<int64_t> declared = n.attrs.get_ints("shape");
+        if (!declared.empty() &&
+            std::vector<int64_t>(it->second.shape().begin(), it->second.shape().end()) != declared) {
+            throw std::invalid_argument("Graph input '" + n.name + "' has the wrong shape.");
+        }
+        values[i] = as_kernel_input(it->second, n.name);
+    }
+
+    std::vector<const Tensor*> args;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& n = nodes[i];
+        if (n.op == OpKind::Input || n.op == OpKind::Constant) continue;
+        args.clear();
+        for (ValueId v : n.inputs) args.push_back(&values[v]);
+        values[i] = eval_node(n, args);
+        for (ValueId v : n.inputs) {
+            if (--remaining[v] == 0 && nodes[v].op != OpKind::Constant) values[v] = Tensor();
+        }
+    }
+
+    std::vector<Tensor> outputs;
+    for (const auto& out : graph.outputs()) outputs.push_back(values[out.second]);
+    return outputs;
+}
+
+// ========================================
+// Serialization
+// ========================================
+void save_graph(const Graph& graph, const std::string& path) {
+    graph.validate();
+    // Both files are written aside and renamed over the old ones: a model
+    // loaded with WeightLoading::Map keeps the old weight file mapped, and
+    // truncating it in place would fault or change that model's weights
+    const std::string weights_path = path + ".weights";
+    const std::string staging = path + ".tmp";
+    const std::string weights_staging = weights_path + ".tmp";
+    std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot open graph file " + staging);
+    std::ofstream weights(weights_staging, std::ios::binary | std::ios::trunc);
+    if (!weights) {
+        out.close();
+        std::remove(staging.c_str());
+        throw std::runtime_error("Cannot open weight file " + weights_staging);
+    }
+    out.write(kGraphMagic, sizeof(kGraphMagic));
+    weights.write(kWeightsMagic, sizeof(kWeightsMagic));
+
+    put<uint32_t>(out, static_cast<uint32_t>(graph.size()));
+    for (const Node& n : graph.nodes()) {
+        put<uint8_t>(out, static_cast<uint8_t>(n.op));
+        put_string(out, n.name);
+        put<uint32_t>(out, static_cast<uint32_t>(n.inputs.size()));
+        for (ValueId v : n.inputs) put<int32_t>(out, v);
+        put<uint32_t>(out, static_cast<uint32_t>(n.attrs.ints.size()));
+        for (const auto& kv : n.attrs.ints) {
+            put_string(out, kv.first);
+            put<uint32_t>(out, static_cast<uint32_t>(kv.second.size()));
+            for (int64_t x : kv.second) put<int64_t>(out, x);
+        }
+        put<uint32_t>(out, static_cast<uint32_t>(n.attrs.floats.size()));
+        for (const auto& kv : n.attrs.floats) {
+            put_string(out, kv.first);
+            put<double>(out, kv.second);
+        }
+        if (n.op != OpKind::Constant) continue;
+
+        // Constant: dtype, shape and a reference into the weight file
+        const Tensor& t = n.value;
+        put<uint8_t>(out, static_cast<uint8_t>(t.dtype()));
+        put<uint32_t>(out, static_cast<uint32_t>(t.shape().size()));
+        for (int32_t d : t.shape()) put<int32_t>(out, d);
+        uint64_t offset = static_cast<uint64_t>(weights.tellp());
+        const uint64_t aligned = (offset + kWeightAlignment - 1) / kWeightAlignment * kWeightAlignment;
+        for (; offset < aligned; ++offset) weights.put('\0');
+        put<uint64_t>(out, aligned);
+        put<uint64_t>(out, t.nbytes());
+        const StoragePin keep = t.pin();
+        weights.write(t.data<char>(), static_cast<std::streamsize>(t.nbytes()));
+    }
+    put<uint32_t>(out, static_cast<uint32_t>(graph.outputs().size()));
+    for (const auto& o : graph.outputs()) {
+        put_string(out, o.first);
+        put<int32_t>(out, o.second);
+    }
+    out.close();
+    weights.close();
+    // Weights first, so the structure never names offsets a file lacks
+    if (!out || !weights || std::rename(weights_staging.c_str(), weights_path.c_str()) != 0 ||
+        std::rename(staging.c_str(), path.c_str()) != 0) {
+        std::remove(weights_staging.c_str());
+        std::remove(staging.c_str());
+        throw std::runtime_error("Failed writing graph " + path);
+    }
+}
+
+Graph load_graph(const std::string& path, WeightLoading mode) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open graph file " + path);
+    std::ifstream weights;
+    std::shared_ptr<MappedFile> mapped;
+    char magic[8];
+    if (mode == WeightLoading::Map) {
+        mapped = map_file(path + ".weights");
+        if (mapped->size < 8) throw std::runtime_error("Not a weight file: " + path + ".weights");
+        std::memcpy(magic, mapped->base, 8);
+    } else {
+        weights.open(path + ".weights", std::ios::binary);
+        if (!weights || !weights.read(magic, 8)) {
+            throw std::runtime_error("Cannot open weight file " + path + ".weights");
+        }
+    }
+    if (std::memcmp(magic, kWeightsMagic, 8) != 0) {
+        throw std::runtime_error("Not a weight file: " + path + ".weights");
+    }
+    if (!in.read(magic, 8) || std::memcmp(magic, kGraphMagic, 8) != 0) {
+        throw std::runtime_error("Not a graph file: " + path);
+    }
+
+    Graph g;
+    const uint32_t count = get<uint32_t>(in);
+    for (uint32_t i = 0; i < count; ++i) {
+        Node n;
+        const uint8_t op = get<uint8_t>(in);
+        if (op > static_cast<uint8_t>(OpKind::AvgPool2d)) throw std::runtime_error("Unknown op in " + path);
+        n.op = static_cast<OpKind>(op);
+        n.name = get_string(in);
+        n.inputs.resize(get<uint32_t>(in));
+        for (ValueId& v : n.inputs) v = get<int32_t>(in);
+        const uint32_t num_ints = get<uint32_t>(in);
+        for (uint32_t k = 0; k < num_ints; ++k) {
+            std::vector<int64_t>& vals = n.attrs.ints[get_string(in)];
+            vals.resize(get<uint32_t>(in));
+            for (int64_t& x : vals) x = get<int64_t>(in);
+        }
+        const uint32_t num_floats = get<uint32_t>(in);
+        for (uint32_t k = 0; k < num_floats; ++k) {
+            std::string key = get_string(in);
+            n.attrs.floats[key] = get<double>(in);
+        }
+        if (n.op == OpKind::Constant) {
+            const Dtype dtype = static_cast<Dtype>(get<uint8_t>(in));
+            Shape shape;
+            shape.dims.resize(get<uint32_t>(in));
+            for (int32_t& d : shape.dims) d = get<int32_t>(in);
+            const uint64_t offset = get<uint64_t>(in);
+            const uint64_t nbytes = get<uint64_t>(in);
+            if (mapped) {
+                size_t expected = dtype_size(dtype);
+                for (int32_t d : shape.dims) expected *= static_cast<size_t>(d);
+                if (expected != nbytes || offset > mapped->size || nbytes > mapped->size - offset) {
+                    throw std::runtime_error("Corrupt constant '" + n.name + "' in " + path);
+                }
+                // The deleter only holds the mapping alive
+                n.value = Tensor::from_blob(static_cast<char*>(mapped->base) + offset, shape, Stride(), dtype,
+                                            [mapped](void*) {});
+            } else {
+                n.value = Tensor(shape, dtype);
+                if (n.value.nbytes() != nbytes || !weights.seekg(static_cast<std::streamoff>(offset)) ||
+                    !weights.read(n.value.data<char>(), static_cast<std::streamsize>(nbytes))) {
+                    throw std::runtime_error("Corrupt constant '" + n.name + "' in " + path);
+                }
+            }
+        }
+        g.nodes_.push_back(std::move(n));
+    }
+    const uint32_t num_outputs = get<uint32_t>(in);
+    for (uint32_t i = 0; i < num_outputs; ++i) {
+        std::string name = get_string(in);
+        g.outputs_.emplace_back(std::move(name), get<int32_t>(in));
+    }
+    g.validate();
+    return g;
+}
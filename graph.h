@@ -0,0 +1,156 @@
+#pragma once
+
+#include "pooling.h"
+#include "tensor.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// =============================
+// Graph IR
+// =============================
+
+// How load_graph brings in the weight file
+enum class WeightLoading {
+    Copy, // read each constant into fresh storage
+    Map   // map the file; constants point into the mapping, which stays
+          // open while any of them is alive
+};
+
+// Ops a graph can hold (Float32). Image ops use the (N, C, H, W) layout and
+// per-channel ops apply along dimension 1.
+enum class OpKind : uint8_t {
+    Input,     // named graph input; optional "shape" attribute
+    Constant,  // named tensor held in the node
+    Linear,    // (x[..., K], weight[M, K], bias[M]?) -> [..., M]
+    Conv2d,    // (x, weight[O, C, KH, KW], bias[O]?); "stride", "pad" as {h, w}
+    BatchNorm, // (x, gamma, beta, mean, var) in inference form; "eps"
+    Scale,     // (x, scale[C], shift[C]?) -> x * scale + shift
+    Add,       // elementwise, same shapes
+    Mul,       // elementwise, same shapes
+    Relu,
+    Reshape,   // "shape", one entry may be -1
+    Transpose, // "perm"
+    MaxPool2d, // "kernel", "stride", "pad" as {h, w}; "ceil_mode"
+    AvgPool2d, // as MaxPool2d, plus "count_include_pad"
+};
+
+const char* op_name(OpKind op);
+
+// Attributes of one node, by name
+struct Attributes {
+    std::map<std::string, std::vector<int64_t>> ints;
+    std::map<std::string, double> floats;
+
+    // First element of an int attribute, or `fallback`
+    int64_t get_int(const std::string& key, int64_t fallback = 0) const;
+    // Empty when absent
+    std::vector<int64_t> get_ints(const std::string& key) const;
+    double get_float(const std::string& key, double fallback = 0.0) const;
+
+    bool operator==(const Attributes& other) const {
+        return ints == other.ints && floats == other.floats;
+    }
+};
+
+// Node i of a graph produces value i
+using ValueId = int32_t;
+constexpr ValueId kNoValue = -1;
+
+struct Node {
+    OpKind op = OpKind::Input;
+    std::vector<ValueId> inputs;
+    Attributes attrs;
+    std::string name; // Input and Constant nodes
+    Tensor value;     // Constant nodes
+};
+
+// Dataflow graph of tensor ops. Models are captured by calling the builder
+// methods in program order, each of which records one op and returns the
+// value it produces. Every node's inputs come before it, except that
+// optimizer passes may append Constant nodes (which have no inputs) that
+// earlier nodes refer to; compact() restores a strict order.
+class Graph {
+public:
+    // =========================
+    // Capture
+    // =========================
+    ValueId input(const std::string& name, const Shape& shape = Shape());
+    ValueId constant(const std::string& name, Tensor value);
+    ValueId add_node(OpKind op, std::vector<ValueId> inputs, Attributes attrs = Attributes());
+    void output(const std::string& name, ValueId value);
+
+    ValueId linear(ValueId x, ValueId weight, ValueId bias = kNoValue);
+    ValueId conv2d(ValueId x, ValueId weight, ValueId bias = kNoValue,
+                   int32_t stride = 1, int32_t pad = 0);
+    ValueId batch_norm(ValueId x, ValueId gamma, ValueId beta, ValueId mean, ValueId var,
+                       double eps = 1e-5);
+    ValueId scale(ValueId x, ValueId scale, ValueId shift = kNoValue);
+    ValueId add(ValueId a, ValueId b);
+    ValueId mul(ValueId a, ValueId b);
+    ValueId relu(ValueId x);
+    ValueId reshape(ValueId x, const std::vector<int64_t>& shape);
+    ValueId transpose(ValueId x, const std::vector<int64_t>& perm);
+    ValueId max_pool2d(ValueId x, const Pool2dParams& params);
+    ValueId avg_pool2d(ValueId x, const Pool2dParams& params);
+
+    // =========================
+    // Inspection / rewriting
+    // =========================
+    size_t size() const { return nodes_.size(); }
+    const Node& node(ValueId id) const { return nodes_.at(static_cast<size_t>(id)); }
+    Node& node(ValueId id) { return nodes_.at(static_cast<size_t>(id)); }
+    const std::vector<Node>& nodes() const { return nodes_; }
+    const std::vector<std::pair<std::string, ValueId>>& outputs() const { return outputs_; }
+
+    // Points every use of `from`, graph outputs included, at `to`
+    void replace_uses(ValueId from, ValueId to);
+
+    // Uses of each value, graph outputs included
+    std::vector<size_t> use_counts() const;
+
+    // Removes nodes no output depends on (Input nodes are kept) and
+    // renumbers the rest: inputs and constants first, then the ops in their
+    // previous order. Returns the number of nodes removed.
+    size_t compact();
+
+    // Throws std::invalid_argument for dangling inputs, wrong input counts
+    // or missing attributes
+    void validate() const;
+
+private:
+    friend Graph load_graph(const std::string& path, WeightLoading weights);
+
+    std::vector<Node> nodes_;
+    std::vector<std::pair<std::string, ValueId>> outputs_;
+};
+
+// Shape of every value; empty where it depends on an Input without a
+// declared shape. Throws std::invalid_argument for inconsistent shapes.
+std::vector<Shape> infer_shapes(const Graph& graph);
+
+// Reference interpreter: runs the graph node by node and returns the
+// outputs in the order they were declared. Throws std::invalid_argument for
+// missing inputs.
+std::vector<Tensor> run_graph(const Graph& graph, const std::map<std::string, Tensor>& inputs);
+
+// =============================
+// Serialization
+// =============================
+
+// Writes the graph structure to `path` and the constants to
+// `path` + ".weights", each 64-byte aligned so they can be mapped in place.
+// Both are written under temporary names and renamed into place, so models
+// already loaded from `path`, mapped ones included, keep their weights.
+//
+// Structure: "TGRAPH01" | node count | nodes | output count | outputs
+// Weights:   "TWGHT001" | aligned constant bytes ...
+void save_graph(const Graph& graph, const std::string& path);
+
+// Reads a graph written by save_graph. With WeightLoading::Map the weights
+// are not copied: pages are faulted in from the file on first use and are
+// shared with every other process mapping the same model. The mapping is
+// private, so nothing written to a constant reaches the file.
+Graph load_graph(const std::string& path, WeightLoading weights = WeightLoading::Copy);
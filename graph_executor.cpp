@@ -0,0 +1,258 @@
+#include "graph_executor.h"
+#include "cancellation.h"
+#include "graph_ops.h"
+#include "named_pools.h"
+#include "parallel.h"
+#include "thread_budget.h"
+#include <algorithm>
+
+namespace {
+
+bool is_leaf(const Node& n) {
+    return n.op == OpKind::Input || n.op == OpKind::Constant;
+}
+
+void raise_to(std::atomic<size_t>& target, size_t value) {
+    size_t seen = target.load(std::memory_order_relaxed);
+    while (seen < value && !target.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+// State of one run() call. Counters are reset per run; values[i] holds
+// node i's output until its last consumer is done.
+struct GraphExecutor::Run {
+    std::vector<Tensor> values;
+    std::unique_ptr<std::atomic<int32_t>[]> pending;
+    std::unique_ptr<std::atomic<size_t>[]> uses;
+    std::atomic<size_t> remaining{0};
+    std::atomic<size_t> active{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    // Caller context carried onto the lanes
+    std::shared_ptr<const CancellationScope::Chain> cancel_chain;
+    TaskPriority priority = TaskPriority::Normal;
+    ThreadPool* pool = nullptr;
+};
+
+// ========================================
+// Construction
+// ========================================
+GraphExecutor::GraphExecutor(Graph graph) : GraphExecutor(std::move(graph), Options()) {}
+
+GraphExecutor::GraphExecutor(Graph graph, const Options& options)
+    : graph_(std::move(graph)), options_(options) {
+    graph_.validate();
+    const size_t n = graph_.size();
+    consumers_.resize(n);
+    producers_.assign(n, 0);
+    uses_ = graph_.use_counts();
+
+    // Depth of each op above the leaves; the widest level bounds how many
+    // ops can usefully run at once
+    std::vector<size_t> depth(n, 0);
+    std::vector<size_t> width;
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (is_leaf(node)) continue;
+        ops_.push_back(static_cast<ValueId>(i));
+        for (ValueId v : node.inputs) {
+            if (is_leaf(graph_.node(v))) continue;
+            consumers_[v].push_back(static_cast<ValueId>(i));
+            ++producers_[i];
+            depth[i] = std::max(depth[i], depth[v] + 1);
+        }
+        if (width.size() <= depth[i]) width.resize(depth[i] + 1, 0);
+        ++width[depth[i]];
+    }
+    const size_t widest = width.empty() ? 1 : *std::max_element(width.begin(), width.end());
+    lanes_ = options_.lanes > 0 ? options_.lanes : std::min(widest, thread_budget());
+    lanes_ = std::max<size_t>(lanes_, 1);
+    shares_.assign(n, 1);
+}
+
+GraphExecutor::~GraphExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+// ========================================
+// Thread shares
+// ========================================
+void GraphExecutor::prepare_shares(const std::vector<Tensor>& values) {
+    std::vector<std::vector<int32_t>> input_shapes;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (graph_.node(static_cast<ValueId>(i)).op == OpKind::Input) input_shapes.push_back(values[i].shape());
+    }
+    const size_t max_threads = std::max<size_t>(get_num_threads(), 1);
+    if (input_shapes == share_input_shapes_ && !shares_.empty() &&
+        *std::max_element(shares_.begin(), shares_.end()) <= max_threads) {
+        return;
+    }
+
+    std::vector<Shape> shapes(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i].storage()) shapes[i] = Shape(values[i].shape());
+    }
+    std::vector<Shape> in;
+    for (ValueId op : ops_) {
+        const Node& node = graph_.node(op);
+        in.clear();
+        for (ValueId v : node.inputs) in.push_back(shapes[v]);
+        shapes[op] = infer_node_shape(node, in);
+        const int64_t cost = estimate_node_cost(node, in, shapes[op]);
+        const int64_t wanted = (cost + options_.cost_per_thread - 1) / std::max<int64_t>(options_.cost_per_thread, 1);
+        shares_[op] = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(wanted, 1),
+                                                            static_cast<int64_t>(max_threads)));
+    }
+    share_input_shapes_ = std::move(input_shapes);
+}
+
+// ========================================
+// Execution
+// ========================================
+std::vector<Tensor> GraphExecutor::run(const std::map<std::string, Tensor>& inputs) {
+    std::lock_guard<std::mutex> serial(run_mutex_);
+    const size_t n = graph_.size();
+    Run run;
+    run.values.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (node.op == OpKind::Constant) run.values[i] = node.value;
+        if (node.op != OpKind::Input) continue;
+        auto it = inputs.find(node.name);
+        if (it == inputs.end()) throw std::invalid_argument("Missing graph input '" + node.name + "'.");
+        if (it->second.dtype() != Dtype::Float32) {
+            throw std::invalid_argument("Graph input '" + node.name + "' must be Float32.");
+        }
+        run.values[i] = it->second.is_contiguous() ? it->second : it->second.clone();
+    }
+    prepare_shares(run.values);
+
+    run.pending.reset(new std::atomic<int32_t>[n]);
+    run.uses.reset(new std::atomic<size_t>[n]);
+    for (size_t i = 0; i < n; ++i) {
+        run.pending[i].store(producers_[i], std::memory_order_relaxed);
+        run.uses[i].store(uses_[i], std::memory_order_relaxed);
+    }
+    run.remaining.store(ops_.size());
+    run.cancel_chain = CancellationScope::current();
+    run.priority = current_task_priority();
+    run.pool = &current_thread_pool();
+
+    if (!ops_.empty()) {
+        if (lanes_ > 1 && threads_.empty()) {
+            for (size_t i = 1; i < lanes_; ++i) threads_.emplace_back([this] { lane_loop(); });
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        current_ = &run;
+        for (ValueId op : ops_) {
+            if (producers_[op] == 0) ready_.push_back(op);
+        }
+        cv_.notify_all();
+
+        // The caller is a lane too
+        while (run.remaining.load() > 0) {
+            if (ready_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            const ValueId op = ready_.front();
+            ready_.pop_front();
+            lock.unlock();
+            execute(run, op);
+            lock.lock();
+        }
+        current_ = nullptr;
+    }
+    runs_.fetch_add(1, std::memory_order_relaxed);
+    if (run.error) std::rethrow_exception(run.error);
+
+    std::vector<Tensor> outputs;
+    for (const auto& out : graph_.outputs()) outputs.push_back(run.values[out.second]);
+    return outputs;
+}
+
+// Runs `op`, then keeps going with the first consumer it makes ready
+void GraphExecutor::execute(Run& run, ValueId op) {
+    std::unique_ptr<CancellationScope> inherited;
+    if (run.cancel_chain) inherited.reset(new CancellationScope(run.cancel_chain));
+    PriorityScope priority(run.priority);
+    PoolScope pool(*run.pool);
+    // Taken where parallel_for would take from the budget
+    std::unique_ptr<BudgetSeat> seat;
+    if (!in_pool_scope() && run.priority != TaskPriority::High) seat.reset(new BudgetSeat());
+    std::vector<const Tensor*> args;
+    std::vector<ValueId> ready;
+
+    while (op != kNoValue) {
+        const Node& node = graph_.node(op);
+        raise_to(peak_, run.active.fetch_add(1) + 1);
+        if (!run.failed.load(std::memory_order_relaxed)) {
+            try {
+                throw_if_cancelled();
+                ParallelismGuard share(shares_[op]);
+                args.clear();
+                for (ValueId v : node.inputs) args.push_back(&run.values[v]);
+                run.values[op] = eval_node(node, args);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(run.error_mutex);
+                if (!run.error) run.error = std::current_exception();
+                run.failed.store(true);
+            }
+        }
+        run.active.fetch_sub(1);
+        ops_run_.fetch_add(1, std::memory_order_relaxed);
+
+        // Inputs whose last consumer this was are released
+        for (ValueId v : node.inputs) {
+            if (!is_leaf(graph_.node(v)) && run.uses[v].fetch_sub(1) == 1) run.values[v] = Tensor();
+        }
+
+        ready.clear();
+        for (ValueId c : consumers_[op]) {
+            if (run.pending[c].fetch_sub(1, std::memory_order_acq_rel) == 1) ready.push_back(c);
+        }
+        const ValueId next = ready.empty() ? kNoValue : ready[0];
+        if (ready.size() > 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.insert(ready_.end(), ready.begin() + 1, ready.end());
+        }
+        for (size_t i = 1; i < ready.size(); ++i) cv_.notify_one();
+
+        // `run` may be gone once the last op has been counted
+        if (run.remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+        op = next;
+    }
+}
+
+void GraphExecutor::lane_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || !ready_.empty(); });
+        if (stop_) return;
+        const ValueId op = ready_.front();
+        ready_.pop_front();
+        Run* run = current_;
+        lock.unlock();
+        execute(*run, op);
+        lock.lock();
+    }
+}
+
+GraphExecutor::Stats GraphExecutor::stats() const {
+    Stats s;
+    s.runs = runs_.load(std::memory_order_relaxed);
+    s.ops = ops_run_.load(std::memory_order_relaxed);
+    s.peak_concurrent_ops = peak_.load(std::memory_order_relaxed);
+    return s;
+}
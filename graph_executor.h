@@ -0,0 +1,93 @@
+#pragma once
+
+#include "graph.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================
+// Inter-op Parallel Graph Executor
+// =============================
+
+// Runs independent ops of a graph (the towers or heads of a wide model)
+// at the same time instead of one after another. Each op waits on an
+// atomic count of unfinished producers; the thread that finishes an op
+// decrements its consumers' counts and runs the first one that becomes
+// ready itself, queueing the rest for the other lanes.
+//
+// Ops run on lanes: the caller plus a few executor threads, one per op the
+// graph can run concurrently. Kernels inside an op still fan out through
+// parallel_for, limited to a share of threads sized by the op's estimated
+// cost, so small ops run inline and large ones spread. A lane holds a
+// BudgetSeat while it runs ops, so it counts against thread_budget() even
+// for inline ops, and the rest of each share is taken from the budget as
+// any parallel_for takes it (neither applies in a named pool or at High
+// priority). The caller's CancellationScope, PriorityScope
+// and PoolScope carry over to the lanes.
+class GraphExecutor {
+public:
+    struct Options {
+        size_t lanes = 0;                     // concurrent ops; 0 = graph width, capped by the budget
+        int64_t cost_per_thread = int64_t(1) << 16; // estimated work worth one more thread
+    };
+
+    struct Stats {
+        size_t runs = 0;
+        size_t ops = 0;
+        size_t peak_concurrent_ops = 0;
+    };
+
+    explicit GraphExecutor(Graph graph);
+    GraphExecutor(Graph graph, const Options& options);
+    ~GraphExecutor();
+
+    GraphExecutor(const GraphExecutor&) = delete;
+    GraphExecutor& operator=(const GraphExecutor&) = delete;
+
+    // Runs the graph and returns its outputs in declaration order. Calls
+    // are serialized; the first exception thrown by an op is rethrown here
+    // once the ops already running have finished.
+    std::vector<Tensor> run(const std::map<std::string, Tensor>& inputs);
+
+    size_t lanes() const { return lanes_; }
+    const Graph& graph() const { return graph_; }
+    Stats stats() const;
+
+private:
+    struct Run;
+
+    void prepare_shares(const std::vector<Tensor>& values);
+    void execute(Run& run, ValueId op);
+    void lane_loop();
+
+    Graph graph_;
+    Options options_;
+    size_t lanes_ = 1;
+
+    // Static dependency structure
+    std::vector<std::vector<ValueId>> consumers_;
+    std::vector<int32_t> producers_;   // op inputs per node, counted per edge
+    std::vector<size_t> uses_;         // graph outputs count as a use
+    std::vector<ValueId> ops_;         // non-leaf nodes
+
+    // Threads allowed per op, recomputed when input shapes change
+    std::vector<size_t> shares_;
+    std::vector<std::vector<int32_t>> share_input_shapes_;
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ValueId> ready_;
+    Run* current_ = nullptr;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+
+    std::atomic<size_t> runs_{0};
+    std::atomic<size_t> ops_run_{0};
+    std::atomic<size_t> peak_{0};
+};
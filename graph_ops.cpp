@@ -0,0 +1,396 @@
+#include "graph_ops.h"
+#include "copy_engine.h"
+#include "parallel.h"
+#include "topology.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+
+// ========================================
+// Helper: shapes and attributes
+// ========================================
+int64_t numel_of(const Shape& s) {
+    int64_t n = 1;
+    for (int32_t d : s.dims) n *= d;
+    return n;
+}
+
+void require(bool ok, const Node& node, const char* what) {
+    if (!ok) throw std::invalid_argument(std::string(op_name(node.op)) + ": " + what);
+}
+
+// {h, w} attribute; a single value applies to both
+std::pair<int32_t, int32_t> pair_attr(const Node& node, const char* key, int32_t fallback) {
+    const std::vector<int64_t> v = node.attrs.get_ints(key);
+    if (v.empty()) return {fallback, fallback};
+    return {static_cast<int32_t>(v[0]), static_cast<int32_t>(v.size() > 1 ? v[1] : v[0])};
+}
+
+Pool2dParams pool_params(const Node& node) {
+    Pool2dParams p;
+    std::tie(p.kernel_h, p.kernel_w) = pair_attr(node, "kernel", 1);
+    std::tie(p.stride_h, p.stride_w) = pair_attr(node, "stride", 0);
+    std::tie(p.pad_h, p.pad_w) = pair_attr(node, "pad", 0);
+    if (p.stride_h <= 0) p.stride_h = p.kernel_h;
+    if (p.stride_w <= 0) p.stride_w = p.kernel_w;
+    p.ceil_mode = node.attrs.get_int("ceil_mode", 0) != 0;
+    p.count_include_pad = node.attrs.get_int("count_include_pad", 1) != 0;
+    return p;
+}
+
+// Target of a Reshape with any -1 resolved
+Shape reshape_target(const Node& node, const Shape& in) {
+    const std::vector<int64_t> target = node.attrs.get_ints("shape");
+    require(!target.empty(), node, "missing 'shape' attribute");
+    Shape out;
+    int64_t known = 1;
+    int infer_at = -1;
+    for (size_t i = 0; i < target.size(); ++i) {
+        if (target[i] == -1) {
+            require(infer_at < 0, node, "more than one -1 in the target shape");
+            infer_at = static_cast<int>(i);
+            out.dims.push_back(1);
+        } else {
+            require(target[i] > 0, node, "target dimensions must be positive");
+            known *= target[i];
+            out.dims.push_back(static_cast<int32_t>(target[i]));
+        }
+    }
+    const int64_t total = numel_of(in);
+    if (infer_at >= 0) {
+        require(known > 0 && total % known == 0, node, "cannot infer the -1 dimension");
+        out.dims[infer_at] = static_cast<int32_t>(total / known);
+    }
+    require(numel_of(out) == total, node, "element count changes");
+    return out;
+}
+
+const float* in_data(const Node& node, const Tensor& t) {
+    require(t.dtype() == Dtype::Float32 && t.is_contiguous(), node,
+            "inputs must be contiguous Float32 tensors");
+    return t.data<float>();
+}
+
+// Per-channel y = x * a[c] + b[c] over (outer, C, inner)
+void channel_affine(const float* x, const std::vector<float>& a, const std::vector<float>& b,
+                    int64_t outer, int64_t C, int64_t inner, float* y) {
+    const int64_t grain = std::max<int64_t>(1, 16384 / std::max<int64_t>(inner, 1));
+    parallel_for(0, outer * C, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const float scale = a[plane % C];
+            const float shift = b[plane % C];
+            const float* src = x + plane * inner;
+            float* dst = y + plane * inner;
+            for (int64_t i = 0; i < inner; ++i) dst[i] = src[i] * scale + shift;
+        }
+    });
+}
+
+// Pins an op's operands while its kernel works on their raw pointers, so
+// that no allocation or cold-storage scan moves them in the meantime.
+// Holds no container, so serving paths stay free of allocations.
+class OperandPins {
+public:
+    OperandPins(const std::vector<const Tensor*>& inputs, const Tensor& out) : inputs_(inputs), out_(out) {
+        for (const Tensor* t : inputs_) {
+            if (t->storage()) t->storage()->pin();
+        }
+        if (out_.storage()) out_.storage()->pin();
+    }
+    ~OperandPins() {
+        for (const Tensor* t : inputs_) {
+            if (t->storage()) t->storage()->unpin();
+        }
+        if (out_.storage()) out_.storage()->unpin();
+    }
+
+    OperandPins(const OperandPins&) = delete;
+    OperandPins& operator=(const OperandPins&) = delete;
+
+private:
+    const std::vector<const Tensor*>& inputs_;
+    const Tensor& out_;
+};
+
+template <typename F>
+void elementwise(int64_t n, F&& f) {
+    parallel_for(0, n, 16384, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) f(i);
+    });
+}
+
+} // namespace
+
+// ========================================
+// Shape inference
+// ========================================
+Shape infer_node_shape(const Node& node, const std::vector<Shape>& in) {
+    const auto rank = [&](size_t i) { return in[i].dims.size(); };
+    switch (node.op) {
+    case OpKind::Input:
+    case OpKind::Constant:
+        throw std::invalid_argument("Input and Constant nodes have no computed shape.");
+    case OpKind::Linear: {
+        require(rank(0) >= 1 && rank(1) == 2, node, "expects x[..., K] and weight[M, K]");
+        const int32_t K = in[0].dims.back();
+        const int32_t M = in[1].dims[0];
+        require(in[1].dims[1] == K, node, "weight columns must match the input features");
+        require(in.size() < 3 || in[2].dims == std::vector<int32_t>{M}, node, "bias must be [M]");
+        Shape out = in[0];
+        out.dims.back() = M;
+        return out;
+    }
+    case OpKind::Conv2d: {
+        require(rank(0) == 4 && rank(1) == 4, node, "expects x[N, C, H, W] and weight[O, C, KH, KW]");
+        const auto& x = in[0].dims;
+        const auto& w = in[1].dims;
+        require(w[1] == x[1], node, "weight channels must match the input channels");
+        require(in.size() < 3 || in[2].dims == std::vector<int32_t>{w[0]}, node, "bias must be [O]");
+        const auto stride = pair_attr(node, "stride", 1);
+        const auto pad = pair_attr(node, "pad", 0);
+        require(stride.first > 0 && stride.second > 0 && pad.first >= 0 && pad.second >= 0, node,
+                "invalid stride or padding");
+        const int64_t oh = (x[2] + 2 * pad.first - w[2]) / stride.first + 1;
+        const int64_t ow = (x[3] + 2 * pad.second - w[3]) / stride.second + 1;
+        require(x[2] + 2 * pad.first >= w[2] && x[3] + 2 * pad.second >= w[3], node,
+                "kernel is larger than the padded input");
+        return Shape({x[0], w[0], static_cast<int32_t>(oh), static_cast<int32_t>(ow)});
+    }
+    case OpKind::BatchNorm:
+    case OpKind::Scale: {
+        require(rank(0) >= 2, node, "expects x[N, C, ...]");
+        const std::vector<int32_t> channels{in[0].dims[1]};
+        for (size_t i = 1; i < in.size(); ++i) {
+            require(in[i].dims == channels, node, "per-channel parameters must be [C]");
+        }
+        return in[0];
+    }
+    case OpKind::Add:
+    case OpKind::Mul:
+        require(in[0].dims == in[1].dims, node, "operands must have the same shape");
+        return in[0];
+    case OpKind::Relu:
+        return in[0];
+    case OpKind::Reshape:
+        return reshape_target(node, in[0]);
+    case OpKind::Transpose: {
+        const std::vector<int64_t> perm = node.attrs.get_ints("perm");
+        require(perm.size() == rank(0), node, "'perm' must have one entry per dimension");
+        std::vector<bool> seen(perm.size(), false);
+        Shape out;
+        for (int64_t p : perm) {
+            require(p >= 0 && p < static_cast<int64_t>(perm.size()) && !seen[p], node,
+                    "'perm' must be a permutation");
+            seen[p] = true;
+            out.dims.push_back(in[0].dims[p]);
+        }
+        return out;
+    }
+    case OpKind::MaxPool2d:
+    case OpKind::AvgPool2d: {
+        require(rank(0) == 4, node, "expects x[N, C, H, W]");
+        const Pool2dParams p = pool_params(node);
+        const auto& x = in[0].dims;
+        return Shape({x[0], x[1],
+                      static_cast<int32_t>(pooled_size(x[2], p.kernel_h, p.stride_h, p.pad_h, p.ceil_mode)),
+                      static_cast<int32_t>(pooled_size(x[3], p.kernel_w, p.stride_w, p.pad_w, p.ceil_mode))});
+    }
+    }
+    throw std::invalid_argument("Unknown op.");
+}
+
+int64_t estimate_node_cost(const Node& node, const std::vector<Shape>& in, const Shape& out) {
+    const int64_t n = numel_of(out);
+    switch (node.op) {
+    case OpKind::Linear:
+        return n * in[0].dims.back();
+    case OpKind::Conv2d:
+        return n * numel_of(in[1]) / in[1].dims[0];
+    case OpKind::MaxPool2d:
+    case OpKind::AvgPool2d: {
+        const Pool2dParams p = pool_params(node);
+        return n * p.kernel_h * p.kernel_w;
+    }
+    default:
+        return n;
+    }
+}
+
+void conv2d_into(const Tensor& x, const Tensor& weight, const Tensor* bias,
+                 std::pair<int32_t, int32_t> stride, std::pair<int32_t, int32_t> pad, Tensor& out) {
+    // Captured as one reference, so the tile task does not allocate
+    const struct {
+        const float* x;
+        const float* w;
+        const float* b;
+        float* y;
+        int64_t C, H, W, O, KH, KW, OH, OW;
+        std::pair<int32_t, int32_t> stride, pad;
+    } conv{x.data<float>(), weight.data<float>(), bias ? bias->data<float>() : nullptr, out.data<float>(),
+           x.shape()[1], x.shape()[2], x.shape()[3],
+           weight.shape()[0], weight.shape()[2], weight.shape()[3],
+           out.shape()[2], out.shape()[3], stride, pad};
+    // Neighbouring planes read the same image, so they stay on cores
+    // sharing a cache
+    parallel_for_tiles(x.shape()[0] * conv.O, [&conv](int64_t begin, int64_t end) {
+        const auto& [x, w, b, y, C, H, W, O, KH, KW, OH, OW, stride, pad] = conv;
+        for (int64_t plane = begin; plane < end; ++plane) {
+            const int64_t n = plane / O, o = plane % O;
+            float* dst = y + plane * OH * OW;
+            std::fill(dst, dst + OH * OW, b ? b[o] : 0.0f);
+            for (int64_t c = 0; c < C; ++c) {
+                const float* src = x + (n * C + c) * H * W;
+                for (int64_t kh = 0; kh < KH; ++kh) {
+                    for (int64_t kw = 0; kw < KW; ++kw) {
+                        const float wv = w[((o * C + c) * KH + kh) * KW + kw];
+                        for (int64_t oh = 0; oh < OH; ++oh) {
+                            const int64_t ih = oh * stride.first - pad.first + kh;
+                            if (ih < 0 || ih >= H) continue;
+                            for (int64_t ow = 0; ow < OW; ++ow) {
+                                const int64_t iw = ow * stride.second - pad.second + kw;
+                                if (iw >= 0 && iw < W) dst[oh * OW + ow] += wv * src[ih * W + iw];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+// ========================================
+// Kernels
+// ========================================
+void compute_node(const Node& node, const std::vector<const Tensor*>& inputs, Tensor& out) {
+    require(out.dtype() == Dtype::Float32 && out.is_contiguous(), node,
+            "output must be a contiguous Float32 tensor");
+    const OperandPins pins(inputs, out);
+    float* y = out.data<float>();
+    const float* x = node.inputs.empty() ? nullptr : in_data(node, *inputs[0]);
+
+    switch (node.op) {
+    case OpKind::Input:
+    case OpKind::Constant:
+        throw std::invalid_argument("Input and Constant nodes are not computed.");
+
+    case OpKind::Linear: {
+        const int64_t K = inputs[0]->shape().back();
+        const int64_t M = inputs[1]->shape()[0];
+        const int64_t rows = static_cast<int64_t>(inputs[0]->numel()) / K;
+        const float* w = in_data(node, *inputs[1]);
+        const float* b = inputs.size() > 2 ? in_data(node, *inputs[2]) : nullptr;
+        const int64_t grain = std::max<int64_t>(1, 32768 / std::max<int64_t>(K * M, 1));
+        parallel_for(0, rows, grain, [&](int64_t begin, int64_t end) {
+            for (int64_t r = begin; r < end; ++r) {
+                const float* xr = x + r * K;
+                for (int64_t m = 0; m < M; ++m) {
+                    const float* wm = w + m * K;
+                    float acc = b ? b[m] : 0.0f;
+                    for (int64_t k = 0; k < K; ++k) acc += xr[k] * wm[k];
+                    y[r * M + m] = acc;
+                }
+            }
+        });
+        return;
+    }
+
+    case OpKind::Conv2d:
+        // conv2d_into takes its operands as given
+        in_data(node, *inputs[1]);
+        if (inputs.size() > 2) in_data(node, *inputs[2]);
+        conv2d_into(*inputs[0], *inputs[1], inputs.size() > 2 ? inputs[2] : nullptr,
+                    pair_attr(node, "stride", 1), pair_attr(node, "pad", 0), out);
+        return;
+
+    case OpKind::BatchNorm:
+    case OpKind::Scale: {
+        const auto& xs = inputs[0]->shape();
+        const int64_t C = xs[1];
+        const int64_t inner = static_cast<int64_t>(inputs[0]->numel()) / (xs[0] * C);
+        std::vector<float> a(C), b(C, 0.0f);
+        if (node.op == OpKind::BatchNorm) {
+            const float* gamma = in_data(node, *inputs[1]);
+            const float* beta = in_data(node, *inputs[2]);
+            const float* mean = in_data(node, *inputs[3]);
+            const float* var = in_data(node, *inputs[4]);
+            const double eps = node.attrs.get_float("eps", 1e-5);
+            for (int64_t c = 0; c < C; ++c) {
+                a[c] = static_cast<float>(gamma[c] / std::sqrt(var[c] + eps));
+                b[c] = beta[c] - mean[c] * a[c];
+            }
+        } else {
+            const float* s = in_data(node, *inputs[1]);
+            std::copy(s, s + C, a.begin());
+            if (inputs.size() > 2) {
+                const float* shift = in_data(node, *inputs[2]);
+                std::copy(shift, shift + C, b.begin());
+            }
+        }
+        channel_affine(x, a, b, xs[0], C, inner, y);
+        return;
+    }
+
+    case OpKind::Add: {
+        const float* x2 = in_data(node, *inputs[1]);
+        elementwise(static_cast<int64_t>(out.numel()), [&](int64_t i) { y[i] = x[i] + x2[i]; });
+        return;
+    }
+    case OpKind::Mul: {
+        const float* x2 = in_data(node, *inputs[1]);
+        elementwise(static_cast<int64_t>(out.numel()), [&](int64_t i) { y[i] = x[i] * x2[i]; });
+        return;
+    }
+    case OpKind::Relu:
+        elementwise(static_cast<int64_t>(out.numel()), [&](int64_t i) { y[i] = x[i] > 0.0f ? x[i] : 0.0f; });
+        return;
+
+    case OpKind::Reshape:
+        tensor_copy(y, x, out.nbytes());
+        return;
+
+    case OpKind::Transpose: {
+        // Walk the output row by row; each row is a strided gather
+        const std::vector<int64_t> perm = node.attrs.get_ints("perm");
+        const auto& in_stride = inputs[0]->stride();
+        const auto& ys = out.shape();
+        const size_t rank = ys.size();
+        const int64_t cols = ys[rank - 1];
+        const int64_t col_stride = in_stride[perm[rank - 1]];
+        const int64_t rows = static_cast<int64_t>(out.numel()) / cols;
+        parallel_for(0, rows, std::max<int64_t>(1, 4096 / cols), [&](int64_t begin, int64_t end) {
+            for (int64_t r = begin; r < end; ++r) {
+                int64_t offset = 0;
+                for (int64_t d = static_cast<int64_t>(rank) - 2, rem = r; d >= 0; --d) {
+                    offset += (rem % ys[d]) * in_stride[perm[d]];
+                    rem /= ys[d];
+                }
+                float* dst = y + r * cols;
+                for (int64_t c = 0; c < cols; ++c) dst[c] = x[offset + c * col_stride];
+            }
+        });
+        return;
+    }
+
+    case OpKind::MaxPool2d:
+    case OpKind::AvgPool2d: {
+        const Pool2dParams p = pool_params(node);
+        if (node.op == OpKind::MaxPool2d) {
+            max_pool2d_into(*inputs[0], p, out);
+        } else {
+            avg_pool2d_into(*inputs[0], p, out);
+        }
+        return;
+    }
+    }
+}
+
+Tensor eval_node(const Node& node, const std::vector<const Tensor*>& inputs) {
+    std::vector<Shape> shapes;
+    shapes.reserve(inputs.size());
+    for (const Tensor* t : inputs) shapes.push_back(Shape(t->shape()));
+    Tensor out(infer_node_shape(node, shapes), Dtype::Float32);
+    compute_node(node, inputs, out);
+    return out;
+}
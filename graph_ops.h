@@ -0,0 +1,33 @@
+#pragma once
+
+#include "graph.h"
+#include <utility>
+#include <vector>
+
+// =============================
+// Graph Op Kernels (Float32)
+// =============================
+
+// Output shape of `node` given the shapes of its inputs. Throws
+// std::invalid_argument when they do not fit the op.
+Shape infer_node_shape(const Node& node, const std::vector<Shape>& input_shapes);
+
+// Computes `node` into `out`, which must already have the shape given by
+// infer_node_shape and must not alias any input, except that the
+// elementwise ops (BatchNorm, Scale, Add, Mul, Relu) may write over their
+// first input. Input and Constant nodes are not computed.
+void compute_node(const Node& node, const std::vector<const Tensor*>& inputs, Tensor& out);
+
+// Rough number of multiply-adds (or element visits) the node performs,
+// used to size its share of threads
+int64_t estimate_node_cost(const Node& node, const std::vector<Shape>& input_shapes,
+                           const Shape& output_shape);
+
+// Direct convolution of x[N, C, H, W] with weight[O, C, KH, KW] and an
+// optional bias[O] into out[N, O, OH, OW], all contiguous Float32 with
+// shapes as infer_node_shape gives them. Strides and padding are {h, w}.
+void conv2d_into(const Tensor& x, const Tensor& weight, const Tensor* bias,
+                 std::pair<int32_t, int32_t> stride, std::pair<int32_t, int32_t> pad, Tensor& out);
+
+// Allocates the output and computes `node` into it
+Tensor eval_node(const Node& node, const std::vector<const Tensor*>& inputs);
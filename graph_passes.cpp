@@ -0,0 +1,265 @@
+#include "graph_passes.h"
+#include "graph_ops.h"
+#include "tensor_hash.h"
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+bool is_leaf(const Node& n) {
+    return n.op == OpKind::Input || n.op == OpKind::Constant;
+}
+
+bool is_constant(const Graph& g, ValueId v) {
+    return v != kNoValue && g.node(v).op == OpKind::Constant;
+}
+
+bool is_identity(const std::vector<int64_t>& perm) {
+    for (size_t i = 0; i < perm.size(); ++i) {
+        if (perm[i] != static_cast<int64_t>(i)) return false;
+    }
+    return true;
+}
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ull;
+}
+
+// Per-channel y = x * a + b equivalent to a BatchNorm or Scale node
+void channel_affine_of(const Graph& g, const Node& n, std::vector<float>& a, std::vector<float>& b) {
+    const size_t C = g.node(n.inputs[1]).value.numel();
+    a.assign(C, 1.0f);
+    b.assign(C, 0.0f);
+    std::vector<StoragePin> keep;
+    for (size_t k = 1; k < n.inputs.size(); ++k) keep.push_back(g.node(n.inputs[k]).value.pin());
+    if (n.op == OpKind::BatchNorm) {
+        const float* gamma = g.node(n.inputs[1]).value.data<float>();
+        const float* beta = g.node(n.inputs[2]).value.data<float>();
+        const float* mean = g.node(n.inputs[3]).value.data<float>();
+        const float* var = g.node(n.inputs[4]).value.data<float>();
+        const double eps = n.attrs.get_float("eps", 1e-5);
+        for (size_t c = 0; c < C; ++c) {
+            a[c] = static_cast<float>(gamma[c] / std::sqrt(var[c] + eps));
+            b[c] = beta[c] - mean[c] * a[c];
+        }
+        return;
+    }
+    const float* s = g.node(n.inputs[1]).value.data<float>();
+    std::copy(s, s + C, a.begin());
+    if (n.inputs.size() > 2) {
+        const float* shift = g.node(n.inputs[2]).value.data<float>();
+        std::copy(shift, shift + C, b.begin());
+    }
+}
+
+} // namespace
+
+// ========================================
+// Constant folding
+// ========================================
+size_t fold_constants(Graph& graph) {
+    size_t folded = 0;
+    std::vector<const Tensor*> args;
+    for (size_t i = 0; i < graph.size(); ++i) {
+        Node& n = graph.node(static_cast<ValueId>(i));
+        if (is_leaf(n)) continue;
+        bool constant = true;
+        for (ValueId v : n.inputs) constant = constant && is_constant(graph, v);
+        if (!constant) continue;
+
+        args.clear();
+        for (ValueId v : n.inputs) args.push_back(&graph.node(v).value);
+        n.value = eval_node(n, args);
+        n.name = std::string(op_name(n.op)) + "." + std::to_string(i);
+        n.op = OpKind::Constant;
+        n.inputs.clear();
+        n.attrs = Attributes();
+        ++folded;
+    }
+    return folded;
+}
+
+// ========================================
+// Common subexpression elimination
+// ========================================
+size_t eliminate_common_subexpressions(Graph& graph) {
+    const size_t n = graph.size();
+    std::vector<ValueId> canon(n);
+    for (size_t i = 0; i < n; ++i) canon[i] = static_cast<ValueId>(i);
+    size_t merged = 0;
+
+    // Constants first: ops may refer to constants appended after them
+    std::unordered_map<uint64_t, std::vector<ValueId>> seen;
+    for (size_t i = 0; i < n; ++i) {
+        const Node& c = graph.node(static_cast<ValueId>(i));
+        if (c.op != OpKind::Constant) continue;
+        std::vector<ValueId>& bucket = seen[hash_tensor(c.value)];
+        for (ValueId other : bucket) {
+            if (tensor_content_equal(graph.node(other).value, c.value)) {
+                canon[i] = other;
+                ++merged;
+                break;
+            }
+        }
+        if (canon[i] == static_cast<ValueId>(i)) bucket.push_back(static_cast<ValueId>(i));
+    }
+
+    // Ops in order, so inputs are canonical before their users are keyed
+    seen.clear();
+    for (size_t i = 0; i < n; ++i) {
+        Node& node = graph.node(static_cast<ValueId>(i));
+        if (is_leaf(node)) continue;
+        uint64_t h = mix(0xcbf29ce484222325ull, static_cast<uint64_t>(node.op));
+        for (ValueId& v : node.inputs) {
+            v = canon[v];
+            h = mix(h, static_cast<uint64_t>(v));
+        }
+        std::vector<ValueId>& bucket = seen[h];
+        for (ValueId other : bucket) {
+            const Node& o = graph.node(other);
+            if (o.op == node.op && o.inputs == node.inputs && o.attrs == node.attrs) {
+                canon[i] = other;
+                ++merged;
+                break;
+            }
+        }
+        if (canon[i] == static_cast<ValueId>(i)) bucket.push_back(static_cast<ValueId>(i));
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (canon[i] != static_cast<ValueId>(i)) graph.replace_uses(static_cast<ValueId>(i), canon[i]);
+    }
+    return merged;
+}
+
+// ========================================
+// BatchNorm / Scale folding
+// ========================================
+size_t fold_normalizations(Graph& graph) {
+    const std::vector<Shape> shapes = infer_shapes(graph);
+    std::vector<size_t> uses = graph.use_counts();
+    size_t folded = 0;
+
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        const Node& norm = graph.node(static_cast<ValueId>(i));
+        if (norm.op != OpKind::BatchNorm && norm.op != OpKind::Scale) continue;
+        const ValueId x = norm.inputs[0];
+        const Node& producer = graph.node(x);
+        if (producer.op != OpKind::Linear && producer.op != OpKind::Conv2d) continue;
+        if (uses[x] != 1) continue;
+        bool constant = is_constant(graph, producer.inputs[1]) &&
+                        (producer.inputs.size() < 3 || is_constant(graph, producer.inputs[2]));
+        for (size_t k = 1; k < norm.inputs.size(); ++k) constant = constant && is_constant(graph, norm.inputs[k]);
+        if (!constant) continue;
+        // Per-channel ops act on dimension 1, which for Linear is the
+        // feature dimension only on 2D outputs
+        if (producer.op == OpKind::Linear && shapes[x].dims.size() != 2) continue;
+
+        std::vector<float> a, b;
+        channel_affine_of(graph, norm, a, b);
+        const Tensor& weight = graph.node(producer.inputs[1]).value;
+        const size_t channels = static_cast<size_t>(weight.shape()[0]);
+        if (a.size() != channels) continue;
+
+        // W'[o] = W[o] * a[o], bias' = bias * a + b
+        Tensor w(Shape(weight.shape()), Dtype::Float32);
+        const size_t row = weight.numel() / channels;
+        const StoragePin keep_weight = weight.pin();
+        const float* src = weight.data<float>();
+        float* dst = w.data<float>();
+        for (size_t o = 0; o < channels; ++o) {
+            for (size_t k = 0; k < row; ++k) dst[o * row + k] = src[o * row + k] * a[o];
+        }
+        Tensor bias(Shape({static_cast<int32_t>(channels)}), Dtype::Float32);
+        const StoragePin keep_bias = producer.inputs.size() > 2 ? graph.node(producer.inputs[2]).value.pin()
+                                                                : StoragePin(nullptr);
+        const float* old_bias = producer.inputs.size() > 2 ? graph.node(producer.inputs[2]).value.data<float>() : nullptr;
+        float* new_bias = bias.data<float>();
+        for (size_t o = 0; o < channels; ++o) new_bias[o] = (old_bias ? old_bias[o] * a[o] : 0.0f) + b[o];
+
+        std::string base = graph.node(producer.inputs[1]).name;
+        const std::string suffix = ".folded";
+        if (base.size() > suffix.size() && base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            base.resize(base.size() - suffix.size());
+        }
+        const ValueId w_id = graph.constant(base + ".folded", std::move(w));
+        const ValueId b_id = graph.constant(base + ".folded_bias", std::move(bias));
+        // The constants may have moved the nodes; look them up again
+        Node& p = graph.node(x);
+        p.inputs.resize(3);
+        p.inputs[1] = w_id;
+        p.inputs[2] = b_id;
+        graph.replace_uses(static_cast<ValueId>(i), x);
+        uses[x] = uses[i]; // the norm was its only user
+        ++folded;
+    }
+    return folded;
+}
+
+// ========================================
+// Layout no-ops
+// ========================================
+size_t remove_layout_noops(Graph& graph) {
+    const std::vector<Shape> shapes = infer_shapes(graph);
+    size_t removed = 0;
+
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        Node& n = graph.node(static_cast<ValueId>(i));
+        if (n.op != OpKind::Transpose && n.op != OpKind::Reshape) continue;
+
+        // transpose(transpose(x, p), q) == transpose(x, p o q), and a
+        // reshape of a reshape only needs the outer target
+        bool changed = false;
+        const Node& inner = graph.node(n.inputs[0]);
+        if (inner.op == n.op) {
+            if (n.op == OpKind::Transpose) {
+                const std::vector<int64_t> p = inner.attrs.get_ints("perm");
+                std::vector<int64_t> q = n.attrs.get_ints("perm");
+                for (int64_t& axis : q) axis = p[axis];
+                n.attrs.ints["perm"] = q;
+            }
+            n.inputs[0] = inner.inputs[0];
+            changed = true;
+        }
+
+        const ValueId in = n.inputs[0];
+        bool noop = false;
+        if (n.op == OpKind::Transpose) {
+            noop = is_identity(n.attrs.get_ints("perm"));
+        } else if (!shapes[in].dims.empty() && !shapes[i].dims.empty()) {
+            noop = shapes[in].dims == shapes[i].dims;
+        }
+        if (noop) {
+            graph.replace_uses(static_cast<ValueId>(i), in);
+            changed = true;
+        }
+        if (changed) ++removed;
+    }
+    return removed;
+}
+
+size_t eliminate_dead_nodes(Graph& graph) {
+    return graph.compact();
+}
+
+// ========================================
+// Pipeline
+// ========================================
+OptimizeStats optimize_graph(Graph& graph) {
+    graph.validate();
+    OptimizeStats stats;
+    for (;;) {
+        ++stats.iterations;
+        const size_t constants = fold_constants(graph);
+        const size_t layout = remove_layout_noops(graph);
+        const size_t norms = fold_normalizations(graph);
+        const size_t duplicates = eliminate_common_subexpressions(graph);
+        stats.constants_folded += constants;
+        stats.layout_ops_removed += layout;
+        stats.norms_folded += norms;
+        stats.duplicates_removed += duplicates;
+        stats.dead_removed += eliminate_dead_nodes(graph);
+        if (constants + layout + norms + duplicates == 0) break;
+    }
+    return stats;
+}
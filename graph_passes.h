@@ -0,0 +1,42 @@
+#pragma once
+
+#include "graph.h"
+
+// =============================
+// Graph Optimizer
+// =============================
+
+struct OptimizeStats {
+    size_t constants_folded = 0;
+    size_t duplicates_removed = 0;
+    size_t norms_folded = 0;
+    size_t layout_ops_removed = 0;
+    size_t dead_removed = 0;
+    size_t iterations = 0;
+};
+
+// Each pass returns the number of nodes it rewrote or bypassed. Bypassed
+// nodes stay in the graph until eliminate_dead_nodes() drops them.
+
+// Replaces ops whose inputs are all constants by their computed value
+size_t fold_constants(Graph& graph);
+
+// Merges constants with identical contents and ops with identical op,
+// attributes and inputs
+size_t eliminate_common_subexpressions(Graph& graph);
+
+// Folds inference BatchNorm and Scale ops into the weights and bias of the
+// Linear or Conv2d op feeding them, when that op has constant weights and
+// no other users
+size_t fold_normalizations(Graph& graph);
+
+// Bypasses identity transposes and reshapes to the input's own shape, and
+// merges chains of transposes or reshapes into one op
+size_t remove_layout_noops(Graph& graph);
+
+// Drops values no output depends on; same as Graph::compact()
+size_t eliminate_dead_nodes(Graph& graph);
+
+// Runs all passes until none changes the graph, then compacts it. Pay this
+// once: save_graph() the result and load_graph() it at model load.
+OptimizeStats optimize_graph(Graph& graph);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+// =============================
+// Index Width Dispatch
+// =============================
+
+// True when every linear offset below `extent` fits a signed 32-bit index
+inline bool fits_int32_index(int64_t extent) {
+    return extent <= static_cast<int64_t>(std::numeric_limits<int32_t>::max());
+}
+
+// Calls fn(IndexT{}) with IndexT = int32_t when `extent` (one past the
+// largest linear offset the op computes) fits in 32 bits, and int64_t
+// otherwise. Ops decide once at entry and instantiate their loops for both
+// widths, so the common small-tensor case gets cheaper address arithmetic
+// and 32-bit index lanes (16 per AVX-512 gather instead of 8).
+template <typename F>
+decltype(auto) dispatch_index_type(int64_t extent, F&& fn) {
+    if (fits_int32_index(extent)) return std::forward<F>(fn)(int32_t{});
+    return std::forward<F>(fn)(int64_t{});
+}
@@ -0,0 +1,257 @@
+#include "isa_dispatch.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TENSOR_HAVE_X86 1
+#endif
+
+namespace {
+
+// Ops below this size never use AVX-512 and never trigger calibration
+constexpr int64_t kMinCandidateBytes = int64_t(32) << 10;
+constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+constexpr int64_t kUnset = -1;
+
+// ========================================
+// Helper: Environment overrides
+// ========================================
+IsaLevel env_isa_cap() {
+    const char* env = std::getenv("TENSOR_ISA");
+    if (!env || std::strcmp(env, "auto") == 0) return IsaLevel::Avx512;
+    if (std::strcmp(env, "scalar") == 0) return IsaLevel::Scalar;
+    if (std::strcmp(env, "avx2") == 0) return IsaLevel::Avx2;
+    if (std::strcmp(env, "avx512") == 0) return IsaLevel::Avx512;
+    std::fprintf(stderr, "TENSOR_ISA=%s not recognised, using auto\n", env);
+    return IsaLevel::Avx512;
+}
+
+bool isa_verbose() {
+    static const bool verbose = std::getenv("TENSOR_ISA_VERBOSE") != nullptr;
+    return verbose;
+}
+
+// ========================================
+// Helper: Counter registry
+// ========================================
+struct Registry {
+    std::mutex mutex;
+    std::vector<IsaCounter*> counters;
+};
+
+Registry& registry() {
+    static Registry* r = new Registry; // outlives counters in other TUs
+    return *r;
+}
+
+// ========================================
+// Calibration
+// ========================================
+// Cost model: AVX-512 is worth it once the time it saves per byte, times
+// the op size, exceeds the fixed cost of a license transition (the stall
+// on the first wide instruction plus the slower scalar code afterwards).
+#ifdef TENSOR_HAVE_X86
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+__attribute__((target("avx2")))
+void sum_pass_avx2(const float* x, float* acc, size_t n) {
+    for (size_t i = 0; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_loadu_ps(x + i)));
+    }
+}
+
+__attribute__((target("avx512f")))
+void sum_pass_avx512(const float* x, float* acc, size_t n) {
+    for (size_t i = 0; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(acc + i, _mm512_add_ps(_mm512_loadu_ps(acc + i), _mm512_loadu_ps(x + i)));
+    }
+}
+
+// Dependent integer chain: runs at whatever frequency the core is at
+uint64_t scalar_work(uint64_t seed) {
+    for (int i = 0; i < 20000; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+    }
+    return seed;
+}
+
+template <typename F>
+double best_of(int reps, F&& fn) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int r = 0; r < reps; ++r) best = std::min(best, fn());
+    return best;
+}
+
+int64_t calibrate_threshold() {
+    constexpr size_t kFloats = size_t(16) << 10; // 64 KiB per buffer, L2 resident
+    constexpr int kReps = 5;
+    // Long enough for the core to return to its scalar license
+    const auto settle = [] { std::this_thread::sleep_for(std::chrono::milliseconds(3)); };
+
+    std::vector<float> x(kFloats, 1.0f), acc(kFloats, 0.0f);
+    volatile uint64_t sink = 0;
+
+    const double scalar_base = best_of(kReps, [&] {
+        settle();
+        const auto t = Clock::now();
+        sink = scalar_work(sink + 1);
+        return elapsed_ns(t);
+    });
+    std::vector<double> firsts, afters;
+    for (int r = 0; r < kReps; ++r) {
+        settle();
+        auto t = Clock::now();
+        sum_pass_avx512(x.data(), acc.data(), kFloats);
+        firsts.push_back(elapsed_ns(t));
+        t = Clock::now();
+        sink = scalar_work(sink + 1);
+        afters.push_back(elapsed_ns(t));
+    }
+    std::sort(firsts.begin(), firsts.end());
+    std::sort(afters.begin(), afters.end());
+    const double first_512 = firsts[kReps / 2];
+    const double scalar_after = afters[kReps / 2];
+
+    const double hot_512 = best_of(kReps * 4, [&] {
+        const auto t = Clock::now();
+        sum_pass_avx512(x.data(), acc.data(), kFloats);
+        return elapsed_ns(t);
+    });
+    const double hot_256 = best_of(kReps * 4, [&] {
+        const auto t = Clock::now();
+        sum_pass_avx2(x.data(), acc.data(), kFloats);
+        return elapsed_ns(t);
+    });
+
+    const double bytes = static_cast<double>(2 * kFloats * sizeof(float));
+    const double penalty_ns = std::max(0.0, first_512 - hot_512) +
+                              std::max(0.0, scalar_after - scalar_base);
+    const double saved_per_byte = (hot_256 - hot_512) / bytes;
+
+    int64_t threshold = kNever;
+    if (saved_per_byte > 0.0) {
+        threshold = std::max(kMinCandidateBytes,
+                             static_cast<int64_t>(std::min(penalty_ns / saved_per_byte, 1e15)));
+    }
+    if (isa_verbose()) {
+        std::fprintf(stderr,
+                     "isa calibration: transition %.0f ns, avx2 %.3f ns/KiB, avx512 %.3f ns/KiB, "
+                     "avx512 from %lld bytes\n",
+                     penalty_ns, hot_256 / bytes * 1024.0, hot_512 / bytes * 1024.0,
+                     static_cast<long long>(threshold));
+    }
+    return threshold;
+}
+#else
+int64_t calibrate_threshold() { return kNever; }
+#endif
+
+// Holds kUnset until calibrated, unless the environment fixes the value
+std::atomic<int64_t>& threshold_slot() {
+    static std::atomic<int64_t> slot{[] {
+        const char* env = std::getenv("TENSOR_AVX512_MIN_BYTES");
+        return env ? std::max<int64_t>(0, std::strtoll(env, nullptr, 10)) : kUnset;
+    }()};
+    return slot;
+}
+
+} // namespace
+
+// ========================================
+// IsaCounter
+// ========================================
+IsaCounter::IsaCounter(const char* op) : op_(op) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.counters.push_back(this);
+}
+
+void IsaCounter::reset() {
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+}
+
+// ========================================
+// Selection
+// ========================================
+const char* isa_name(IsaLevel level) {
+    switch (level) {
+        case IsaLevel::Scalar: return "scalar";
+        case IsaLevel::Avx2: return "avx2";
+        case IsaLevel::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+IsaLevel max_isa_level() {
+    static const IsaLevel level = [] {
+        const CpuFeatures& f = cpu_features();
+        IsaLevel supported = IsaLevel::Scalar;
+        if (f.avx2 && f.fma) supported = IsaLevel::Avx2;
+        if (supported == IsaLevel::Avx2 && f.avx512f) supported = IsaLevel::Avx512;
+        return std::min(supported, env_isa_cap());
+    }();
+    return level;
+}
+
+int64_t avx512_threshold_bytes() {
+    std::atomic<int64_t>& slot = threshold_slot();
+    int64_t t = slot.load(std::memory_order_acquire);
+    if (t != kUnset) return t;
+    static std::once_flag once;
+    std::call_once(once, [&] {
+        const int64_t measured = calibrate_threshold();
+        int64_t expected = kUnset;
+        slot.compare_exchange_strong(expected, measured, std::memory_order_acq_rel);
+    });
+    return slot.load(std::memory_order_acquire);
+}
+
+void set_avx512_threshold_bytes(int64_t bytes) {
+    threshold_slot().store(std::max<int64_t>(0, bytes), std::memory_order_release);
+}
+
+IsaLevel select_isa(IsaCounter& counter, int64_t work_bytes) {
+    IsaLevel level = max_isa_level();
+    if (level == IsaLevel::Avx512) {
+        // Small ops decide without forcing a calibration run
+        const int64_t known = threshold_slot().load(std::memory_order_acquire);
+        const int64_t threshold = known != kUnset ? known
+                                  : work_bytes < kMinCandidateBytes ? kNever
+                                                                    : avx512_threshold_bytes();
+        if (work_bytes < threshold) level = IsaLevel::Avx2;
+    }
+    counter.record(level);
+    return level;
+}
+
+std::vector<IsaUsage> isa_usage() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<IsaUsage> out;
+    out.reserve(r.counters.size());
+    for (const IsaCounter* c : r.counters) {
+        out.push_back({c->op(), c->count(IsaLevel::Scalar), c->count(IsaLevel::Avx2),
+                       c->count(IsaLevel::Avx512)});
+    }
+    return out;
+}
+
+void reset_isa_usage() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (IsaCounter* c : r.counters) c->reset();
+}
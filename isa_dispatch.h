@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =============================
+// ISA Selection
+// =============================
+
+// Vector instruction sets a kernel can be dispatched to, narrowest first
+enum class IsaLevel { Scalar, Avx2, Avx512 };
+
+const char* isa_name(IsaLevel level);
+
+// Per-op record of which ISA each call ran with. Declare one as a
+// function-local static next to the kernel; it registers itself so the
+// counts show up in isa_usage().
+class IsaCounter {
+public:
+    explicit IsaCounter(const char* op);
+    IsaCounter(const IsaCounter&) = delete;
+    IsaCounter& operator=(const IsaCounter&) = delete;
+
+    const char* op() const { return op_; }
+    void record(IsaLevel level) { counts_[static_cast<int>(level)].fetch_add(1, std::memory_order_relaxed); }
+    uint64_t count(IsaLevel level) const { return counts_[static_cast<int>(level)].load(std::memory_order_relaxed); }
+    void reset();
+
+private:
+    const char* op_;
+    std::atomic<uint64_t> counts_[3] = {};
+};
+
+// Widest ISA that kernels may use: what the CPU supports, capped by the
+// TENSOR_ISA environment variable (scalar, avx2, avx512 or auto)
+IsaLevel max_isa_level();
+
+// Picks the ISA for one call of `op` that touches `work_bytes`. AVX-512 can
+// drop the core into a lower frequency license, which also slows the scalar
+// code that follows, so it is only used when the op is large enough for the
+// wider vectors to win back that cost; smaller ops stay on AVX2. The size
+// cut-off comes from TENSOR_AVX512_MIN_BYTES or, failing that, from a short
+// calibration run the first time an op is big enough to be a candidate.
+IsaLevel select_isa(IsaCounter& counter, int64_t work_bytes);
+
+// Smallest op (bytes touched) that is dispatched to AVX-512
+int64_t avx512_threshold_bytes();
+void set_avx512_threshold_bytes(int64_t bytes);
+
+// Snapshot of the per-op counters, for profiler output
+struct IsaUsage {
+    std::string op;
+    uint64_t scalar = 0;
+    uint64_t avx2 = 0;
+    uint64_t avx512 = 0;
+};
+
+std::vector<IsaUsage> isa_usage();
+void reset_isa_usage();
@@ -0,0 +1,388 @@
+#include "model_runtime.h"
+#include "cancellation.h"
+#include "copy_engine.h"
+#include "cpu_features.h"
+#include "graph_ops.h"
+#include "parallel.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <tuple>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TENSOR_HAVE_X86 1
+#endif
+
+namespace {
+
+constexpr size_t kBufferAlignment = 64;
+
+bool is_leaf(const Node& n) {
+    return n.op == OpKind::Input || n.op == OpKind::Constant;
+}
+
+size_t byte_size(const Shape& s) {
+    size_t n = sizeof(float);
+    for (int32_t d : s.dims) n *= static_cast<size_t>(d);
+    return (n + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment;
+}
+
+// Ops that read element i only to write element i, so they can run in place
+bool is_elementwise(OpKind op) {
+    return op == OpKind::Add || op == OpKind::Mul || op == OpKind::Relu ||
+           op == OpKind::BatchNorm || op == OpKind::Scale;
+}
+
+// ========================================
+// Helper: dot products per ISA
+// ========================================
+using DotFn = float (*)(const float*, const float*, int64_t);
+
+float dot_scalar(const float* a, const float* b, int64_t n) {
+    float acc = 0.0f;
+    for (int64_t i = 0; i < n; ++i) acc += a[i] * b[i];
+    return acc;
+}
+
+#ifdef TENSOR_HAVE_X86
+const float kOnes[16] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+__attribute__((target("avx2,fma")))
+float dot_avx2(const float* a, const float* b, int64_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    int64_t i = 0;
+    for (; i + 8 <= n; i += 8) acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, half);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+float dot_avx512(const float* a, const float* b, int64_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    int64_t i = 0;
+    for (; i + 16 <= n; i += 16) acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+    float lanes[16];
+    _mm512_storeu_ps(lanes, acc);
+    return dot_scalar(lanes, kOnes, 16) + dot_scalar(a + i, b + i, n - i);
+}
+#endif
+
+DotFn dot_kernel(IsaLevel isa) {
+#ifdef TENSOR_HAVE_X86
+    if (isa == IsaLevel::Avx512) return dot_avx512;
+    if (isa == IsaLevel::Avx2) return dot_avx2;
+#endif
+    (void)isa;
+    return dot_scalar;
+}
+
+} // namespace
+
+// ========================================
+// Loading and planning
+// ========================================
+ModelRuntime::ModelRuntime(const std::string& path, const std::map<std::string, Shape>& input_shapes)
+    : ModelRuntime(load_graph(path, WeightLoading::Map), input_shapes) {}
+
+ModelRuntime::ModelRuntime(Graph graph, const std::map<std::string, Shape>& input_shapes)
+    : graph_(std::move(graph)) {
+    plan(input_shapes);
+}
+
+void ModelRuntime::plan(const std::map<std::string, Shape>& input_shapes) {
+    graph_.validate();
+    graph_.compact();
+    const size_t n = graph_.size();
+
+    // Fix the input shapes, then every other shape follows
+    size_t matched = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Node& node = graph_.node(static_cast<ValueId>(i));
+        if (node.op == OpKind::Constant && node.value.dtype() != Dtype::Float32) {
+            throw std::invalid_argument("Model constant '" + node.name + "' must be Float32.");
+        }
+        if (node.op != OpKind::Input) continue;
+        input_ids_.push_back(static_cast<ValueId>(i));
+        input_names_.push_back(node.name);
+        auto it = input_shapes.find(node.name);
+        if (it == input_shapes.end()) continue;
+        ++matched;
+        const std::vector<int64_t> declared = node.attrs.get_ints("shape");
+        const std::vector<int64_t> fixed(it->second.dims.begin(), it->second.dims.end());
+        if (!declared.empty() && declared != fixed) {
+            throw std::invalid_argument("Shape given for model input '" + node.name + "' differs from its declared shape.");
+        }
+        node.attrs.ints["shape"] = fixed;
+    }
+    if (matched != input_shapes.size()) throw std::invalid_argument("Shape given for an unknown model input.");
+    const std::vector<Shape> shapes = infer_shapes(graph_);
+    for (ValueId id : input_ids_) {
+        if (shapes[id].dims.empty()) {
+            throw std::invalid_argument("Model input '" + graph_.node(id).name + "' needs a fixed shape.");
+        }
+    }
+
+    // Liveness in steps; inputs and outputs span the whole run
+    const int last_step = INT_MAX;
+    std::vector<int> step_of(n, -1), last_use(n, -1);
+    int steps = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (is_leaf(node)) continue;
+        step_of[i] = steps;
+        for (ValueId v : node.inputs) last_use[v] = steps;
+        ++steps;
+    }
+    for (ValueId id : input_ids_) last_use[id] = last_step;
+    for (const auto& out : graph_.outputs()) last_use[out.second] = last_step;
+
+    // Buffers; a view or an in-place op joins its input's buffer
+    struct Buffer {
+        size_t bytes;
+        int start, end;
+        size_t offset = 0;
+    };
+    std::vector<Buffer> buffers;
+    std::vector<int> buffer_of(n, -1);
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (node.op == OpKind::Constant) {
+            stats_.weight_bytes += node.value.nbytes();
+            weight_pins_.push_back(node.value.pin());
+            continue;
+        }
+        const int first = node.inputs.empty() ? -1 : buffer_of[node.inputs[0]];
+        const bool view = node.op == OpKind::Reshape && first >= 0;
+        const bool in_place = !view && is_elementwise(node.op) && first >= 0 &&
+                              buffers[first].end == step_of[i] && buffers[first].bytes == byte_size(shapes[i]);
+        if (view || in_place) {
+            buffer_of[i] = first;
+            buffers[first].end = std::max(buffers[first].end, last_use[i]);
+            if (view) {
+                ++stats_.views;
+            } else {
+                ++stats_.in_place;
+                stats_.unplanned_bytes += byte_size(shapes[i]);
+            }
+            continue;
+        }
+        buffer_of[i] = static_cast<int>(buffers.size());
+        buffers.push_back({byte_size(shapes[i]), std::max(step_of[i], 0), std::max(last_use[i], step_of[i])});
+        stats_.unplanned_bytes += buffers.back().bytes;
+    }
+
+    // Largest first, each at the lowest offset clear of every placed buffer
+    // whose lifetime overlaps its own
+    std::vector<size_t> order(buffers.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return buffers[a].bytes > buffers[b].bytes; });
+    std::vector<size_t> placed;
+    for (size_t b : order) {
+        Buffer& buf = buffers[b];
+        std::vector<std::pair<size_t, size_t>> taken;
+        for (size_t p : placed) {
+            const Buffer& other = buffers[p];
+            if (other.start <= buf.end && buf.start <= other.end) {
+                taken.emplace_back(other.offset, other.offset + other.bytes);
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+        size_t offset = 0;
+        for (const auto& range : taken) {
+            if (offset + buf.bytes <= range.first) break;
+            offset = std::max(offset, range.second);
+        }
+        buf.offset = offset;
+        stats_.arena_bytes = std::max(stats_.arena_bytes, offset + buf.bytes);
+        placed.push_back(b);
+    }
+
+    const size_t floats = stats_.arena_bytes / sizeof(float);
+    if (floats > static_cast<size_t>(INT32_MAX)) throw std::invalid_argument("Model activations do not fit one arena.");
+    if (floats > 0) arena_ = Tensor(Shape({static_cast<int32_t>(floats)}), Dtype::Float32);
+    char* base = floats > 0 ? arena_.data<char>() : nullptr;
+    values_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (node.op == OpKind::Constant) {
+            values_[i] = node.value.is_contiguous() ? node.value : node.value.clone();
+        } else {
+            values_[i] = Tensor::from_blob(base + buffers[buffer_of[i]].offset, shapes[i], Stride(), Dtype::Float32);
+        }
+    }
+
+    steps_.reserve(static_cast<size_t>(steps));
+    for (size_t i = 0; i < n; ++i) {
+        const Node& node = graph_.node(static_cast<ValueId>(i));
+        if (is_leaf(node)) continue;
+        if (node.op == OpKind::Reshape && buffer_of[i] == buffer_of[node.inputs[0]]) continue;
+        Step step;
+        step.node = &node;
+        for (ValueId v : node.inputs) step.inputs.push_back(&values_[v]);
+        step.output = &values_[i];
+        bind(step, shapes);
+        steps_.push_back(std::move(step));
+    }
+    stats_.steps = steps_.size();
+
+    for (const auto& out : graph_.outputs()) {
+        output_names_.push_back(out.first);
+        outputs_.push_back(values_[out.second]);
+    }
+}
+
+// Picks the kernel for one node
+void ModelRuntime::bind(Step& step, const std::vector<Shape>& shapes) {
+    const Node& node = *step.node;
+    const Shape& x = shapes[node.inputs[0]];
+    int64_t numel = 1;
+    for (int32_t d : x.dims) numel *= d;
+
+    if (node.op == OpKind::Linear) {
+        static IsaCounter counter("model_runtime.linear");
+        step.kernel = Kernel::Linear;
+        step.inner = x.dims.back();
+        step.channels = shapes[node.inputs[1]].dims[0];
+        step.rows = numel / step.inner;
+        const int64_t work = (step.rows + step.channels) * step.inner * static_cast<int64_t>(sizeof(float));
+        step.isa = select_isa(counter, work);
+        if (step.isa == IsaLevel::Avx2 && !cpu_features().fma) step.isa = IsaLevel::Scalar;
+        return;
+    }
+
+    // Attributes are read once here rather than on every request
+    const auto pair = [&](const char* key, int32_t fallback) {
+        const std::vector<int64_t> v = node.attrs.get_ints(key);
+        if (v.empty()) return std::make_pair(fallback, fallback);
+        return std::make_pair(static_cast<int32_t>(v[0]), static_cast<int32_t>(v.size() > 1 ? v[1] : v[0]));
+    };
+    if (node.op == OpKind::Conv2d) {
+        step.kernel = Kernel::Conv2d;
+        std::tie(step.window.stride_h, step.window.stride_w) = pair("stride", 1);
+        std::tie(step.window.pad_h, step.window.pad_w) = pair("pad", 0);
+        return;
+    }
+    if (node.op == OpKind::MaxPool2d || node.op == OpKind::AvgPool2d) {
+        step.kernel = node.op == OpKind::MaxPool2d ? Kernel::MaxPool2d : Kernel::AvgPool2d;
+        Pool2dParams p;
+        std::tie(p.kernel_h, p.kernel_w) = pair("kernel", 1);
+        std::tie(p.stride_h, p.stride_w) = pair("stride", 0);
+        std::tie(p.pad_h, p.pad_w) = pair("pad", 0);
+        if (p.stride_h <= 0) p.stride_h = p.kernel_h;
+        if (p.stride_w <= 0) p.stride_w = p.kernel_w;
+        p.ceil_mode = node.attrs.get_int("ceil_mode", 0) != 0;
+        p.count_include_pad = node.attrs.get_int("count_include_pad", 1) != 0;
+        step.pool = plan_pool2d(x, p);
+        return;
+    }
+
+    // BatchNorm and Scale with constant parameters become y = x * a + b
+    bool constant_params = node.op == OpKind::BatchNorm || node.op == OpKind::Scale;
+    for (size_t k = 1; constant_params && k < node.inputs.size(); ++k) {
+        constant_params = graph_.node(node.inputs[k]).op == OpKind::Constant;
+    }
+    if (!constant_params) return;
+    step.kernel = Kernel::ChannelAffine;
+    step.channels = x.dims[1];
+    step.rows = static_cast<int64_t>(x.dims[0]) * step.channels;
+    step.inner = numel / std::max<int64_t>(step.rows, 1);
+    step.scale.assign(static_cast<size_t>(step.channels), 1.0f);
+    step.shift.assign(static_cast<size_t>(step.channels), 0.0f);
+    const auto param = [&](size_t k) { return step.inputs[k]->data<float>(); };
+    if (node.op == OpKind::BatchNorm) {
+        const double eps = node.attrs.get_float("eps", 1e-5);
+        for (int64_t c = 0; c < step.channels; ++c) {
+            step.scale[c] = static_cast<float>(param(1)[c] / std::sqrt(param(4)[c] + eps));
+            step.shift[c] = param(2)[c] - param(3)[c] * step.scale[c];
+        }
+    } else {
+        std::copy(param(1), param(1) + step.channels, step.scale.begin());
+        if (node.inputs.size() > 2) std::copy(param(2), param(2) + step.channels, step.shift.begin());
+    }
+}
+
+// ========================================
+// Requests
+// ========================================
+Tensor& ModelRuntime::input(const std::string& name) {
+    for (size_t i = 0; i < input_ids_.size(); ++i) {
+        if (input_names_[i] == name) return values_[input_ids_[i]];
+    }
+    throw std::invalid_argument("Unknown model input '" + name + "'.");
+}
+
+const std::vector<Tensor>& ModelRuntime::run(const std::map<std::string, Tensor>& inputs) {
+    for (size_t i = 0; i < input_ids_.size(); ++i) {
+        auto it = inputs.find(input_names_[i]);
+        if (it == inputs.end()) throw std::invalid_argument("Missing model input '" + input_names_[i] + "'.");
+        Tensor& dst = values_[input_ids_[i]];
+        const Tensor& src = it->second;
+        if (src.dtype() != Dtype::Float32 || src.shape() != dst.shape()) {
+            throw std::invalid_argument("Model input '" + input_names_[i] + "' must be Float32 of the planned shape.");
+        }
+        const Tensor contiguous = src.is_contiguous() ? src : src.clone();
+        tensor_copy(dst.data<float>(), contiguous.data<float>(), dst.nbytes());
+    }
+    return run();
+}
+
+const std::vector<Tensor>& ModelRuntime::run() {
+    for (const Step& s : steps_) {
+        throw_if_cancelled();
+        switch (s.kernel) {
+        case Kernel::Generic:
+            compute_node(*s.node, s.inputs, *s.output);
+            break;
+
+        case Kernel::Linear: {
+            // One (row, output feature) pair per index, so a single-row
+            // request still spreads over the output features
+            const int64_t grain = std::max<int64_t>(1, 32768 / std::max<int64_t>(s.inner, 1));
+            parallel_for(0, s.rows * s.channels, grain, [&s](int64_t begin, int64_t end) {
+                const DotFn dot = dot_kernel(s.isa);
+                const float* x = s.inputs[0]->data<float>();
+                const float* w = s.inputs[1]->data<float>();
+                const float* b = s.inputs.size() > 2 ? s.inputs[2]->data<float>() : nullptr;
+                float* y = s.output->data<float>();
+                for (int64_t i = begin; i < end; ++i) {
+                    const int64_t r = i / s.channels, m = i % s.channels;
+                    y[i] = (b ? b[m] : 0.0f) + dot(x + r * s.inner, w + m * s.inner, s.inner);
+                }
+            });
+            break;
+        }
+
+        case Kernel::Conv2d:
+            conv2d_into(*s.inputs[0], *s.inputs[1], s.inputs.size() > 2 ? s.inputs[2] : nullptr,
+                        {s.window.stride_h, s.window.stride_w}, {s.window.pad_h, s.window.pad_w}, *s.output);
+            break;
+
+        case Kernel::MaxPool2d:
+            max_pool2d_into(*s.inputs[0], s.pool, *s.output);
+            break;
+        case Kernel::AvgPool2d:
+            avg_pool2d_into(*s.inputs[0], s.pool, *s.output);
+            break;
+
+        case Kernel::ChannelAffine: {
+            const int64_t grain = std::max<int64_t>(1, 16384 / std::max<int64_t>(s.inner, 1));
+            parallel_for(0, s.rows, grain, [&s](int64_t begin, int64_t end) {
+                const float* x = s.inputs[0]->data<float>();
+                float* y = s.output->data<float>();
+                for (int64_t plane = begin; plane < end; ++plane) {
+                    const float a = s.scale[plane % s.channels];
+                    const float b = s.shift[plane % s.channels];
+                    for (int64_t i = plane * s.inner; i < (plane + 1) * s.inner; ++i) y[i] = x[i] * a + b;
+                }
+            });
+            break;
+        }
+        }
+    }
+    ++stats_.runs;
+    return outputs_;
+}
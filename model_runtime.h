@@ -0,0 +1,98 @@
+#pragma once
+
+#include "graph.h"
+#include "isa_dispatch.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// =============================
+// Model Runtime
+// =============================
+
+// Serving executor for a graph with fixed input shapes. Everything that
+// does not depend on the request is done once, at load:
+// - weights are mapped from the files written by save_graph, not copied
+// - shapes are inferred and every intermediate gets an offset in a single
+//   arena; a buffer is reused once the last node reading it has run
+// - each node is bound to a kernel. Reshapes become views of their input,
+//   and elementwise ops write over an input that dies with them. BatchNorm
+//   and Scale get their per-channel factors folded, Linear gets the
+//   widest ISA worth using for its size, and pools get their window tables.
+// run() then computes straight into the arena without allocating, parallel
+// dispatch onto the thread pool included.
+//
+// A runtime serves one request at a time. Its input and output tensors are
+// views into the arena, and each run overwrites them. Runtimes built from
+// the same Graph share its weights, so a server keeps one per worker thread.
+class ModelRuntime {
+public:
+    struct Stats {
+        size_t arena_bytes = 0;     // planned activation memory
+        size_t unplanned_bytes = 0; // the same activations without reuse
+        size_t weight_bytes = 0;
+        size_t steps = 0;           // kernels run per request
+        size_t views = 0;           // nodes turned into views
+        size_t in_place = 0;        // nodes writing over an input
+        size_t runs = 0;
+    };
+
+    // Loads a graph written by save_graph with its weights mapped.
+    // `input_shapes` fixes the shape of each input; inputs left out use the
+    // shape declared in the graph. Throws std::invalid_argument when an
+    // input has no shape or the shapes do not fit the graph.
+    explicit ModelRuntime(const std::string& path,
+                          const std::map<std::string, Shape>& input_shapes = {});
+    explicit ModelRuntime(Graph graph, const std::map<std::string, Shape>& input_shapes = {});
+
+    ModelRuntime(const ModelRuntime&) = delete;
+    ModelRuntime& operator=(const ModelRuntime&) = delete;
+
+    // Arena view to write the request's input into
+    Tensor& input(const std::string& name);
+
+    // Runs on the current contents of the inputs; outputs come back in
+    // declaration order and stay valid until the next run
+    const std::vector<Tensor>& run();
+
+    // Copies `inputs` into place first; every input must be given.
+    // Non-contiguous inputs go through a temporary copy.
+    const std::vector<Tensor>& run(const std::map<std::string, Tensor>& inputs);
+
+    const std::vector<std::string>& input_names() const { return input_names_; }
+    const std::vector<std::string>& output_names() const { return output_names_; }
+    const Graph& graph() const { return graph_; }
+    Stats stats() const { return stats_; }
+
+private:
+    enum class Kernel : uint8_t { Generic, Linear, ChannelAffine, Conv2d, MaxPool2d, AvgPool2d };
+
+    // One node bound to its kernel and to its place in the arena
+    struct Step {
+        Kernel kernel = Kernel::Generic;
+        const Node* node = nullptr;
+        std::vector<const Tensor*> inputs;
+        Tensor* output = nullptr;
+        IsaLevel isa = IsaLevel::Scalar;  // Linear
+        std::vector<float> scale, shift;  // ChannelAffine
+        Pool2dParams window;              // Conv2d: stride and pad
+        Pool2dPlan pool;                  // pools: window tables for the bound shape
+        int64_t rows = 0;     // Linear: rows of x; ChannelAffine: (n, c) planes
+        int64_t inner = 0;    // Linear: K; ChannelAffine: plane size
+        int64_t channels = 0; // Linear: M; ChannelAffine: C
+    };
+
+    void plan(const std::map<std::string, Shape>& input_shapes);
+    void bind(Step& step, const std::vector<Shape>& shapes);
+
+    Graph graph_;
+    Tensor arena_;
+    std::vector<Tensor> values_; // per node: arena view or constant
+    std::vector<Step> steps_;
+    std::vector<ValueId> input_ids_;
+    std::vector<std::string> input_names_;
+    std::vector<std::string> output_names_;
+    std::vector<Tensor> outputs_;
+    std::vector<StoragePin> weight_pins_; // weights stay resident while serving
+    Stats stats_;
+};
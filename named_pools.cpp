@@ -0,0 +1,87 @@
+#include "named_pools.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<ThreadPool>> pools;
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+thread_local ThreadPool* tls_pool = nullptr;
+
+} // namespace
+
+// ========================================
+// Registry
+// ========================================
+ThreadPool& create_named_pool(const std::string& name, const std::vector<int>& cpus,
+                              size_t num_threads) {
+    if (cpus.empty()) {
+        throw std::invalid_argument("Named pool '" + name + "' needs at least one CPU.");
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (name == "default" || r.pools.count(name)) {
+        throw std::invalid_argument("Thread pool '" + name + "' already exists.");
+    }
+    auto pool = std::make_unique<ThreadPool>(num_threads > 0 ? num_threads : cpus.size());
+    IdlePolicy policy = pool->idle_policy();
+    policy.cpus = cpus;
+    pool->set_idle_policy(policy);
+    ThreadPool& ref = *pool;
+    r.pools.emplace(name, std::move(pool));
+    return ref;
+}
+
+ThreadPool& named_pool(const std::string& name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.pools.find(name);
+    if (it == r.pools.end()) {
+        throw std::invalid_argument("Unknown thread pool '" + name + "'.");
+    }
+    return *it->second;
+}
+
+bool has_named_pool(const std::string& name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.pools.count(name) > 0;
+}
+
+std::map<std::string, ThreadPool::Stats> pool_stats() {
+    std::map<std::string, ThreadPool::Stats> out;
+    out["default"] = default_thread_pool().stats();
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& entry : r.pools) out[entry.first] = entry.second->stats();
+    return out;
+}
+
+// ========================================
+// Scopes
+// ========================================
+PoolScope::PoolScope(const std::string& name) : PoolScope(named_pool(name)) {}
+
+PoolScope::PoolScope(ThreadPool& pool) : previous_(tls_pool) {
+    tls_pool = &pool;
+}
+
+PoolScope::~PoolScope() {
+    tls_pool = previous_;
+}
+
+ThreadPool& current_thread_pool() {
+    return tls_pool ? *tls_pool : default_thread_pool();
+}
+
+bool in_pool_scope() {
+    return tls_pool != nullptr && tls_pool != &default_thread_pool();
+}
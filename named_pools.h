@@ -0,0 +1,55 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// =============================
+// Named Thread Pools
+// =============================
+
+// Pools for tenants sharing one process. Each named pool owns its own
+// workers pinned to a CPU subset, so one tenant's large batch cannot take
+// threads or cores from another. parallel_for (and every op built on it)
+// runs on the pool of the calling thread's PoolScope, or on
+// default_thread_pool() outside any scope. Work on a named pool does not
+// draw from thread_budget(); the pool's CPUs are its budget.
+//
+// Pools live until process exit, so references stay valid.
+
+// Creates pool `name` with its workers pinned round-robin to `cpus`.
+// `num_threads` (caller included, as for ThreadPool) defaults to one per
+// CPU. Throws std::invalid_argument if the name is taken or `cpus` is
+// empty.
+ThreadPool& create_named_pool(const std::string& name, const std::vector<int>& cpus,
+                              size_t num_threads = 0);
+
+// Throws std::invalid_argument for unknown names
+ThreadPool& named_pool(const std::string& name);
+bool has_named_pool(const std::string& name);
+
+// Stats of every named pool plus "default" for default_thread_pool()
+std::map<std::string, ThreadPool::Stats> pool_stats();
+
+// Routes parallel work started by the calling thread to a pool for the
+// lifetime of the scope. Scopes nest; the innermost wins.
+class PoolScope {
+public:
+    explicit PoolScope(const std::string& name);
+    explicit PoolScope(ThreadPool& pool);
+    ~PoolScope();
+
+    PoolScope(const PoolScope&) = delete;
+    PoolScope& operator=(const PoolScope&) = delete;
+
+private:
+    ThreadPool* previous_;
+};
+
+// Pool of the innermost PoolScope, else default_thread_pool()
+ThreadPool& current_thread_pool();
+
+// True when current_thread_pool() is not the shared default pool
+bool in_pool_scope();
@@ -0,0 +1,140 @@
+#include "parallel.h"
+#include "cancellation.h"
+#include "named_pools.h"
+#include "scratch_arena.h"
+#include "thread_budget.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+
+// Under a cancellation scope each chunk is run in about this many pieces,
+// with a check before each one
+constexpr int64_t kChecksPerChunk = 64;
+
+// Runs fn over [b, e), checking the cancellation chain between pieces.
+// A cancelled thread also hands its idle scratch blocks back to the OS.
+void run_checked(int64_t b, int64_t e, int64_t min_chunk,
+                 const std::function<void(int64_t, int64_t)>& fn) {
+    const int64_t step = std::max(min_chunk, (e - b + kChecksPerChunk - 1) / kChecksPerChunk);
+    try {
+        for (int64_t s = b; s < e; s += step) {
+            throw_if_cancelled();
+            fn(s, std::min(e, s + step));
+        }
+    } catch (const OperationCancelled&) {
+        ScratchArena& arena = ScratchArena::local();
+        const ScratchArena::Marker m = arena.mark();
+        if (m.block == 0 && m.offset == 0) arena.trim();
+        throw;
+    }
+}
+
+// Threads this call may use: pool size, the caller's guard and, on the
+// shared pool, the budget left over by other concurrent calls (acquired by
+// the caller)
+int64_t thread_cap(size_t pool_size, bool shared) {
+    size_t cap = shared ? std::min(pool_size, thread_budget()) : pool_size;
+    if (size_t limit = parallelism_limit()) cap = std::min(cap, limit);
+    return static_cast<int64_t>(cap);
+}
+
+#ifdef _OPENMP
+void run_openmp(int64_t num_chunks, int64_t threads, const std::function<void(int64_t)>& chunk_fn) {
+    std::exception_ptr error;
+#pragma omp parallel for num_threads(static_cast<int>(threads)) schedule(static, 1)
+    for (int64_t i = 0; i < num_chunks; ++i) {
+        try {
+            chunk_fn(i);
+        } catch (...) {
+#pragma omp critical(tensor_parallel_error)
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+#endif
+
+} // namespace
+
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& fn) {
+    if (begin >= end) return;
+
+    const int64_t range = end - begin;
+    const int64_t min_chunk = std::max<int64_t>(grain, 1);
+    std::shared_ptr<const CancellationScope::Chain> cancel_chain = CancellationScope::current();
+    const auto run_inline = [&] {
+        if (cancel_chain) {
+            run_checked(begin, end, min_chunk, fn);
+        } else {
+            fn(begin, end);
+        }
+    };
+    if (range <= min_chunk || ThreadPool::in_parallel_region() || in_external_parallel_region()) {
+        run_inline();
+        return;
+    }
+
+    // Named pools own their CPUs and do not take from the shared budget
+    const bool shared = !in_pool_scope();
+    ThreadPool& pool = current_thread_pool();
+    const int64_t max_chunks = (range + min_chunk - 1) / min_chunk;
+    const int64_t wanted = std::min(max_chunks, thread_cap(pool.size(), shared));
+    if (wanted <= 1) {
+        run_inline();
+        return;
+    }
+    // High priority work preempts the pool rather than queueing for the
+    // budget behind batch work, so it does not take a share of it
+    const TaskPriority priority = current_task_priority();
+    const bool budgeted = shared && priority != TaskPriority::High;
+    const size_t granted = budgeted ? acquire_threads(static_cast<size_t>(wanted))
+                                    : static_cast<size_t>(wanted);
+    // Low priority work is cut finer so helpers can leave it for more
+    // urgent work at chunk boundaries; it still runs on `granted` threads
+    const int64_t num_chunks = priority == TaskPriority::Low
+                                   ? std::min<int64_t>(max_chunks, static_cast<int64_t>(granted) * 4)
+                                   : static_cast<int64_t>(granted);
+    const int64_t chunk = (range + num_chunks - 1) / num_chunks;
+
+    // Captured as one reference, so chunk_fn fits in std::function's inline
+    // storage and dispatch does not allocate
+    const struct {
+        int64_t begin, end, chunk, min_chunk;
+        const std::shared_ptr<const CancellationScope::Chain>& cancel_chain;
+        const std::function<void(int64_t, int64_t)>& fn;
+    } call{begin, end, chunk, min_chunk, cancel_chain, fn};
+    const std::function<void(int64_t)> chunk_fn = [&call](int64_t i) {
+        const int64_t b = call.begin + i * call.chunk;
+        const int64_t e = std::min(call.end, b + call.chunk);
+        if (b >= e) return;
+        NestedRuntimeScope nested;
+        if (call.cancel_chain) {
+            CancellationScope inherited(call.cancel_chain);
+            run_checked(b, e, call.min_chunk, call.fn);
+        } else {
+            call.fn(b, e);
+        }
+    };
+    try {
+#ifdef _OPENMP
+        if (parallel_backend() == ParallelBackend::OpenMP) {
+            run_openmp(num_chunks, static_cast<int64_t>(granted), chunk_fn);
+        } else
+#endif
+        {
+            pool.run(static_cast<size_t>(num_chunks), [&](size_t i) { chunk_fn(static_cast<int64_t>(i)); },
+                     granted - 1);
+        }
+    } catch (...) {
+        if (budgeted) release_threads(granted);
+        throw;
+    }
+    if (budgeted) release_threads(granted);
+}
+
+size_t get_num_threads() {
+    return static_cast<size_t>(thread_cap(current_thread_pool().size(), !in_pool_scope()));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// =============================
+// Parallel Loops
+// =============================
+
+// Splits [begin, end) into contiguous chunks of at least `grain` iterations
+// and runs fn(chunk_begin, chunk_end) on current_thread_pool() (the
+// default pool unless a PoolScope routes the caller to a named pool).
+// Small ranges and nested calls run inline on the calling thread.
+// Under a CancellationScope the range is checked for cancellation between
+// pieces of each chunk, and the loop throws OperationCancelled once a
+// token expires.
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& fn);
+
+// Number of threads parallel_for would use on the calling thread
+size_t get_num_threads();
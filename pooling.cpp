@@ -0,0 +1,761 @@
+#include "pooling.h"
+#include "parallel.h"
+#include "scratch_arena.h"
+#include "index_dispatch.h"
+#include "isa_dispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TENSOR_HAVE_X86 1
+#endif
+
+namespace {
+
+enum class PoolKind { Max, Avg };
+
+using Window = PoolWindow;
+
+// Geometry of a pooling call, with 1D problems expressed as H == 1. The
+// window tables belong to the caller.
+struct PoolProblem {
+    int64_t N = 0, C = 0, H = 0, W = 0;
+    const Window* wh = nullptr;
+    const Window* ww = nullptr;
+    int64_t oh = 0, ow = 0;
+    MemoryFormat format = MemoryFormat::ChannelsFirst;
+
+    int64_t OH() const { return oh; }
+    int64_t OW() const { return ow; }
+
+    void set_windows(const std::vector<Window>& h, const std::vector<Window>& w) {
+        wh = h.data();
+        ww = w.data();
+        oh = static_cast<int64_t>(h.size());
+        ow = static_cast<int64_t>(w.size());
+    }
+};
+
+} // namespace
+
+// ========================================
+// Helper: Window tables
+// ========================================
+int64_t pooled_size(int64_t in, int32_t k, int32_t s, int32_t p, bool ceil_mode) {
+    const int64_t span = in + 2 * static_cast<int64_t>(p) - k;
+    if (span < 0) {
+        throw std::invalid_argument("Pooling kernel is larger than the padded input.");
+    }
+    int64_t out = (ceil_mode ? (span + s - 1) / s : span / s) + 1;
+    // The last window must start inside the input or the left padding
+    if (ceil_mode && (out - 1) * s >= in + p) --out;
+    return out;
+}
+
+namespace {
+
+std::vector<Window> regular_windows(int64_t in, int32_t k, int32_t s, int32_t p,
+                                    bool ceil_mode, bool count_include_pad) {
+    if (k <= 0) throw std::invalid_argument("Pooling kernel size must be positive.");
+    if (s <= 0) s = k;
+    if (p < 0 || p > k / 2) {
+        throw std::invalid_argument("Pooling padding must be in [0, kernel / 2].");
+    }
+
+    const int64_t out = pooled_size(in, k, s, p, ceil_mode);
+    std::vector<Window> windows(static_cast<size_t>(out));
+    for (int64_t o = 0; o < out; ++o) {
+        int64_t start = o * s - p;
+        int64_t end = std::min(start + k, in + p);
+        const int64_t padded_count = end - start;
+        start = std::max<int64_t>(start, 0);
+        end = std::min(end, in);
+        const int64_t count = count_include_pad ? padded_count : end - start;
+        windows[o] = {static_cast<int32_t>(start), static_cast<int32_t>(end),
+                      1.0f / static_cast<float>(count)};
+    }
+    return windows;
+}
+
+std::vector<Window> adaptive_windows(int64_t in, int64_t out) {
+    if (out <= 0) throw std::invalid_argument("Adaptive pooling output size must be positive.");
+    std::vector<Window> windows(static_cast<size_t>(out));
+    for (int64_t o = 0; o < out; ++o) {
+        const int64_t start = (o * in) / out;
+        const int64_t end = ((o + 1) * in + out - 1) / out;
+        windows[o] = {static_cast<int32_t>(start), static_cast<int32_t>(end),
+                      1.0f / static_cast<float>(end - start)};
+    }
+    return windows;
+}
+
+double mean_extent(const Window* windows, int64_t count) {
+    double total = 0.0;
+    for (int64_t i = 0; i < count; ++i) total += static_cast<double>(windows[i].end - windows[i].start);
+    return count == 0 ? 0.0 : total / static_cast<double>(count);
+}
+
+// ========================================
+// Helper: Problem setup / output allocation
+// ========================================
+PoolProblem make_problem(const std::vector<int32_t>& d, size_t expected_rank, MemoryFormat format) {
+    if (d.size() != expected_rank) {
+        throw std::invalid_argument(expected_rank == 4
+            ? "2D pooling expects a 4D input tensor."
+            : "1D pooling expects a 3D input tensor.");
+    }
+
+    PoolProblem p;
+    p.format = format;
+    p.N = d[0];
+    if (expected_rank == 4) {
+        const bool cf = format == MemoryFormat::ChannelsFirst;
+        p.C = cf ? d[1] : d[3];
+        p.H = cf ? d[2] : d[1];
+        p.W = cf ? d[3] : d[2];
+    } else {
+        const bool cf = format == MemoryFormat::ChannelsFirst;
+        p.C = cf ? d[1] : d[2];
+        p.H = 1;
+        p.W = cf ? d[2] : d[1];
+    }
+    return p;
+}
+
+PoolProblem make_problem(const Tensor& input, size_t expected_rank, MemoryFormat format) {
+    if (input.dtype() != Dtype::Float32) {
+        throw std::invalid_argument("Pooling supports Float32 tensors only.");
+    }
+    if (!input.is_contiguous()) {
+        throw std::invalid_argument("Pooling expects a contiguous input tensor.");
+    }
+    return make_problem(input.shape(), expected_rank, format);
+}
+
+Shape output_shape(const PoolProblem& p, size_t rank) {
+    const auto N = static_cast<int32_t>(p.N), C = static_cast<int32_t>(p.C);
+    const auto OH = static_cast<int32_t>(p.OH()), OW = static_cast<int32_t>(p.OW());
+    const bool cf = p.format == MemoryFormat::ChannelsFirst;
+    if (rank == 4) {
+        return cf ? Shape({N, C, OH, OW}) : Shape({N, OH, OW, C});
+    }
+    return cf ? Shape({N, C, OW}) : Shape({N, OW, C});
+}
+
+// ========================================
+// Channel-vector primitives (channels-last inner loops)
+// ========================================
+template <typename IndexT>
+void max_update_scalar(const float* x, float* acc, IndexT* idx, IndexT pos, int64_t C) {
+    for (int64_t c = 0; c < C; ++c) {
+        if (x[c] > acc[c] || std::isnan(x[c])) {
+            acc[c] = x[c];
+            idx[c] = pos;
+        }
+    }
+}
+
+void max_update_noidx_scalar(const float* x, float* acc, int64_t C) {
+    for (int64_t c = 0; c < C; ++c) {
+        if (x[c] > acc[c] || std::isnan(x[c])) acc[c] = x[c];
+    }
+}
+
+void sum_update_scalar(const float* x, float* acc, int64_t C) {
+    for (int64_t c = 0; c < C; ++c) acc[c] += x[c];
+}
+
+#ifdef TENSOR_HAVE_X86
+__attribute__((target("avx2")))
+void max_update_avx2(const float* x, float* acc, int32_t* idx, int32_t pos, int64_t C) {
+    const __m256i vpos = _mm256_set1_epi32(pos);
+    int64_t c = 0;
+    for (; c + 8 <= C; c += 8) {
+        const __m256 v = _mm256_loadu_ps(x + c);
+        const __m256 a = _mm256_loadu_ps(acc + c);
+        const __m256 take = _mm256_or_ps(_mm256_cmp_ps(v, a, _CMP_GT_OQ),
+                                         _mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+        _mm256_storeu_ps(acc + c, _mm256_blendv_ps(a, v, take));
+        const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + c));
+        const __m256i r = _mm256_castps_si256(_mm256_blendv_ps(
+            _mm256_castsi256_ps(i), _mm256_castsi256_ps(vpos), take));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(idx + c), r);
+    }
+    max_update_scalar<int32_t>(x + c, acc + c, idx + c, pos, C - c);
+}
+
+__attribute__((target("avx2")))
+void max_update_noidx_avx2(const float* x, float* acc, int64_t C) {
+    int64_t c = 0;
+    for (; c + 8 <= C; c += 8) {
+        const __m256 v = _mm256_loadu_ps(x + c);
+        const __m256 a = _mm256_loadu_ps(acc + c);
+        const __m256 take = _mm256_or_ps(_mm256_cmp_ps(v, a, _CMP_GT_OQ),
+                                         _mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+        _mm256_storeu_ps(acc + c, _mm256_blendv_ps(a, v, take));
+    }
+    max_update_noidx_scalar(x + c, acc + c, C - c);
+}
+
+__attribute__((target("avx2")))
+void sum_update_avx2(const float* x, float* acc, int64_t C) {
+    int64_t c = 0;
+    for (; c + 8 <= C; c += 8) {
+        _mm256_storeu_ps(acc + c, _mm256_add_ps(_mm256_loadu_ps(acc + c),
+                                                _mm256_loadu_ps(x + c)));
+    }
+    sum_update_scalar(x + c, acc + c, C - c);
+}
+
+__attribute__((target("avx512f")))
+void max_update_avx512(const float* x, float* acc, int32_t* idx, int32_t pos, int64_t C) {
+    const __m512i vpos = _mm512_set1_epi32(pos);
+    int64_t c = 0;
+    for (; c + 16 <= C; c += 16) {
+        const __m512 v = _mm512_loadu_ps(x + c);
+        const __m512 a = _mm512_loadu_ps(acc + c);
+        const __mmask16 take = _mm512_cmp_ps_mask(v, a, _CMP_GT_OQ) |
+                               _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+        _mm512_storeu_ps(acc + c, _mm512_mask_blend_ps(take, a, v));
+        const __m512i i = _mm512_loadu_si512(idx + c);
+        _mm512_storeu_si512(idx + c, _mm512_mask_blend_epi32(take, i, vpos));
+    }
+    max_update_scalar<int32_t>(x + c, acc + c, idx + c, pos, C - c);
+}
+
+__attribute__((target("avx512f")))
+void max_update_noidx_avx512(const float* x, float* acc, int64_t C) {
+    int64_t c = 0;
+    for (; c + 16 <= C; c += 16) {
+        const __m512 v = _mm512_loadu_ps(x + c);
+        const __m512 a = _mm512_loadu_ps(acc + c);
+        const __mmask16 take = _mm512_cmp_ps_mask(v, a, _CMP_GT_OQ) |
+                               _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+        _mm512_storeu_ps(acc + c, _mm512_mask_blend_ps(take, a, v));
+    }
+    max_update_noidx_scalar(x + c, acc + c, C - c);
+}
+
+__attribute__((target("avx512f")))
+void sum_update_avx512(const float* x, float* acc, int64_t C) {
+    int64_t c = 0;
+    for (; c + 16 <= C; c += 16) {
+        _mm512_storeu_ps(acc + c, _mm512_add_ps(_mm512_loadu_ps(acc + c),
+                                                _mm512_loadu_ps(x + c)));
+    }
+    sum_update_scalar(x + c, acc + c, C - c);
+}
+#endif
+
+// Channel-vector kernels for one ISA level
+struct ChannelOps {
+    void (*max_update)(const float*, float*, int32_t*, int32_t, int64_t);
+    void (*max_update_noidx)(const float*, float*, int64_t);
+    void (*sum_update)(const float*, float*, int64_t);
+};
+
+const ChannelOps& channel_ops(IsaLevel isa) {
+    static const ChannelOps scalar{max_update_scalar<int32_t>, max_update_noidx_scalar,
+                                   sum_update_scalar};
+#ifdef TENSOR_HAVE_X86
+    static const ChannelOps avx2{max_update_avx2, max_update_noidx_avx2, sum_update_avx2};
+    static const ChannelOps avx512{max_update_avx512, max_update_noidx_avx512, sum_update_avx512};
+    if (isa == IsaLevel::Avx512) return avx512;
+    if (isa == IsaLevel::Avx2) return avx2;
+#endif
+    return scalar;
+}
+
+// ========================================
+// Channels-first: one (H, W) plane at a time
+// ========================================
+
+// Direct window scan, used when windows do not overlap much
+template <PoolKind K, typename IndexT>
+void plane_direct(const PoolProblem& p, const float* in, float* out, int64_t* idx) {
+    const IndexT W = static_cast<IndexT>(p.W), OH = static_cast<IndexT>(p.OH());
+    const IndexT OW = static_cast<IndexT>(p.OW());
+    for (IndexT oh = 0; oh < OH; ++oh) {
+        const Window& wh = p.wh[oh];
+        for (IndexT ow = 0; ow < OW; ++ow) {
+            const Window& ww = p.ww[ow];
+            if (K == PoolKind::Max) {
+                float best = -std::numeric_limits<float>::infinity();
+                IndexT best_pos = wh.start * W + ww.start;
+                for (IndexT h = wh.start; h < wh.end; ++h) {
+                    for (IndexT w = ww.start; w < ww.end; ++w) {
+                        const float v = in[h * W + w];
+                        if (v > best || std::isnan(v)) {
+                            best = v;
+                            best_pos = h * W + w;
+                        }
+                    }
+                }
+                out[oh * OW + ow] = best;
+                if (idx) idx[oh * OW + ow] = best_pos;
+            } else {
+                float sum = 0.0f;
+                for (IndexT h = wh.start; h < wh.end; ++h) {
+                    for (IndexT w = ww.start; w < ww.end; ++w) sum += in[h * W + w];
+                }
+                out[oh * OW + ow] = sum * (wh.inv_count * ww.inv_count);
+            }
+        }
+    }
+}
+
+// Separable scan: reduce every input row along W first, then reduce the
+// row results along H. Costs kh + kw instead of kh * kw per output when
+// windows overlap.
+template <PoolKind K, typename IndexT>
+void plane_separable(const PoolProblem& p, const float* in, float* out, int64_t* idx,
+                     float* rows, IndexT* cols) {
+    const IndexT H = static_cast<IndexT>(p.H), W = static_cast<IndexT>(p.W);
+    const IndexT OH = static_cast<IndexT>(p.OH()), OW = static_cast<IndexT>(p.OW());
+
+    // Horizontal pass
+    for (IndexT h = 0; h < H; ++h) {
+        const float* row = in + h * W;
+        float* r = rows + h * OW;
+        for (IndexT ow = 0; ow < OW; ++ow) {
+            const Window& ww = p.ww[ow];
+            if (K == PoolKind::Max) {
+                float best = row[ww.start];
+                IndexT best_w = ww.start;
+                for (IndexT w = ww.start + 1; w < ww.end; ++w) {
+                    if (row[w] > best || std::isnan(row[w])) {
+                        best = row[w];
+                        best_w = w;
+                    }
+                }
+                r[ow] = best;
+                if (idx) cols[h * OW + ow] = best_w;
+            } else {
+                float sum = 0.0f;
+                for (IndexT w = ww.start; w < ww.end; ++w) sum += row[w];
+                r[ow] = sum * ww.inv_count;
+            }
+        }
+    }
+
+    // Vertical pass, contiguous along OW
+    for (IndexT oh = 0; oh < OH; ++oh) {
+        const Window& wh = p.wh[oh];
+        float* o = out + oh * OW;
+        const float* first = rows + wh.start * OW;
+        std::copy(first, first + OW, o);
+        if (K == PoolKind::Max) {
+            int64_t* oi = idx ? idx + oh * OW : nullptr;
+            if (oi) {
+                for (IndexT ow = 0; ow < OW; ++ow) {
+                    oi[ow] = wh.start * W + cols[wh.start * OW + ow];
+                }
+            }
+            for (IndexT h = wh.start + 1; h < wh.end; ++h) {
+                const float* r = rows + h * OW;
+                if (oi) {
+                    for (IndexT ow = 0; ow < OW; ++ow) {
+                        if (r[ow] > o[ow] || std::isnan(r[ow])) {
+                            o[ow] = r[ow];
+                            oi[ow] = h * W + cols[h * OW + ow];
+                        }
+                    }
+                } else {
+                    for (IndexT ow = 0; ow < OW; ++ow) {
+                        if (r[ow] > o[ow] || std::isnan(r[ow])) o[ow] = r[ow];
+                    }
+                }
+            }
+        } else {
+            for (IndexT h = wh.start + 1; h < wh.end; ++h) {
+                const float* r = rows + h * OW;
+                for (IndexT ow = 0; ow < OW; ++ow) o[ow] += r[ow];
+            }
+            for (IndexT ow = 0; ow < OW; ++ow) o[ow] *= wh.inv_count;
+        }
+    }
+}
+
+template <PoolKind K, typename IndexT>
+void pool_channels_first(const PoolProblem& p, const float* in, float* out, int64_t* idx) {
+    const IndexT planes = static_cast<IndexT>(p.N * p.C);
+    const IndexT in_plane = static_cast<IndexT>(p.H * p.W);
+    const IndexT out_plane = static_cast<IndexT>(p.OH() * p.OW());
+
+    const double kh = mean_extent(p.wh, p.OH()), kw = mean_extent(p.ww, p.OW());
+    const double direct_cost = static_cast<double>(p.OH()) * kh * kw;
+    const double separable_cost = static_cast<double>(p.H) * kw + static_cast<double>(p.OH()) * kh;
+    const bool separable = separable_cost < direct_cost;
+
+    const int64_t work = std::max<int64_t>(1, static_cast<int64_t>(direct_cost) * p.OW());
+    const int64_t grain = std::max<int64_t>(1, 32768 / work);
+
+    // Captured as one reference, so the task fits in std::function's inline
+    // storage and a call does not allocate
+    const struct {
+        const PoolProblem& p;
+        const float* in;
+        float* out;
+        int64_t* idx;
+        IndexT in_plane, out_plane;
+        bool separable;
+    } task{p, in, out, idx, in_plane, out_plane, separable};
+
+    parallel_for(0, planes, grain, [&task](int64_t b, int64_t e) {
+        const auto& [p, in, out, idx, in_plane, out_plane, separable] = task;
+        // (H, OW) row reductions, reused for every plane of the chunk
+        ScratchScope scratch;
+        float* rows = separable ? scratch.alloc<float>(static_cast<size_t>(p.H * p.OW())) : nullptr;
+        IndexT* cols = separable && idx ? scratch.alloc<IndexT>(static_cast<size_t>(p.H * p.OW()))
+                                         : nullptr;
+        for (IndexT pl = static_cast<IndexT>(b); pl < static_cast<IndexT>(e); ++pl) {
+            const float* src = in + pl * in_plane;
+            float* dst = out + pl * out_plane;
+            int64_t* di = idx ? idx + pl * out_plane : nullptr;
+            if (separable) {
+                plane_separable<K, IndexT>(p, src, dst, di, rows, cols);
+            } else {
+                plane_direct<K, IndexT>(p, src, dst, di);
+            }
+        }
+    });
+}
+
+// ========================================
+// Channels-last: SIMD across C, parallel over output rows
+// ========================================
+template <PoolKind K, typename IndexT>
+void pool_channels_last(const PoolProblem& p, const float* in, float* out, int64_t* idx,
+                        IsaLevel isa) {
+    const IndexT C = static_cast<IndexT>(p.C), H = static_cast<IndexT>(p.H);
+    const IndexT W = static_cast<IndexT>(p.W);
+    const IndexT OH = static_cast<IndexT>(p.OH()), OW = static_cast<IndexT>(p.OW());
+    const ChannelOps& ops = channel_ops(isa);
+    // The vector path tracks argmax in 32-bit lanes; 64-bit problems use scalar
+    constexpr bool narrow_idx = std::is_same<IndexT, int32_t>::value;
+
+    const int64_t grain = std::max<int64_t>(1, 32768 / std::max<int64_t>(1, OW * C));
+
+    // One reference, as in pool_channels_first
+    const struct {
+        const PoolProblem& p;
+        const float* in;
+        float* out;
+        int64_t* idx;
+        IndexT C, H, W, OH, OW;
+        const ChannelOps& ops;
+    } task{p, in, out, idx, C, H, W, OH, OW, ops};
+
+    parallel_for(0, p.N * OH, grain, [&task](int64_t b, int64_t e) {
+        const auto& [p, in, out, idx, C, H, W, OH, OW, ops] = task;
+        ScratchScope scratch;
+        int32_t* idx32 = idx && narrow_idx ? scratch.alloc<int32_t>(static_cast<size_t>(C)) : nullptr;
+        for (IndexT row = static_cast<IndexT>(b); row < static_cast<IndexT>(e); ++row) {
+            const IndexT n = row / OH, oh = row % OH;
+            const Window& wh = p.wh[oh];
+            const float* src = in + n * H * W * C;
+            for (IndexT ow = 0; ow < OW; ++ow) {
+                const Window& ww = p.ww[ow];
+                const IndexT o = (row * OW + ow) * C;
+                float* acc = out + o;
+
+                if (K == PoolKind::Max) {
+                    std::fill(acc, acc + C, -std::numeric_limits<float>::infinity());
+                    const IndexT first = wh.start * W + ww.start;
+                    if (idx && narrow_idx) {
+                        std::fill(idx32, idx32 + C, static_cast<int32_t>(first));
+                    } else if (idx) {
+                        std::fill(idx + o, idx + o + C, first);
+                    }
+                    for (IndexT h = wh.start; h < wh.end; ++h) {
+                        for (IndexT w = ww.start; w < ww.end; ++w) {
+                            const float* x = src + (h * W + w) * C;
+                            if (!idx) {
+                                ops.max_update_noidx(x, acc, C);
+                            } else if (narrow_idx) {
+                                ops.max_update(x, acc, idx32,
+                                               static_cast<int32_t>(h * W + w), C);
+                            } else {
+                                max_update_scalar<int64_t>(x, acc, idx + o, h * W + w, C);
+                            }
+                        }
+                    }
+                    if (idx && narrow_idx) std::copy(idx32, idx32 + C, idx + o);
+                } else {
+                    std::fill(acc, acc + C, 0.0f);
+                    for (IndexT h = wh.start; h < wh.end; ++h) {
+                        for (IndexT w = ww.start; w < ww.end; ++w) {
+                            ops.sum_update(src + (h * W + w) * C, acc, C);
+                        }
+                    }
+                    const float scale = wh.inv_count * ww.inv_count;
+                    for (IndexT c = 0; c < C; ++c) acc[c] *= scale;
+                }
+            }
+        }
+    });
+}
+
+// ========================================
+// Helper: Allocate outputs and run the layout-specific kernel
+// ========================================
+template <PoolKind K>
+void pool_into(const Tensor& input, const PoolProblem& p, Tensor& output, int64_t* idx) {
+    // Index width is fixed once per call from the largest linear offset
+    const int64_t extent = std::max<int64_t>(static_cast<int64_t>(input.numel()),
+                                             static_cast<int64_t>(output.numel()));
+    const StoragePin keep_in = input.pin();
+    const StoragePin keep_out = output.pin();
+    const float* src = input.data<float>();
+    float* dst = output.data<float>();
+    IsaLevel isa = IsaLevel::Scalar;
+    if (p.format == MemoryFormat::ChannelsLast) {
+        static IsaCounter counter(K == PoolKind::Max ? "max_pool.channels_last"
+                                                     : "avg_pool.channels_last");
+        isa = select_isa(counter, static_cast<int64_t>(input.nbytes()));
+    }
+    dispatch_index_type(extent, [&](auto index_tag) {
+        using IndexT = decltype(index_tag);
+        if (p.format == MemoryFormat::ChannelsFirst) {
+            pool_channels_first<K, IndexT>(p, src, dst, idx);
+        } else {
+            pool_channels_last<K, IndexT>(p, src, dst, idx, isa);
+        }
+    });
+}
+
+template <PoolKind K>
+Tensor run_pool(const Tensor& input, const PoolProblem& p, size_t rank, Tensor* indices,
+                Tensor* into = nullptr) {
+    const Shape shape = output_shape(p, rank);
+    if (into && (into->dtype() != Dtype::Float32 || !into->is_contiguous() || into->shape() != shape.dims)) {
+        throw std::invalid_argument("Pooling output must be a contiguous Float32 tensor of the pooled shape.");
+    }
+    Tensor output = into ? *into : Tensor(shape, Dtype::Float32, input.device());
+    int64_t* idx = nullptr;
+    if (K == PoolKind::Max && indices) {
+        *indices = Tensor(shape, Dtype::Int64, input.device());
+        idx = indices->data<int64_t>();
+    }
+    pool_into<K>(input, p, output, idx);
+    return output;
+}
+
+} // namespace
+
+// ========================================
+// 2D pooling
+// ========================================
+Tensor max_pool2d(const Tensor& input, const Pool2dParams& params,
+                  MemoryFormat format, Tensor* indices) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = regular_windows(p.H, params.kernel_h, params.stride_h, params.pad_h,
+                                                   params.ceil_mode, true);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel_w, params.stride_w, params.pad_w,
+                                                   params.ceil_mode, true);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Max>(input, p, 4, indices);
+}
+
+Tensor avg_pool2d(const Tensor& input, const Pool2dParams& params, MemoryFormat format) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = regular_windows(p.H, params.kernel_h, params.stride_h, params.pad_h,
+                                                   params.ceil_mode, params.count_include_pad);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel_w, params.stride_w, params.pad_w,
+                                                   params.ceil_mode, params.count_include_pad);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Avg>(input, p, 4, nullptr);
+}
+
+void max_pool2d_into(const Tensor& input, const Pool2dParams& params, Tensor& output,
+                     MemoryFormat format) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = regular_windows(p.H, params.kernel_h, params.stride_h, params.pad_h,
+                                                   params.ceil_mode, true);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel_w, params.stride_w, params.pad_w,
+                                                   params.ceil_mode, true);
+    p.set_windows(wh, ww);
+    run_pool<PoolKind::Max>(input, p, 4, nullptr, &output);
+}
+
+void avg_pool2d_into(const Tensor& input, const Pool2dParams& params, Tensor& output,
+                     MemoryFormat format) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = regular_windows(p.H, params.kernel_h, params.stride_h, params.pad_h,
+                                                   params.ceil_mode, params.count_include_pad);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel_w, params.stride_w, params.pad_w,
+                                                   params.ceil_mode, params.count_include_pad);
+    p.set_windows(wh, ww);
+    run_pool<PoolKind::Avg>(input, p, 4, nullptr, &output);
+}
+
+Pool2dPlan plan_pool2d(const Shape& input_shape, const Pool2dParams& params, MemoryFormat format) {
+    const PoolProblem p = make_problem(input_shape.dims, 4, format);
+    Pool2dPlan plan;
+    plan.input_shape = input_shape.dims;
+    plan.format = format;
+    plan.rows = regular_windows(p.H, params.kernel_h, params.stride_h, params.pad_h,
+                                params.ceil_mode, params.count_include_pad);
+    plan.cols = regular_windows(p.W, params.kernel_w, params.stride_w, params.pad_w,
+                                params.ceil_mode, params.count_include_pad);
+    PoolProblem sized = p;
+    sized.set_windows(plan.rows, plan.cols);
+    plan.output_shape = output_shape(sized, 4).dims;
+    return plan;
+}
+
+namespace {
+
+template <PoolKind K>
+void run_planned(const Tensor& input, const Pool2dPlan& plan, Tensor& output) {
+    if (input.dtype() != Dtype::Float32 || !input.is_contiguous() || input.shape() != plan.input_shape) {
+        throw std::invalid_argument("Pooling input must be a contiguous Float32 tensor of the planned shape.");
+    }
+    if (output.dtype() != Dtype::Float32 || !output.is_contiguous() || output.shape() != plan.output_shape) {
+        throw std::invalid_argument("Pooling output must be a contiguous Float32 tensor of the pooled shape.");
+    }
+    PoolProblem p = make_problem(plan.input_shape, 4, plan.format);
+    p.set_windows(plan.rows, plan.cols);
+    pool_into<K>(input, p, output, nullptr);
+}
+
+} // namespace
+
+void max_pool2d_into(const Tensor& input, const Pool2dPlan& plan, Tensor& output) {
+    run_planned<PoolKind::Max>(input, plan, output);
+}
+
+void avg_pool2d_into(const Tensor& input, const Pool2dPlan& plan, Tensor& output) {
+    run_planned<PoolKind::Avg>(input, plan, output);
+}
+
+Tensor adaptive_max_pool2d(const Tensor& input, int32_t out_h, int32_t out_w,
+                           MemoryFormat format, Tensor* indices) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = adaptive_windows(p.H, out_h);
+    const std::vector<Window> ww = adaptive_windows(p.W, out_w);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Max>(input, p, 4, indices);
+}
+
+Tensor adaptive_avg_pool2d(const Tensor& input, int32_t out_h, int32_t out_w,
+                           MemoryFormat format) {
+    PoolProblem p = make_problem(input, 4, format);
+    const std::vector<Window> wh = adaptive_windows(p.H, out_h);
+    const std::vector<Window> ww = adaptive_windows(p.W, out_w);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Avg>(input, p, 4, nullptr);
+}
+
+// ========================================
+// 1D pooling (a single-row 2D problem)
+// ========================================
+Tensor max_pool1d(const Tensor& input, const Pool1dParams& params,
+                  MemoryFormat format, Tensor* indices) {
+    PoolProblem p = make_problem(input, 3, format);
+    const std::vector<Window> wh = adaptive_windows(1, 1);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel, params.stride, params.pad,
+                                                   params.ceil_mode, true);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Max>(input, p, 3, indices);
+}
+
+Tensor avg_pool1d(const Tensor& input, const Pool1dParams& params, MemoryFormat format) {
+    PoolProblem p = make_problem(input, 3, format);
+    const std::vector<Window> wh = adaptive_windows(1, 1);
+    const std::vector<Window> ww = regular_windows(p.W, params.kernel, params.stride, params.pad,
+                                                   params.ceil_mode, params.count_include_pad);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Avg>(input, p, 3, nullptr);
+}
+
+Tensor adaptive_max_pool1d(const Tensor& input, int32_t out_l, MemoryFormat format,
+                           Tensor* indices) {
+    PoolProblem p = make_problem(input, 3, format);
+    const std::vector<Window> wh = adaptive_windows(1, 1);
+    const std::vector<Window> ww = adaptive_windows(p.W, out_l);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Max>(input, p, 3, indices);
+}
+
+Tensor adaptive_avg_pool1d(const Tensor& input, int32_t out_l, MemoryFormat format) {
+    PoolProblem p = make_problem(input, 3, format);
+    const std::vector<Window> wh = adaptive_windows(1, 1);
+    const std::vector<Window> ww = adaptive_windows(p.W, out_l);
+    p.set_windows(wh, ww);
+    return run_pool<PoolKind::Avg>(input, p, 3, nullptr);
+}
+
+// ========================================
+// Max pooling backward
+// ========================================
+Tensor max_pool2d_backward(const Tensor& grad_output, const Tensor& indices,
+                           const Shape& input_shape, MemoryFormat format) {
+    if (grad_output.dtype() != Dtype::Float32 || indices.dtype() != Dtype::Int64) {
+        throw std::invalid_argument("max_pool2d_backward expects Float32 grads and Int64 indices.");
+    }
+    if (grad_output.shape() != indices.shape()) {
+        throw std::invalid_argument("Gradient and indices shapes must match.");
+    }
+    const size_t rank = input_shape.dims.size();
+    if ((rank != 3 && rank != 4) || grad_output.shape().size() != rank) {
+        throw std::invalid_argument("max_pool2d_backward expects 3D or 4D tensors.");
+    }
+
+    const StoragePin keep_grad = grad_output.pin();
+    const StoragePin keep_idx = indices.pin();
+    Tensor grad_input(input_shape, Dtype::Float32, grad_output.device());
+    float* gin = grad_input.data<float>();
+    std::fill(gin, gin + grad_input.numel(), 0.0f);
+
+    const float* gout = grad_output.data<float>();
+    const int64_t* idx = indices.data<int64_t>();
+    const auto& in = input_shape.dims;
+    const int64_t N = in[0];
+    const bool cf = format == MemoryFormat::ChannelsFirst;
+    const int64_t C = cf ? in[1] : in[rank - 1];
+    const auto& out = grad_output.shape();
+    if (out[0] != N || (cf ? out[1] : out[rank - 1]) != C) {
+        throw std::invalid_argument("Gradient batch and channels must match the input shape.");
+    }
+    const int64_t in_plane = grad_input.numel() / static_cast<size_t>(N * C);
+    const int64_t out_plane = grad_output.numel() / static_cast<size_t>(N * C);
+
+    // Indices are scatter offsets into an input plane
+    const auto checked = [in_plane](int64_t i) {
+        if (i < 0 || i >= in_plane) {
+            throw std::invalid_argument("max_pool2d_backward: index " + std::to_string(i) +
+                                        " is outside the input plane of " + std::to_string(in_plane) + ".");
+        }
+        return i;
+    };
+
+    if (cf) {
+        parallel_for(0, N * C, 1, [&](int64_t b, int64_t e) {
+            for (int64_t pl = b; pl < e; ++pl) {
+                float* g = gin + pl * in_plane;
+                for (int64_t o = 0; o < out_plane; ++o) {
+                    g[checked(idx[pl * out_plane + o])] += gout[pl * out_plane + o];
+                }
+            }
+        });
+    } else {
+        parallel_for(0, N, 1, [&](int64_t b, int64_t e) {
+            for (int64_t n = b; n < e; ++n) {
+                float* g = gin + n * in_plane * C;
+                const int64_t base = n * out_plane * C;
+                for (int64_t o = 0; o < out_plane; ++o) {
+                    for (int64_t c = 0; c < C; ++c) {
+                        const int64_t k = base + o * C + c;
+                        g[checked(idx[k]) * C + c] += gout[k];
+                    }
+                }
+            }
+        });
+    }
+    return grad_input;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "tensor.h"
+
+// =============================
+// Memory Layout
+// =============================
+
+// Physical dimension order of image-like tensors
+enum class MemoryFormat {
+    ChannelsFirst, // (N, C, H, W) / (N, C, L)
+    ChannelsLast   // (N, H, W, C) / (N, L, C)
+};
+
+// =============================
+// Pooling Parameters
+// =============================
+
+struct Pool2dParams {
+    int32_t kernel_h = 1, kernel_w = 1;
+    int32_t stride_h = 0, stride_w = 0; // 0 means "same as kernel"
+    int32_t pad_h = 0, pad_w = 0;
+    bool ceil_mode = false;
+    bool count_include_pad = true; // avg pooling only
+};
+
+struct Pool1dParams {
+    int32_t kernel = 1;
+    int32_t stride = 0; // 0 means "same as kernel"
+    int32_t pad = 0;
+    bool ceil_mode = false;
+    bool count_include_pad = true; // avg pooling only
+};
+
+// Output length of a pooling window sweep over `in` elements (stride > 0)
+int64_t pooled_size(int64_t in, int32_t kernel, int32_t stride, int32_t pad, bool ceil_mode);
+
+// =============================
+// Pooling Kernels (Float32)
+// =============================
+//
+// Inputs are 4D for the 2D variants and 3D for the 1D variants, laid out as
+// given by `format`. Outputs use the same layout. When `indices` is non-null
+// the max variants also return an Int64 tensor of the output's shape holding
+// the flat position (h * W + w, or l) of each maximum inside its input plane,
+// as consumed by max_pool2d_backward.
+
+Tensor max_pool2d(const Tensor& input, const Pool2dParams& params,
+                  MemoryFormat format = MemoryFormat::ChannelsFirst,
+                  Tensor* indices = nullptr);
+Tensor avg_pool2d(const Tensor& input, const Pool2dParams& params,
+                  MemoryFormat format = MemoryFormat::ChannelsFirst);
+
+// As max_pool2d / avg_pool2d, writing into `output`, which must already be
+// a contiguous Float32 tensor of the pooled shape
+void max_pool2d_into(const Tensor& input, const Pool2dParams& params, Tensor& output,
+                     MemoryFormat format = MemoryFormat::ChannelsFirst);
+void avg_pool2d_into(const Tensor& input, const Pool2dParams& params, Tensor& output,
+                     MemoryFormat format = MemoryFormat::ChannelsFirst);
+
+// Input positions [start, end) one output position reads along one axis
+struct PoolWindow {
+    int32_t start;
+    int32_t end;
+    float inv_count; // 1 / divisor contribution of this axis (avg pooling)
+};
+
+// Window tables of a 2D pooling for one input shape. Callers pooling the
+// same shape on every request build it once; the _into overloads taking a
+// plan then do no setup and no allocation of their own.
+struct Pool2dPlan {
+    std::vector<int32_t> input_shape;
+    std::vector<int32_t> output_shape;
+    MemoryFormat format = MemoryFormat::ChannelsFirst;
+    std::vector<PoolWindow> rows, cols;
+};
+
+// Throws std::invalid_argument where max_pool2d / avg_pool2d would for an
+// input of this shape. count_include_pad only matters to avg pooling.
+Pool2dPlan plan_pool2d(const Shape& input_shape, const Pool2dParams& params,
+                       MemoryFormat format = MemoryFormat::ChannelsFirst);
+
+// `input` must have the plan's input shape and `output` its output shape
+void max_pool2d_into(const Tensor& input, const Pool2dPlan& plan, Tensor& output);
+void avg_pool2d_into(const Tensor& input, const Pool2dPlan& plan, Tensor& output);
+
+Tensor adaptive_max_pool2d(const Tensor& input, int32_t out_h, int32_t out_w,
+                           MemoryFormat format = MemoryFormat::ChannelsFirst,
+                           Tensor* indices = nullptr);
+Tensor adaptive_avg_pool2d(const Tensor& input, int32_t out_h, int32_t out_w,
+                           MemoryFormat format = MemoryFormat::ChannelsFirst);
+
+Tensor max_pool1d(const Tensor& input, const Pool1dParams& params,
+                  MemoryFormat format = MemoryFormat::ChannelsFirst,
+                  Tensor* indices = nullptr);
+Tensor avg_pool1d(const Tensor& input, const Pool1dParams& params,
+                  MemoryFormat format = MemoryFormat::ChannelsFirst);
+Tensor adaptive_max_pool1d(const Tensor& input, int32_t out_l,
+                           MemoryFormat format = MemoryFormat::ChannelsFirst,
+                           Tensor* indices = nullptr);
+Tensor adaptive_avg_pool1d(const Tensor& input, int32_t out_l,
+                           MemoryFormat format = MemoryFormat::ChannelsFirst);
+
+// Scatters grad_output into a zero-initialised gradient of `input_shape`
+// using the indices produced by a max pooling forward pass (1D or 2D).
+// Throws std::invalid_argument for an index outside the input plane.
+Tensor max_pool2d_backward(const Tensor& grad_output, const Tensor& indices,
+                           const Shape& input_shape,
+                           MemoryFormat format = MemoryFormat::ChannelsFirst);
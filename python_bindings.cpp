@@ -0,0 +1,605 @@
+// Python extension module `tensor_ext`. Build it as a shared library from
+// this file plus the library sources, with `python3-config --includes` on
+// the include path and `python3-config --extension-suffix` on the output.
+//
+// Every compute-bound op runs with the GIL released, so several Python
+// threads can drive the C++ thread pool at once. Each op also has an
+// `_async` variant that returns an asyncio future; the work runs on a
+// small set of executor threads and the result is posted back to the
+// event loop. Functions use the vectorcall (METH_FASTCALL) convention
+// with positional arguments, and the Python objects needed on the hot
+// path are looked up once at import, keeping per-call overhead in the
+// hundreds of nanoseconds.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "pooling.h"
+#include "tensor.h"
+#include "tensor_hash.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// ========================================
+// Tensor type
+// ========================================
+struct PyTensor {
+    PyObject_HEAD
+    Tensor tensor;
+};
+
+PyTypeObject* g_tensor_type = nullptr;
+
+PyObject* wrap_tensor(Tensor t) {
+    PyObject* obj = g_tensor_type->tp_alloc(g_tensor_type, 0);
+    if (!obj) return nullptr;
+    new (&reinterpret_cast<PyTensor*>(obj)->tensor) Tensor(std::move(t));
+    return obj;
+}
+
+void tensor_dealloc(PyObject* self) {
+    PyTypeObject* type = Py_TYPE(self);
+    reinterpret_cast<PyTensor*>(self)->tensor.~Tensor();
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+const char* buffer_format(Dtype dtype) {
+    switch (dtype) {
+        case Dtype::UInt8:    return "B";
+        case Dtype::Int16:    return "h";
+        case Dtype::Int32:    return "i";
+        case Dtype::Int64:    return "q";
+        case Dtype::Bfloat16: return "H"; // no buffer code; exposed as raw 16-bit
+        case Dtype::Float16:  return "e";
+        case Dtype::Float32:  return "f";
+        case Dtype::Float64:  return "d";
+    }
+    return "B";
+}
+
+const char* dtype_name(Dtype dtype) {
+    switch (dtype) {
+        case Dtype::UInt8:    return "uint8";
+        case Dtype::Int16:    return "int16";
+        case Dtype::Int32:    return "int32";
+        case Dtype::Int64:    return "int64";
+        case Dtype::Bfloat16: return "bfloat16";
+        case Dtype::Float16:  return "float16";
+        case Dtype::Float32:  return "float32";
+        case Dtype::Float64:  return "float64";
+    }
+    return "unknown";
+}
+
+bool dtype_from_format(const char* format, Py_ssize_t itemsize, Dtype* out) {
+    if (!format) format = "B";
+    if (*format == '@' || *format == '=' || *format == '<') ++format;
+    if (format[0] == '\0' || format[1] != '\0') return false;
+    switch (format[0]) {
+        case 'B': *out = Dtype::UInt8; return true;
+        case 'h': *out = Dtype::Int16; return true;
+        case 'i': *out = Dtype::Int32; return itemsize == 4;
+        case 'l': case 'q': *out = Dtype::Int64; return itemsize == 8;
+        case 'e': *out = Dtype::Float16; return true;
+        case 'f': *out = Dtype::Float32; return true;
+        case 'd': *out = Dtype::Float64; return true;
+        default: return false;
+    }
+}
+
+// Exported buffers keep the storage pinned (resident) until released
+struct BufferExport {
+    StoragePin pin;
+    std::shared_ptr<Storage> writer; // set for writable exports
+    std::vector<Py_ssize_t> shape;
+    std::vector<Py_ssize_t> strides;
+};
+
+int tensor_getbuffer(PyObject* self, Py_buffer* view, int flags) {
+    Tensor& t = reinterpret_cast<PyTensor*>(self)->tensor;
+    if (!t.storage()) {
+        PyErr_SetString(PyExc_BufferError, "Tensor has no storage.");
+        return -1;
+    }
+    const bool readonly = t.is_read_only();
+    if (readonly && (flags & PyBUF_WRITABLE)) {
+        PyErr_SetString(PyExc_BufferError, "Tensor is read-only.");
+        return -1;
+    }
+    auto* exp = new BufferExport{t.pin(), readonly ? nullptr : t.storage(), {}, {}};
+    const Py_ssize_t itemsize = static_cast<Py_ssize_t>(dtype_size(t.dtype()));
+    for (size_t i = 0; i < t.shape().size(); ++i) {
+        exp->shape.push_back(t.shape()[i]);
+        exp->strides.push_back(static_cast<Py_ssize_t>(t.stride()[i]) * itemsize);
+    }
+    if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !t.is_contiguous()) {
+        delete exp;
+        PyErr_SetString(PyExc_BufferError, "Tensor is not contiguous.");
+        return -1;
+    }
+    // A writable export counts as a write for incremental checkpoints, and
+    // stores through it are untracked until it is released
+    if (exp->writer) exp->writer->add_untracked_writer();
+    view->buf = readonly ? const_cast<uint8_t*>(std::as_const(t).data<uint8_t>()) : t.data<uint8_t>();
+    view->obj = Py_NewRef(self);
+    view->len = static_cast<Py_ssize_t>(t.nbytes());
+    view->readonly = readonly ? 1 : 0;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(buffer_format(t.dtype())) : nullptr;
+    view->ndim = static_cast<int>(exp->shape.size());
+    view->shape = (flags & PyBUF_ND) ? exp->shape.data() : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? exp->strides.data() : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = exp;
+    return 0;
+}
+
+void tensor_releasebuffer(PyObject*, Py_buffer* view) {
+    auto* exp = static_cast<BufferExport*>(view->internal);
+    if (exp->writer) exp->writer->remove_untracked_writer();
+    delete exp;
+}
+
+PyObject* tensor_get_shape(PyObject* self, void*) {
+    const auto& dims = reinterpret_cast<PyTensor*>(self)->tensor.shape();
+    PyObject* tuple = PyTuple_New(static_cast<Py_ssize_t>(dims.size()));
+    if (!tuple) return nullptr;
+    for (size_t i = 0; i < dims.size(); ++i) {
+        PyTuple_SET_ITEM(tuple, static_cast<Py_ssize_t>(i), PyLong_FromLong(dims[i]));
+    }
+    return tuple;
+}
+
+PyObject* tensor_get_dtype(PyObject* self, void*) {
+    return PyUnicode_FromString(dtype_name(reinterpret_cast<PyTensor*>(self)->tensor.dtype()));
+}
+
+PyObject* tensor_get_nbytes(PyObject* self, void*) {
+    return PyLong_FromSize_t(reinterpret_cast<PyTensor*>(self)->tensor.nbytes());
+}
+
+PyGetSetDef tensor_getset[] = {
+    {"shape", tensor_get_shape, nullptr, nullptr, nullptr},
+    {"dtype", tensor_get_dtype, nullptr, nullptr, nullptr},
+    {"nbytes", tensor_get_nbytes, nullptr, nullptr, nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+PyType_Slot tensor_slots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void*>(tensor_dealloc)},
+    {Py_tp_getset, tensor_getset},
+    {Py_bf_getbuffer, reinterpret_cast<void*>(tensor_getbuffer)},
+    {Py_bf_releasebuffer, reinterpret_cast<void*>(tensor_releasebuffer)},
+    {0, nullptr},
+};
+
+PyType_Spec tensor_spec = {"tensor_ext.Tensor", sizeof(PyTensor), 0, Py_TPFLAGS_DEFAULT, tensor_slots};
+
+// ========================================
+// Helper: Argument parsing
+// ========================================
+bool check_nargs(const char* name, Py_ssize_t nargs, Py_ssize_t min, Py_ssize_t max) {
+    if (nargs >= min && nargs <= max) return true;
+    PyErr_Format(PyExc_TypeError, "%s() takes %zd to %zd positional arguments (%zd given)",
+                 name, min, max, nargs);
+    return false;
+}
+
+bool tensor_arg(PyObject* obj, Tensor* out) {
+    if (!PyObject_TypeCheck(obj, g_tensor_type)) {
+        PyErr_SetString(PyExc_TypeError, "expected a tensor_ext.Tensor");
+        return false;
+    }
+    *out = reinterpret_cast<PyTensor*>(obj)->tensor;
+    return true;
+}
+
+// Optional int argument `i`, `fallback` when absent
+bool int_arg(PyObject* const* args, Py_ssize_t nargs, Py_ssize_t i, int32_t fallback, int32_t* out) {
+    if (i >= nargs) {
+        *out = fallback;
+        return true;
+    }
+    const long v = PyLong_AsLong(args[i]);
+    if (v == -1 && PyErr_Occurred()) return false;
+    *out = static_cast<int32_t>(v);
+    return true;
+}
+
+bool bool_arg(PyObject* const* args, Py_ssize_t nargs, Py_ssize_t i, bool* out) {
+    if (i >= nargs) {
+        *out = false;
+        return true;
+    }
+    const int v = PyObject_IsTrue(args[i]);
+    if (v < 0) return false;
+    *out = v != 0;
+    return true;
+}
+
+// ========================================
+// Op plumbing
+// ========================================
+// An op parses its arguments under the GIL into a Work closure. Work runs
+// without the GIL and returns a Finish closure, which builds the Python
+// result once the GIL is held again.
+using Finish = std::function<PyObject*()>;
+using Work = std::function<Finish()>;
+using Parser = bool (*)(PyObject* const* args, Py_ssize_t nargs, Work* out);
+
+Finish tensor_result(Tensor t) {
+    return [t = std::move(t)]() mutable { return wrap_tensor(std::move(t)); };
+}
+
+// Converts a C++ exception into a new Python exception instance
+PyObject* exception_object(const std::exception_ptr& error) {
+    PyObject* type = PyExc_RuntimeError;
+    const char* what = "unknown C++ exception";
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::invalid_argument& e) {
+        type = PyExc_ValueError;
+        what = e.what();
+    } catch (const std::out_of_range& e) {
+        type = PyExc_IndexError;
+        what = e.what();
+    } catch (const std::bad_alloc& e) {
+        type = PyExc_MemoryError;
+        what = e.what();
+    } catch (const std::exception& e) {
+        what = e.what();
+    } catch (...) {
+    }
+    return PyObject_CallFunction(type, "s", what);
+}
+
+template <Parser P>
+PyObject* sync_op(PyObject*, PyObject* const* args, Py_ssize_t nargs) {
+    Work work;
+    if (!P(args, nargs, &work)) return nullptr;
+    Finish finish;
+    std::exception_ptr error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        finish = work();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    Py_END_ALLOW_THREADS
+    if (error) {
+        PyObject* exc = exception_object(error);
+        if (exc) {
+            PyErr_SetObject(reinterpret_cast<PyObject*>(Py_TYPE(exc)), exc);
+            Py_DECREF(exc);
+        }
+        return nullptr;
+    }
+    return finish();
+}
+
+// ========================================
+// Async executor
+// ========================================
+constexpr size_t kAsyncThreads = 2;
+
+// Looked up once at import
+PyObject* g_get_running_loop = nullptr;
+PyObject* g_str_create_future = nullptr;
+PyObject* g_str_call_soon_threadsafe = nullptr;
+PyObject* g_resolve = nullptr;
+
+struct AsyncTask {
+    Work work;
+    PyObject* loop;   // strong references, released under the GIL
+    PyObject* future;
+};
+
+class AsyncExecutor {
+public:
+    void submit(AsyncTask task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (threads_.empty()) {
+                for (size_t i = 0; i < kAsyncThreads; ++i) threads_.emplace_back([this] { loop(); });
+            }
+            queue_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    // Called with the GIL held (at interpreter exit)
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        Py_BEGIN_ALLOW_THREADS
+        for (auto& t : threads_) t.join();
+        Py_END_ALLOW_THREADS
+        threads_.clear();
+        for (AsyncTask& task : queue_) {
+            Py_DECREF(task.loop);
+            Py_DECREF(task.future);
+        }
+        queue_.clear();
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            AsyncTask task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                if (stop_) return;
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            Finish finish;
+            std::exception_ptr error;
+            try {
+                finish = task.work();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            complete(task, finish, error);
+        }
+    }
+
+    static void complete(AsyncTask& task, Finish& finish, const std::exception_ptr& error) {
+        PyGILState_STATE gil = PyGILState_Ensure();
+        PyObject* value = error ? exception_object(error) : finish();
+        finish = nullptr; // drop the result's C++ references under the GIL
+        bool is_error = static_cast<bool>(error);
+        if (!value) {
+            // Building the result failed: deliver that Python error instead
+            PyObject* type;
+            PyObject* traceback;
+            PyErr_Fetch(&type, &value, &traceback);
+            PyErr_NormalizeException(&type, &value, &traceback);
+            Py_XDECREF(type);
+            Py_XDECREF(traceback);
+            is_error = true;
+        }
+        PyObject* r = PyObject_CallMethodObjArgs(task.loop, g_str_call_soon_threadsafe, g_resolve,
+                                                 task.future, value, is_error ? Py_True : Py_False,
+                                                 nullptr);
+        if (!r) PyErr_Clear(); // the loop was closed; nobody is waiting
+        Py_XDECREF(r);
+        Py_XDECREF(value);
+        Py_DECREF(task.loop);
+        Py_DECREF(task.future);
+        PyGILState_Release(gil);
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<AsyncTask> queue_;
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+};
+
+AsyncExecutor& executor() {
+    static AsyncExecutor* e = new AsyncExecutor; // shut down explicitly at exit
+    return *e;
+}
+
+template <Parser P>
+PyObject* async_op(PyObject*, PyObject* const* args, Py_ssize_t nargs) {
+    Work work;
+    if (!P(args, nargs, &work)) return nullptr;
+    PyObject* loop = PyObject_CallNoArgs(g_get_running_loop);
+    if (!loop) return nullptr;
+    PyObject* future = PyObject_CallMethodNoArgs(loop, g_str_create_future);
+    if (!future) {
+        Py_DECREF(loop);
+        return nullptr;
+    }
+    Py_INCREF(future); // one reference for the task, one returned
+    executor().submit({std::move(work), loop, future});
+    return future;
+}
+
+// _resolve(future, value, is_error), run on the event loop thread
+PyObject* resolve(PyObject*, PyObject* const* args, Py_ssize_t nargs) {
+    if (!check_nargs("_resolve", nargs, 3, 3)) return nullptr;
+    PyObject* done = PyObject_CallMethod(args[0], "done", nullptr);
+    if (!done) return nullptr;
+    const int is_done = PyObject_IsTrue(done);
+    Py_DECREF(done);
+    if (is_done) Py_RETURN_NONE; // cancelled while running
+    return PyObject_CallMethod(args[0], PyObject_IsTrue(args[2]) ? "set_exception" : "set_result",
+                               "O", args[1]);
+}
+
+PyObject* shutdown(PyObject*, PyObject*) {
+    executor().shutdown();
+    Py_RETURN_NONE;
+}
+
+// ========================================
+// Ops
+// ========================================
+bool parse_clone(PyObject* const* args, Py_ssize_t nargs, Work* out) {
+    Tensor x;
+    if (!check_nargs("clone", nargs, 1, 1) || !tensor_arg(args[0], &x)) return false;
+    *out = [x] { return tensor_result(x.clone()); };
+    return true;
+}
+
+bool parse_hash(PyObject* const* args, Py_ssize_t nargs, Work* out) {
+    Tensor x;
+    if (!check_nargs("hash_tensor", nargs, 1, 1) || !tensor_arg(args[0], &x)) return false;
+    *out = [x]() -> Finish {
+        const uint64_t h = hash_tensor(x);
+        return [h] { return PyLong_FromUnsignedLongLong(h); };
+    };
+    return true;
+}
+
+// (x, kernel_h, kernel_w, stride_h=0, stride_w=0, pad_h=0, pad_w=0, channels_last=False)
+bool parse_pool2d_args(const char* name, PyObject* const* args, Py_ssize_t nargs,
+                       Tensor* x, Pool2dParams* p, MemoryFormat* format) {
+    bool channels_last = false;
+    if (!check_nargs(name, nargs, 3, 8) || !tensor_arg(args[0], x) ||
+        !int_arg(args, nargs, 1, 1, &p->kernel_h) || !int_arg(args, nargs, 2, 1, &p->kernel_w) ||
+        !int_arg(args, nargs, 3, 0, &p->stride_h) || !int_arg(args, nargs, 4, 0, &p->stride_w) ||
+        !int_arg(args, nargs, 5, 0, &p->pad_h) || !int_arg(args, nargs, 6, 0, &p->pad_w) ||
+        !bool_arg(args, nargs, 7, &channels_last)) {
+        return false;
+    }
+    *format = channels_last ? MemoryFormat::ChannelsLast : MemoryFormat::ChannelsFirst;
+    return true;
+}
+
+bool parse_max_pool2d(PyObject* const* args, Py_ssize_t nargs, Work* out) {
+    Tensor x;
+    Pool2dParams p;
+    MemoryFormat format;
+    if (!parse_pool2d_args("max_pool2d", args, nargs, &x, &p, &format)) return false;
+    *out = [x, p, format] { return tensor_result(max_pool2d(x, p, format)); };
+    return true;
+}
+
+bool parse_avg_pool2d(PyObject* const* args, Py_ssize_t nargs, Work* out) {
+    Tensor x;
+    Pool2dParams p;
+    MemoryFormat format;
+    if (!parse_pool2d_args("avg_pool2d", args, nargs, &x, &p, &format)) return false;
+    *out = [x, p, format] { return tensor_result(avg_pool2d(x, p, format)); };
+    return true;
+}
+
+// (x, out_h, out_w, channels_last=False)
+bool parse_adaptive_avg_pool2d(PyObject* const* args, Py_ssize_t nargs, Work* out) {
+    Tensor x;
+    int32_t oh, ow;
+    bool channels_last = false;
+    if (!check_nargs("adaptive_avg_pool2d", nargs, 3, 4) || !tensor_arg(args[0], &x) ||
+        !int_arg(args, nargs, 1, 1, &oh) || !int_arg(args, nargs, 2, 1, &ow) ||
+        !bool_arg(args, nargs, 3, &channels_last)) {
+        return false;
+    }
+    const MemoryFormat format = channels_last ? MemoryFormat::ChannelsLast : MemoryFormat::ChannelsFirst;
+    *out = [x, oh, ow, format] { return tensor_result(adaptive_avg_pool2d(x, oh, ow, format)); };
+    return true;
+}
+
+// from_buffer(obj): zero-copy view of any buffer-protocol object. The
+// tensor holds the buffer (and so the exporting object) until it is freed.
+PyObject* from_buffer(PyObject*, PyObject* const* args, Py_ssize_t nargs) {
+    if (!check_nargs("from_buffer", nargs, 1, 1)) return nullptr;
+    auto* view = new Py_buffer;
+    if (PyObject_GetBuffer(args[0], view, PyBUF_RECORDS) != 0) {
+        delete view;
+        return nullptr;
+    }
+    auto release = [](Py_buffer* v) {
+        PyGILState_STATE gil = PyGILState_Ensure();
+        PyBuffer_Release(v);
+        PyGILState_Release(gil);
+        delete v;
+    };
+    Dtype dtype;
+    if (!dtype_from_format(view->format, view->itemsize, &dtype)) {
+        PyErr_Format(PyExc_TypeError, "unsupported buffer format '%s'", view->format ? view->format : "B");
+        PyBuffer_Release(view);
+        delete view;
+        return nullptr;
+    }
+    std::vector<int32_t> dims, strides;
+    for (int i = 0; i < view->ndim; ++i) {
+        if (view->strides[i] % view->itemsize != 0) {
+            PyErr_SetString(PyExc_ValueError, "buffer strides must be multiples of the item size");
+            PyBuffer_Release(view);
+            delete view;
+            return nullptr;
+        }
+        dims.push_back(static_cast<int32_t>(view->shape[i]));
+        strides.push_back(static_cast<int32_t>(view->strides[i] / view->itemsize));
+    }
+    try {
+        Tensor t = Tensor::from_blob(view->buf, Shape(dims), Stride(strides), dtype,
+                                     [view, release](void*) { release(view); });
+        return wrap_tensor(std::move(t));
+    } catch (const std::exception& e) {
+        // from_blob only takes ownership once it succeeds
+        PyBuffer_Release(view);
+        delete view;
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return nullptr;
+    }
+}
+
+#define TENSOR_OP(name, parser, doc)                                                       \
+    {name, reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(sync_op<parser>)),   \
+     METH_FASTCALL, doc},                                                                  \
+    {name "_async", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(async_op<parser>)), \
+     METH_FASTCALL, doc " Returns an asyncio future."}
+
+PyMethodDef module_methods[] = {
+    {"from_buffer", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(from_buffer)),
+     METH_FASTCALL, "Wraps a buffer-protocol object as a Tensor without copying."},
+    TENSOR_OP("clone", parse_clone, "Deep copy of a tensor."),
+    TENSOR_OP("hash_tensor", parse_hash, "Content hash of a contiguous tensor."),
+    TENSOR_OP("max_pool2d", parse_max_pool2d, "2D max pooling."),
+    TENSOR_OP("avg_pool2d", parse_avg_pool2d, "2D average pooling."),
+    TENSOR_OP("adaptive_avg_pool2d", parse_adaptive_avg_pool2d, "2D adaptive average pooling."),
+    {"_shutdown", shutdown, METH_NOARGS, "Stops the async executor threads."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+#undef TENSOR_OP
+
+PyMethodDef resolve_def = {"_resolve", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(resolve)),
+                           METH_FASTCALL, nullptr};
+
+PyModuleDef module_def = {PyModuleDef_HEAD_INIT, "tensor_ext", "Tensor library bindings.", -1,
+                          module_methods, nullptr, nullptr, nullptr, nullptr};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_tensor_ext() {
+    PyObject* module = PyModule_Create(&module_def);
+    if (!module) return nullptr;
+
+    g_tensor_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&tensor_spec));
+    PyObject* asyncio = PyImport_ImportModule("asyncio");
+    PyObject* atexit = PyImport_ImportModule("atexit");
+    if (!g_tensor_type || !asyncio || !atexit) goto fail;
+    if (PyModule_AddObjectRef(module, "Tensor", reinterpret_cast<PyObject*>(g_tensor_type)) < 0) goto fail;
+
+    g_get_running_loop = PyObject_GetAttrString(asyncio, "get_running_loop");
+    g_str_create_future = PyUnicode_InternFromString("create_future");
+    g_str_call_soon_threadsafe = PyUnicode_InternFromString("call_soon_threadsafe");
+    g_resolve = PyCFunction_New(&resolve_def, nullptr);
+    if (!g_get_running_loop || !g_str_create_future || !g_str_call_soon_threadsafe || !g_resolve) goto fail;
+
+    // Join the executor threads before the interpreter goes away
+    {
+        PyObject* stop = PyObject_GetAttrString(module, "_shutdown");
+        PyObject* r = stop ? PyObject_CallMethod(atexit, "register", "O", stop) : nullptr;
+        Py_XDECREF(stop);
+        if (!r) goto fail;
+        Py_DECREF(r);
+    }
+    Py_DECREF(asyncio);
+    Py_DECREF(atexit);
+    return module;
+
+fail:
+    Py_XDECREF(asyncio);
+    Py_XDECREF(atexit);
+    Py_DECREF(module);
+    return nullptr;
+}
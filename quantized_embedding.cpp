@@ -0,0 +1,274 @@
+#include "quantized_embedding.h"
+#include "parallel.h"
+#include "index_dispatch.h"
+#include "isa_dispatch.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TENSOR_HAVE_X86 1
+#endif
+
+namespace {
+
+void check_bits(int bits) {
+    if (bits != 8 && bits != 4) {
+        throw std::invalid_argument("Quantized embeddings support 8 or 4 bits.");
+    }
+}
+
+// ========================================
+// Fused dequantize-accumulate: acc += a * code + b
+// ========================================
+void accumulate_row_scalar(const uint8_t* codes, int bits, size_t dim,
+                           float a, float b, float* acc) {
+    if (bits == 8) {
+        for (size_t d = 0; d < dim; ++d) acc[d] += a * static_cast<float>(codes[d]) + b;
+    } else {
+        for (size_t d = 0; d < dim; ++d) {
+            const uint8_t byte = codes[d >> 1];
+            const uint8_t code = (d & 1) ? (byte >> 4) : (byte & 0x0F);
+            acc[d] += a * static_cast<float>(code) + b;
+        }
+    }
+}
+
+#ifdef TENSOR_HAVE_X86
+__attribute__((target("avx2,fma")))
+void accumulate_row_avx2(const uint8_t* codes, int bits, size_t dim,
+                         float a, float b, float* acc) {
+    const __m256 va = _mm256_set1_ps(a);
+    const __m256 vb = _mm256_set1_ps(b);
+    size_t d = 0;
+    if (bits == 8) {
+        for (; d + 8 <= dim; d += 8) {
+            const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + d));
+            const __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(q));
+            _mm256_storeu_ps(acc + d, _mm256_add_ps(_mm256_loadu_ps(acc + d),
+                                                    _mm256_fmadd_ps(va, x, vb)));
+        }
+    } else {
+        const __m128i low_mask = _mm_set1_epi8(0x0F);
+        for (; d + 16 <= dim; d += 16) {
+            const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes + d / 2));
+            const __m128i lo = _mm_and_si128(q, low_mask);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(q, 4), low_mask);
+            const __m128i nib = _mm_unpacklo_epi8(lo, hi); // element order
+            const __m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(nib));
+            const __m256 x1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(nib, 8)));
+            _mm256_storeu_ps(acc + d, _mm256_add_ps(_mm256_loadu_ps(acc + d),
+                                                    _mm256_fmadd_ps(va, x0, vb)));
+            _mm256_storeu_ps(acc + d + 8, _mm256_add_ps(_mm256_loadu_ps(acc + d + 8),
+                                                        _mm256_fmadd_ps(va, x1, vb)));
+        }
+    }
+    // Tail (d is even for 4 bits, so byte alignment is preserved)
+    accumulate_row_scalar(codes + (bits == 8 ? d : d / 2), bits, dim - d, a, b, acc + d);
+}
+
+__attribute__((target("avx512f")))
+void accumulate_row_avx512(const uint8_t* codes, int bits, size_t dim,
+                           float a, float b, float* acc) {
+    const __m512 va = _mm512_set1_ps(a);
+    const __m512 vb = _mm512_set1_ps(b);
+    size_t d = 0;
+    if (bits == 8) {
+        for (; d + 16 <= dim; d += 16) {
+            const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + d));
+            const __m512 x = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(q));
+            _mm512_storeu_ps(acc + d, _mm512_add_ps(_mm512_loadu_ps(acc + d),
+                                                    _mm512_fmadd_ps(va, x, vb)));
+        }
+    } else {
+        const __m128i low_mask = _mm_set1_epi8(0x0F);
+        for (; d + 32 <= dim; d += 32) {
+            const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + d / 2));
+            const __m128i lo = _mm_and_si128(q, low_mask);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(q, 4), low_mask);
+            const __m512 x0 = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpacklo_epi8(lo, hi)));
+            const __m512 x1 = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpackhi_epi8(lo, hi)));
+            _mm512_storeu_ps(acc + d, _mm512_add_ps(_mm512_loadu_ps(acc + d),
+                                                    _mm512_fmadd_ps(va, x0, vb)));
+            _mm512_storeu_ps(acc + d + 16, _mm512_add_ps(_mm512_loadu_ps(acc + d + 16),
+                                                         _mm512_fmadd_ps(va, x1, vb)));
+        }
+    }
+    accumulate_row_scalar(codes + (bits == 8 ? d : d / 2), bits, dim - d, a, b, acc + d);
+}
+#endif
+
+using AccumulateFn = void (*)(const uint8_t*, int, size_t, float, float, float*);
+
+AccumulateFn accumulate_row(IsaLevel isa) {
+#ifdef TENSOR_HAVE_X86
+    if (isa == IsaLevel::Avx512) return &accumulate_row_avx512;
+    if (isa == IsaLevel::Avx2) return &accumulate_row_avx2;
+#endif
+    return &accumulate_row_scalar;
+}
+
+} // namespace
+
+// ========================================
+// Construction / quantization
+// ========================================
+size_t QuantizedEmbeddingTable::fused_row_bytes(size_t dim, int bits) {
+    check_bits(bits);
+    return (dim * static_cast<size_t>(bits) + 7) / 8 + 2 * sizeof(float);
+}
+
+QuantizedEmbeddingTable::QuantizedEmbeddingTable(Tensor fused_rows, int bits, size_t dim)
+    : rows_(std::move(fused_rows)), bits_(bits), dim_(dim)
+{
+    check_bits(bits);
+    if (rows_.dtype() != Dtype::UInt8 || rows_.shape().size() != 2 || !rows_.is_contiguous()) {
+        throw std::invalid_argument("Fused embedding rows must be a 2D UInt8 tensor.");
+    }
+    row_bytes_ = fused_row_bytes(dim, bits);
+    if (static_cast<size_t>(rows_.shape()[1]) != row_bytes_) {
+        throw std::invalid_argument("Fused row width does not match dim and bits.");
+    }
+    num_rows_ = static_cast<size_t>(rows_.shape()[0]);
+}
+
+QuantizedEmbeddingTable QuantizedEmbeddingTable::quantize(const Tensor& weights, int bits) {
+    check_bits(bits);
+    if (weights.dtype() != Dtype::Float32 || weights.shape().size() != 2 ||
+        !weights.is_contiguous()) {
+        throw std::invalid_argument("quantize expects a contiguous 2D Float32 tensor.");
+    }
+    const size_t rows = static_cast<size_t>(weights.shape()[0]);
+    const size_t dim = static_cast<size_t>(weights.shape()[1]);
+    const size_t row_bytes = fused_row_bytes(dim, bits);
+    const size_t code_bytes = row_bytes - 2 * sizeof(float);
+    const float levels = static_cast<float>((1 << bits) - 1);
+
+    const StoragePin keep = weights.pin(); // allocating `fused` may spill it
+    Tensor fused(Shape({static_cast<int32_t>(rows), static_cast<int32_t>(row_bytes)}),
+                 Dtype::UInt8, weights.device());
+    const float* src = weights.data<float>();
+    uint8_t* dst = fused.data<uint8_t>();
+
+    parallel_for(0, static_cast<int64_t>(rows), 64, [&](int64_t b, int64_t e) {
+        for (int64_t r = b; r < e; ++r) {
+            const float* x = src + r * dim;
+            uint8_t* out = dst + r * row_bytes;
+            const auto mm = std::minmax_element(x, x + dim);
+            const float lo = *mm.first, hi = *mm.second;
+            const float scale = (hi - lo) / levels;
+            const float inv = levels / (hi - lo + 1e-8f);
+
+            std::fill(out, out + code_bytes, uint8_t(0));
+            for (size_t d = 0; d < dim; ++d) {
+                const float q = std::nearbyint((x[d] - lo) * inv);
+                const auto code = static_cast<uint8_t>(std::min(std::max(q, 0.0f), levels));
+                if (bits == 8) {
+                    out[d] = code;
+                } else {
+                    out[d >> 1] |= static_cast<uint8_t>(code << ((d & 1) * 4));
+                }
+            }
+            std::memcpy(out + code_bytes, &scale, sizeof(float));
+            std::memcpy(out + code_bytes + sizeof(float), &lo, sizeof(float));
+        }
+    });
+    return QuantizedEmbeddingTable(std::move(fused), bits, dim);
+}
+
+Tensor QuantizedEmbeddingTable::dequantize() const {
+    Tensor out(Shape({static_cast<int32_t>(num_rows_), static_cast<int32_t>(dim_)}),
+               Dtype::Float32, rows_.device());
+    float* dst = out.data<float>();
+    std::fill(dst, dst + out.numel(), 0.0f);
+    const StoragePin keep = rows_.pin();
+    const uint8_t* base = rows_.data<uint8_t>();
+    const size_t code_bytes = row_bytes_ - 2 * sizeof(float);
+    static IsaCounter counter("quantized_embedding.dequantize");
+    const AccumulateFn acc = accumulate_row(select_isa(counter, static_cast<int64_t>(out.nbytes())));
+
+    parallel_for(0, static_cast<int64_t>(num_rows_), 256, [&](int64_t b, int64_t e) {
+        for (int64_t r = b; r < e; ++r) {
+            const uint8_t* row = base + r * row_bytes_;
+            float scale, bias;
+            std::memcpy(&scale, row + code_bytes, sizeof(float));
+            std::memcpy(&bias, row + code_bytes + sizeof(float), sizeof(float));
+            acc(row, bits_, dim_, scale, bias, dst + r * dim_);
+        }
+    });
+    return out;
+}
+
+// ========================================
+// Fused embedding bag
+// ========================================
+Tensor QuantizedEmbeddingTable::embedding_bag(const std::vector<int64_t>& indices,
+                                              const std::vector<int64_t>& offsets,
+                                              BagMode mode,
+                                              const std::vector<float>* per_sample_weights) const {
+    if (per_sample_weights && per_sample_weights->size() != indices.size()) {
+        throw std::invalid_argument("per_sample_weights must match indices in size.");
+    }
+    const int64_t num_bags = static_cast<int64_t>(offsets.size());
+    const int64_t num_indices = static_cast<int64_t>(indices.size());
+    if (num_bags == 0) {
+        throw std::invalid_argument("embedding_bag needs at least one bag.");
+    }
+    for (int64_t b = 0; b < num_bags; ++b) {
+        const int64_t end = b + 1 < num_bags ? offsets[b + 1] : num_indices;
+        if (offsets[b] < 0 || offsets[b] > end || end > num_indices) {
+            throw std::invalid_argument("embedding_bag offsets must be non-decreasing and in range.");
+        }
+    }
+    for (int64_t idx : indices) {
+        if (idx < 0 || static_cast<size_t>(idx) >= num_rows_) {
+            throw std::out_of_range("embedding_bag index out of range.");
+        }
+    }
+
+    Tensor out(Shape({static_cast<int32_t>(num_bags), static_cast<int32_t>(dim_)}),
+               Dtype::Float32, rows_.device());
+    float* dst = out.data<float>();
+    std::fill(dst, dst + out.numel(), 0.0f);
+
+    const StoragePin keep = rows_.pin();
+    const uint8_t* base = rows_.data<uint8_t>();
+    const size_t code_bytes = row_bytes_ - 2 * sizeof(float);
+    // Bytes touched: the output plus one dequantized row per lookup
+    static IsaCounter counter("quantized_embedding.embedding_bag");
+    const int64_t work = static_cast<int64_t>(out.nbytes() + indices.size() * dim_ * sizeof(float));
+    const AccumulateFn acc = accumulate_row(select_isa(counter, work));
+
+    // Row addressing width is chosen once from the table and output sizes
+    const int64_t extent = std::max<int64_t>(static_cast<int64_t>(rows_.nbytes()),
+                                             static_cast<int64_t>(out.numel()));
+    dispatch_index_type(extent, [&](auto index_tag) {
+        using IndexT = decltype(index_tag);
+        const IndexT row_bytes = static_cast<IndexT>(row_bytes_);
+        const IndexT dim = static_cast<IndexT>(dim_);
+
+        parallel_for(0, num_bags, 16, [&](int64_t b, int64_t e) {
+            for (int64_t bag = b; bag < e; ++bag) {
+                const int64_t begin = offsets[bag];
+                const int64_t end = bag + 1 < num_bags ? offsets[bag + 1] : num_indices;
+                float* o = dst + static_cast<IndexT>(bag) * dim;
+                for (int64_t i = begin; i < end; ++i) {
+                    const uint8_t* row = base + static_cast<IndexT>(indices[i]) * row_bytes;
+                    if (i + 1 < end) {
+                        __builtin_prefetch(base + static_cast<IndexT>(indices[i + 1]) * row_bytes);
+                    }
+                    float scale, bias;
+                    std::memcpy(&scale, row + code_bytes, sizeof(float));
+                    std::memcpy(&bias, row + code_bytes + sizeof(float), sizeof(float));
+                    const float w = per_sample_weights ? (*per_sample_weights)[i] : 1.0f;
+                    acc(row, bits_, dim_, w * scale, w * bias, o);
+                }
+                if (mode == BagMode::Mean && end > begin) {
+                    const float inv = 1.0f / static_cast<float>(end - begin);
+                    for (IndexT d = 0; d < dim; ++d) o[d] *= inv;
+                }
+            }
+        });
+    });
+    return out;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "tensor.h"
+
+// =============================
+// Row-wise Quantized Embeddings
+// =============================
+
+// How the rows of one bag are combined
+enum class BagMode {
+    Sum,
+    Mean
+};
+
+// Embedding table stored with 8 or 4 bits per element. Each row is laid out
+// as its packed codes followed by a Float32 scale and bias, so one row is a
+// single contiguous run of bytes:
+//
+//   [ ceil(dim * bits / 8) code bytes | scale (f32) | bias (f32) ]
+//
+// value = scale * code + bias. With 4 bits the low nibble holds the even
+// element. Rows are held in a (num_rows, row_bytes) UInt8 tensor.
+class QuantizedEmbeddingTable {
+public:
+    // Quantizes a (num_rows, dim) Float32 tensor row by row
+    static QuantizedEmbeddingTable quantize(const Tensor& weights, int bits);
+
+    // Wraps already fused rows, e.g. loaded from disk
+    QuantizedEmbeddingTable(Tensor fused_rows, int bits, size_t dim);
+
+    int bits() const { return bits_; }
+    size_t dim() const { return dim_; }
+    size_t num_rows() const { return num_rows_; }
+    size_t row_bytes() const { return row_bytes_; }
+    size_t nbytes() const { return rows_.nbytes(); }
+    const Tensor& fused_rows() const { return rows_; }
+
+    // Bytes per fused row for a given width and bit depth
+    static size_t fused_row_bytes(size_t dim, int bits);
+
+    // Reconstructs the full Float32 table (mainly for validation)
+    Tensor dequantize() const;
+
+    // Pools rows into bags, dequantizing on the fly. Bag b covers
+    // indices[offsets[b] .. offsets[b + 1]) (the last bag runs to the end).
+    // Optional per_sample_weights scale each looked-up row; empty bags
+    // produce zeros. Returns a (num_bags, dim) Float32 tensor.
+    Tensor embedding_bag(const std::vector<int64_t>& indices,
+                         const std::vector<int64_t>& offsets,
+                         BagMode mode = BagMode::Sum,
+                         const std::vector<float>* per_sample_weights = nullptr) const;
+
+private:
+    Tensor rows_;
+    int bits_ = 8;
+    size_t dim_ = 0;
+    size_t num_rows_ = 0;
+    size_t row_bytes_ = 0;
+};
@@ -0,0 +1,85 @@
+#include "scratch_arena.h"
+#include <algorithm>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+
+namespace {
+
+constexpr size_t kMinBlock = size_t(1) << 20;
+
+size_t round_up(size_t n, size_t a) { return (n + a - 1) / a * a; }
+
+uint8_t* map_block(size_t size) {
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_DONTFORK
+    ::madvise(p, size, MADV_DONTFORK);
+#endif
+    return static_cast<uint8_t*>(p);
+}
+
+} // namespace
+
+ScratchArena& ScratchArena::local() {
+    static const int registered = ::pthread_atfork(nullptr, nullptr, &drop_blocks_in_child);
+    (void)registered;
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+void ScratchArena::drop_blocks_in_child() {
+    // Nothing to unmap: the range may already hold the child's own mappings
+    ScratchArena& arena = local();
+    arena.blocks_.clear();
+    arena.current_ = 0;
+    arena.offset_ = 0;
+}
+
+ScratchArena::~ScratchArena() {
+    for (const auto& b : blocks_) ::munmap(b.base, b.size);
+}
+
+// ========================================
+// Bump allocation
+// ========================================
+void* ScratchArena::allocate(size_t nbytes, size_t alignment) {
+    nbytes = std::max<size_t>(nbytes, 1);
+    while (current_ < blocks_.size()) {
+        Block& b = blocks_[current_];
+        const size_t start = round_up(offset_, alignment);
+        if (start + nbytes <= b.size) {
+            offset_ = start + nbytes;
+            return b.base + start;
+        }
+        ++current_;
+        offset_ = 0;
+    }
+    // Blocks are page aligned, so offset 0 satisfies any alignment <= 4096
+    const size_t size = round_up(std::max(nbytes, kMinBlock), 4096);
+    blocks_.push_back({map_block(size), size});
+    current_ = blocks_.size() - 1;
+    offset_ = nbytes;
+    return blocks_.back().base;
+}
+
+void ScratchArena::release(const Marker& m) {
+    current_ = m.block;
+    offset_ = m.offset;
+}
+
+void ScratchArena::trim() {
+    while (blocks_.size() > 1) {
+        ::munmap(blocks_.back().base, blocks_.back().size);
+        blocks_.pop_back();
+    }
+    current_ = 0;
+    offset_ = 0;
+}
+
+size_t ScratchArena::reserved_bytes() const {
+    size_t total = 0;
+    for (const auto& b : blocks_) total += b.size;
+    return total;
+}
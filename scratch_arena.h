@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =============================
+// Scratch Arena
+// =============================
+
+// Per-thread bump allocator for kernel temporaries. Blocks are mapped
+// directly with mmap and marked MADV_DONTFORK: scratch memory is never
+// part of a tensor, so a forked snapshot child neither inherits nor
+// copy-on-write faults on it. A fork handler empties the forking thread's
+// arena in the child, which maps fresh blocks on its next allocation;
+// scratch pointers taken before the fork are not valid in the child.
+class ScratchArena {
+public:
+    // Position in the arena; releasing to a marker frees everything after it
+    struct Marker {
+        size_t block = 0;
+        size_t offset = 0;
+    };
+
+    // Arena of the calling thread
+    static ScratchArena& local();
+
+    ScratchArena() = default;
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void* allocate(size_t nbytes, size_t alignment = 64);
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T) > 64 ? alignof(T) : 64));
+    }
+
+    Marker mark() const { return {current_, offset_}; }
+    void release(const Marker& m);
+
+    // Unmaps every block except the first (kept for reuse)
+    void trim();
+
+    size_t reserved_bytes() const;
+
+private:
+    // pthread_atfork child handler: the blocks were not inherited
+    static void drop_blocks_in_child();
+
+    struct Block {
+        uint8_t* base;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+};
+
+// Releases everything allocated from the thread's arena within this scope
+class ScratchScope {
+public:
+    ScratchScope() : arena_(ScratchArena::local()), mark_(arena_.mark()) {}
+    ~ScratchScope() { arena_.release(mark_); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    template <typename T>
+    T* alloc(size_t count) { return arena_.allocate_array<T>(count); }
+
+private:
+    ScratchArena& arena_;
+    ScratchArena::Marker mark_;
+};
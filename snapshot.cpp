@@ -0,0 +1,73 @@
+#include "snapshot.h"
+#include "checkpoint.h"
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// ========================================
+// Child side
+// ========================================
+namespace {
+
+[[noreturn]] void run_child(const std::string& directory, const std::string& name,
+                            const std::map<std::string, Tensor>& tensors) {
+    // Only async-signal-safe exits from here: the parent's threads do not
+    // exist in the child, so static destructors (thread pool) must not run
+    int code = 0;
+    try {
+        if (::nice(10) == -1) { /* best effort */ }
+        CheckpointWriter writer(directory);
+        writer.write(name, tensors);
+    } catch (...) {
+        code = 1;
+    }
+    ::_exit(code);
+}
+
+} // namespace
+
+// ========================================
+// Parent side
+// ========================================
+SnapshotHandle start_snapshot(const std::string& directory, const std::string& name,
+                              const std::map<std::string, Tensor>& tensors) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<StoragePin> pins;
+    pins.reserve(tensors.size());
+    for (const auto& kv : tensors) {
+        pins.push_back(kv.second.pin());
+        kv.second.data<uint8_t>(); // page in spilled or compressed storage
+    }
+
+    const pid_t pid = ::fork();
+    if (pid < 0) throw std::runtime_error("fork() failed for snapshot.");
+    if (pid == 0) run_child(directory, name, tensors);
+
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return SnapshotHandle(pid, latency);
+}
+
+bool SnapshotHandle::running() {
+    if (pid_ < 0 || status_ >= 0) return false;
+    int status = 0;
+    const pid_t r = ::waitpid(pid_, &status, WNOHANG);
+    if (r == 0) return true;
+    status_ = (r == pid_ && WIFEXITED(status)) ? WEXITSTATUS(status) : 1;
+    return false;
+}
+
+bool SnapshotHandle::wait() {
+    if (pid_ < 0) return false;
+    if (status_ < 0) {
+        int status = 0;
+        pid_t r;
+        do {
+            r = ::waitpid(pid_, &status, 0);
+        } while (r < 0 && errno == EINTR);
+        status_ = (r == pid_ && WIFEXITED(status)) ? WEXITSTATUS(status) : 1;
+    }
+    return status_ == 0;
+}
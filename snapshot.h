@@ -0,0 +1,45 @@
+#pragma once
+
+#include "tensor.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+// =============================
+// Background Snapshots
+// =============================
+
+// A checkpoint being written by a forked child process. The child sees the
+// tensors exactly as they were at fork time (the OS copies pages only when
+// the parent writes them) and writes them with CheckpointWriter, while the
+// parent carries on immediately.
+class SnapshotHandle {
+public:
+    SnapshotHandle() = default;
+    SnapshotHandle(pid_t pid, std::chrono::microseconds fork_latency)
+        : pid_(pid), fork_latency_(fork_latency) {}
+
+    pid_t pid() const { return pid_; }
+
+    // Time the parent spent inside start_snapshot()
+    std::chrono::microseconds fork_latency() const { return fork_latency_; }
+
+    // True while the child is still writing (non-blocking)
+    bool running();
+
+    // Waits for the child; true if the checkpoint was written successfully
+    bool wait();
+
+private:
+    pid_t pid_ = -1;
+    std::chrono::microseconds fork_latency_{0};
+    int status_ = -1;
+};
+
+// Forks and writes <directory>/<name>.ckpt from the child. All tensors are
+// made resident and pinned across the fork so the child never has to page
+// in, take allocator locks or start threads. Other threads must not mutate
+// the tensors while this call runs; afterwards they may freely.
+SnapshotHandle start_snapshot(const std::string& directory, const std::string& name,
+                              const std::map<std::string, Tensor>& tensors);
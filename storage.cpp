@@ -0,0 +1,153 @@
+#include "storage.h"
+#include "allocator.h"
+#include "compression.h"
+#include <algorithm>
+#include <stdexcept>
+
+// ========================================
+// Construction / destruction
+// ========================================
+Storage::Storage(size_t nbytes) : nbytes_(nbytes) {
+    TensorAllocator& alloc = TensorAllocator::instance();
+    ptr_ = static_cast<uint8_t*>(alloc.allocate(nbytes_));
+    last_access_.store(alloc.now(), std::memory_order_relaxed);
+}
+
+Storage::Storage(void* external, size_t nbytes, Deleter deleter)
+    : ptr_(static_cast<uint8_t*>(external)),
+      nbytes_(nbytes),
+      external_(true),
+      deleter_(std::move(deleter))
+{
+    if (!external && nbytes > 0) {
+        throw std::invalid_argument("Cannot wrap a null pointer as tensor storage.");
+    }
+    last_access_.store(TensorAllocator::instance().now(), std::memory_order_relaxed);
+}
+
+Storage::~Storage() {
+    if (external_) {
+        if (deleter_) deleter_(ptr_);
+        return;
+    }
+    TensorAllocator& alloc = TensorAllocator::instance();
+    if (spillable_.load()) alloc.unregister_spillable(this);
+
+    switch (state_.load()) {
+        case StorageState::Resident:
+            alloc.deallocate(ptr_, nbytes_);
+            break;
+        case StorageState::Spilled:
+            alloc.swap_release(swap_offset_, nbytes_);
+            break;
+        case StorageState::Compressed:
+            alloc.note_decompressed(nbytes_, compressed_->compressed_size(), false);
+            break;
+    }
+}
+
+// ========================================
+// Spill policy hooks
+// ========================================
+size_t Storage::alignment() const {
+    const auto addr = reinterpret_cast<uintptr_t>(ptr_);
+    if (addr == 0) return 4096;
+    return std::min<size_t>(static_cast<size_t>(addr & (~addr + 1)), 4096);
+}
+
+void Storage::set_spillable(bool spillable) {
+    if (external_ && spillable) {
+        throw std::runtime_error("External storage cannot be spilled.");
+    }
+    if (spillable_.exchange(spillable) == spillable) return;
+    TensorAllocator& alloc = TensorAllocator::instance();
+    if (spillable) {
+        alloc.register_spillable(this);
+    } else {
+        alloc.unregister_spillable(this);
+        data(); // a storage that may no longer spill must be resident
+    }
+}
+
+void Storage::pin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pins_.fetch_add(1);
+}
+
+void Storage::unpin() {
+    pins_.fetch_sub(1);
+}
+
+uint64_t Storage::clock() {
+    return TensorAllocator::instance().now();
+}
+
+// ========================================
+// Restore (page-in / decompress) / spill / compress
+// ========================================
+uint8_t* Storage::data_slow() {
+    TensorAllocator& alloc = TensorAllocator::instance();
+    std::lock_guard<std::mutex> lock(mutex_);
+    const StorageState state = state_.load();
+    if (state != StorageState::Resident) {
+        // Paging in never evicts: the caller may hold pointers into other
+        // storages it read a moment ago. Usage can briefly exceed the limit
+        // until the next ordinary allocation spills.
+        pins_.fetch_add(1);
+        uint8_t* fresh = nullptr;
+        try {
+            fresh = static_cast<uint8_t*>(alloc.allocate_resident(nbytes_));
+            if (state == StorageState::Spilled) {
+                alloc.swap_read(swap_offset_, fresh, nbytes_);
+                alloc.swap_release(swap_offset_, nbytes_);
+                alloc.note_page_in(nbytes_);
+                swap_offset_ = -1;
+            } else {
+                decompress_bytes(*compressed_, fresh); // parallel over blocks
+                alloc.note_decompressed(nbytes_, compressed_->compressed_size(), true);
+                compressed_.reset();
+            }
+        } catch (...) {
+            if (fresh) alloc.deallocate(fresh, nbytes_);
+            pins_.fetch_sub(1);
+            throw;
+        }
+        ptr_ = fresh;
+        state_.store(StorageState::Resident, std::memory_order_release);
+        pins_.fetch_sub(1);
+    }
+    touch();
+    return ptr_;
+}
+
+size_t Storage::compress(size_t element_size) {
+    if (external_) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pins_.load() > 0 || state_.load() != StorageState::Resident) return 0;
+
+    auto packed = std::make_unique<CompressedBuffer>(compress_bytes(ptr_, nbytes_, element_size));
+    const size_t packed_size = packed->compressed_size();
+    if (packed_size >= nbytes_) return 0;
+
+    TensorAllocator& alloc = TensorAllocator::instance();
+    compressed_ = std::move(packed);
+    state_.store(StorageState::Compressed, std::memory_order_release);
+    alloc.deallocate(ptr_, nbytes_);
+    ptr_ = nullptr;
+    alloc.note_compressed(nbytes_, packed_size);
+    return nbytes_ - packed_size;
+}
+
+size_t Storage::try_spill() {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || pins_.load() > 0 ||
+        state_.load() != StorageState::Resident || !spillable_.load()) {
+        return 0;
+    }
+    TensorAllocator& alloc = TensorAllocator::instance();
+    swap_offset_ = alloc.swap_write(ptr_, nbytes_);
+    state_.store(StorageState::Spilled, std::memory_order_release);
+    alloc.deallocate(ptr_, nbytes_);
+    ptr_ = nullptr;
+    return nbytes_;
+}
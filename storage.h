@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+// =============================
+// Storage
+// =============================
+
+// Where the bytes of a storage currently live
+enum class StorageState {
+    Resident,   // in memory
+    Spilled,    // in the allocator's swap file
+    Compressed  // compressed in memory
+};
+
+struct CompressedBuffer;
+
+// Backing memory shared by tensors. Storage allocated through the
+// TensorAllocator counts against its soft memory limit; storages marked
+// spillable may be written to disk under memory pressure, and cold storages
+// may be compressed in memory. Either way data() restores the bytes
+// transparently.
+//
+// A pointer returned by data() for a spillable storage stays valid only
+// until the next allocation that crosses the memory limit (paging another
+// storage in never spills), and one for a tracked cold storage only until
+// the next scan. Hold a StoragePin while working through raw pointers to
+// keep the bytes resident; the library's kernels pin their operands for
+// the length of each op.
+class Storage {
+public:
+    // Releases memory owned by someone else (e.g. a decoder's buffer)
+    using Deleter = std::function<void(void*)>;
+
+    explicit Storage(size_t nbytes);
+
+    // Wraps external memory without copying. With a deleter the storage
+    // owns the memory and calls the deleter on destruction; without one it
+    // merely borrows it. External memory is not counted against the
+    // allocator's limit and is never spilled or compressed.
+    Storage(void* external, size_t nbytes, Deleter deleter);
+
+    ~Storage();
+
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    // Pointer to the bytes, paging them back in if needed
+    uint8_t* data() {
+        if (state_.load(std::memory_order_acquire) == StorageState::Resident) {
+            touch();
+            return ptr_;
+        }
+        return data_slow();
+    }
+
+    // Pointer for writing; bumps the version counter. Throws
+    // std::logic_error for a read-only storage.
+    uint8_t* mutable_data() {
+        if (read_only_.load(std::memory_order_relaxed)) {
+            throw std::logic_error("Cannot write to read-only tensor storage.");
+        }
+        version_.fetch_add(1, std::memory_order_relaxed);
+        return data();
+    }
+
+    // Freezes the bytes: every later mutable_data() call throws. Shared
+    // handles (TensorStore, TensorCache) set this so that copying a Tensor
+    // out of a const handle cannot yield a writable alias. Irreversible.
+    void set_read_only() { read_only_.store(true, std::memory_order_relaxed); }
+    bool read_only() const { return read_only_.load(std::memory_order_relaxed); }
+
+    // Incremented on every mutable access; lets checkpoints skip
+    // storages that cannot have changed
+    uint64_t version() const { return version_.load(std::memory_order_relaxed); }
+
+    // Writable aliases that store without going through mutable_data(),
+    // such as a writable Python buffer export. While any is live the
+    // version says nothing about the bytes; removing one bumps it.
+    void add_untracked_writer() { untracked_writers_.fetch_add(1, std::memory_order_relaxed); }
+    void remove_untracked_writer() {
+        version_.fetch_add(1, std::memory_order_relaxed);
+        untracked_writers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    bool has_untracked_writers() const { return untracked_writers_.load(std::memory_order_relaxed) > 0; }
+
+    size_t nbytes() const { return nbytes_; }
+    StorageState state() const { return state_.load(std::memory_order_acquire); }
+    bool is_resident() const { return state() == StorageState::Resident; }
+
+    bool is_external() const { return external_; }
+
+    // Largest power of two (up to 4096) the data address is aligned to
+    size_t alignment() const;
+
+    // Opt in or out of spilling under memory pressure
+    void set_spillable(bool spillable);
+    bool spillable() const { return spillable_.load(); }
+
+    // Pinned storages are never spilled
+    void pin();
+    void unpin();
+    bool pinned() const { return pins_.load() > 0; }
+
+    uint64_t last_access() const { return last_access_.load(std::memory_order_relaxed); }
+
+    // Compresses resident bytes in memory (elements of `element_size` bytes).
+    // Returns the bytes saved, or 0 if the storage is pinned, not resident or
+    // does not compress.
+    size_t compress(size_t element_size);
+
+    // Reads and clears the "accessed since last check" bit used by
+    // idle-time policies
+    bool test_and_clear_referenced() { return referenced_.exchange(false); }
+
+private:
+    friend class TensorAllocator;
+
+    void touch() {
+        const uint64_t now = clock();
+        if (last_access_.load(std::memory_order_relaxed) != now) {
+            last_access_.store(now, std::memory_order_relaxed);
+        }
+        if (!referenced_.load(std::memory_order_relaxed)) {
+            referenced_.store(true, std::memory_order_relaxed);
+        }
+    }
+    static uint64_t clock();
+    uint8_t* data_slow();
+
+    // Writes the bytes to the swap file and frees them. Returns the number
+    // of bytes released, or 0 if the storage is busy, pinned or not resident.
+    size_t try_spill();
+
+    std::mutex mutex_; // guards state transitions
+    uint8_t* ptr_ = nullptr;
+    const size_t nbytes_;
+    std::atomic<StorageState> state_{StorageState::Resident};
+    std::atomic<bool> spillable_{false};
+    std::atomic<int> pins_{0};
+    std::atomic<uint64_t> last_access_{0};
+    std::atomic<bool> referenced_{true};
+    std::atomic<uint64_t> version_{0};
+    std::atomic<int> untracked_writers_{0};
+    std::atomic<bool> read_only_{false};
+    int64_t swap_offset_ = -1;
+    const bool external_ = false;
+    Deleter deleter_;
+    std::unique_ptr<CompressedBuffer> compressed_;
+};
+
+// RAII pin keeping a storage resident (and alive) for its lifetime
+class StoragePin {
+public:
+    explicit StoragePin(std::shared_ptr<Storage> s) : storage_(std::move(s)) {
+        if (storage_) storage_->pin();
+    }
+    ~StoragePin() { if (storage_) storage_->unpin(); }
+
+    StoragePin(StoragePin&& other) noexcept = default;
+    StoragePin(const StoragePin&) = delete;
+    StoragePin& operator=(const StoragePin&) = delete;
+    StoragePin& operator=(StoragePin&&) = delete;
+
+private:
+    std::shared_ptr<Storage> storage_;
+};
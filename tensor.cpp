@@ -1,4 +1,5 @@
 #include "tensor.h"
+#include "copy_engine.h"
 #include <iostream>
 #include <algorithm>
 #include <numeric>
@@ -25,15 +26,42 @@ void Tensor::compute_strides() {
     }
 
     stride_.strides.resize(shape_.dims.size());
-    int32_t stride_val = 1;
+    // 64-bit, as the product past the outermost dim may exceed int32
+    int64_t stride_val = 1;
 
     // Compute in reverse order for row-major layout
     for (int i = static_cast<int>(shape_.dims.size()) - 1; i >= 0; --i) {
-        stride_.strides[i] = stride_val;
+        stride_.strides[i] = static_cast<int32_t>(stride_val);
         stride_val *= shape_.dims[i];
     }
 }
 
+// ========================================
+// Helper: Validate shape
+// ========================================
+void Tensor::validate_shape() const {
+    if (shape_.dims.empty()) {
+        throw std::invalid_argument("Tensor shape cannot be empty.");
+    }
+    for (auto dim : shape_.dims) {
+        if (dim <= 0) {
+            throw std::invalid_argument("Tensor dimensions must be positive.");
+        }
+    }
+}
+
+// ========================================
+// Helper: Contiguity check
+// ========================================
+bool Tensor::is_contiguous() const {
+    int64_t expected = 1;
+    for (int i = static_cast<int>(shape_.dims.size()) - 1; i >= 0; --i) {
+        if (shape_.dims[i] != 1 && stride_.strides[i] != expected) return false;
+        expected *= shape_.dims[i];
+    }
+    return true;
+}
+
 // ========================================
 // Helper: Allocate memory based on device
 // ========================================
@@ -45,21 +73,15 @@ void Tensor::allocate_memory() {
     }
 
     if (device_.type == DeviceType::CPU) {
-        // CPU allocation using new + smart pointer
-        data_ = std::shared_ptr<uint8_t>(
-            new uint8_t[total_bytes],
-            std::default_delete<uint8_t[]>()
-        );
+        // CPU allocation through the tracking allocator
+        storage_ = std::make_shared<Storage>(total_bytes);
     }
     else if (device_.type == DeviceType::CUDA) {
         // Future GPU support
         // Example (pseudo-code):
         // void* gpu_ptr = nullptr;
         // cudaMalloc(&gpu_ptr, total_bytes);
-        // data_ = std::shared_ptr<uint8_t>(
-        //     static_cast<uint8_t*>(gpu_ptr),
-        //     [](uint8_t* ptr) { cudaFree(ptr); }
-        // );
+        // storage_ = <Storage wrapping gpu_ptr, released with cudaFree>;
         throw std::runtime_error("CUDA device allocation not implemented yet.");
     }
     else {
@@ -80,14 +102,7 @@ Tensor::Tensor(const Shape& shape, Dtype dtype, const Device& device, bool requi
       is_owner_(false) 
 {
     // Validate shape
-    if (shape_.dims.empty()) {
-        throw std::invalid_argument("Tensor shape cannot be empty.");
-    }
-    for (auto dim : shape_.dims) {
-        if (dim <= 0) {
-            throw std::invalid_argument("Tensor dimensions must be positive.");
-        }
-    }
+    validate_shape();
 
     // Compute strides
     compute_strides();
@@ -96,3 +111,94 @@ Tensor::Tensor(const Shape& shape, Dtype dtype, const Device& device, bool requi
     allocate_memory();
 }
 
+
+// ========================================
+// Factory: wrap external memory
+// ========================================
+Tensor Tensor::from_blob(void* data, const Shape& shape, const Stride& strides,
+                         Dtype dtype, Storage::Deleter deleter, const Device& device) {
+    if (device.type != DeviceType::CPU) {
+        throw std::runtime_error("from_blob supports CPU memory only.");
+    }
+
+    Tensor t;
+    t.shape_ = shape;
+    t.dtype_ = dtype;
+    t.device_ = device;
+    t.validate_shape();
+
+    if (strides.strides.empty()) {
+        t.compute_strides();
+    } else if (strides.strides.size() != shape.dims.size()) {
+        throw std::invalid_argument("from_blob strides must match the shape's rank.");
+    } else {
+        t.stride_ = strides;
+    }
+
+    // Bytes spanned by the view: offset of the last element plus one
+    int64_t last = 0;
+    for (size_t i = 0; i < t.shape_.dims.size(); ++i) {
+        if (t.stride_.strides[i] < 0) {
+            throw std::invalid_argument("from_blob does not support negative strides.");
+        }
+        last += static_cast<int64_t>(t.shape_.dims[i] - 1) * t.stride_.strides[i];
+    }
+    const size_t extent = static_cast<size_t>(last + 1) * dtype_size(dtype);
+
+    t.is_owner_ = static_cast<bool>(deleter);
+    t.storage_ = std::make_shared<Storage>(data, extent, std::move(deleter));
+    return t;
+}
+
+// ========================================
+// Deep copy
+// ========================================
+Tensor Tensor::clone() const {
+    if (!storage_) return Tensor();
+
+    const StoragePin keep = pin(); // allocating `out` may spill this storage
+    Tensor out(shape_, dtype_, device_, requires_grad_);
+    const uint8_t* src = data<uint8_t>();
+    uint8_t* dst = out.data<uint8_t>();
+    if (is_contiguous()) {
+        tensor_copy(dst, src, nbytes());
+        return out;
+    }
+
+    // Strided view: walk the elements in row-major order
+    const size_t elem = dtype_size(dtype_);
+    const size_t rank = shape_.dims.size();
+    std::vector<int32_t> index(rank, 0);
+    for (size_t i = 0, n = numel(); i < n; ++i) {
+        int64_t offset = 0;
+        for (size_t d = 0; d < rank; ++d) offset += static_cast<int64_t>(index[d]) * stride_.strides[d];
+        std::memcpy(dst + i * elem, src + offset * static_cast<int64_t>(elem), elem);
+        for (size_t d = rank; d-- > 0;) {
+            if (++index[d] < shape_.dims[d]) break;
+            index[d] = 0;
+        }
+    }
+    return out;
+}
+
+// ========================================
+// Memory management
+// ========================================
+void Tensor::set_spillable(bool spillable) {
+    if (!storage_) {
+        throw std::runtime_error("Cannot change spill policy of an empty tensor.");
+    }
+    storage_->set_spillable(spillable);
+}
+
+bool Tensor::is_resident() const {
+    return !storage_ || storage_->is_resident();
+}
+
+size_t Tensor::compress() {
+    return storage_ ? storage_->compress(dtype_size(dtype_)) : 0;
+}
+
+bool Tensor::is_compressed() const {
+    return storage_ && storage_->state() == StorageState::Compressed;
+}
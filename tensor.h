@@ -7,13 +7,15 @@
 #include <cstring>
 #include <ostream>
 
+#include "storage.h"
+
 // =============================
 // Data Type Definitions
 // =============================
 
 // Data types supported by the tensor
 enum class Dtype {
-    Int16, Int32, Int64,
+    UInt8, Int16, Int32, Int64,
     Bfloat16, Float16,
     Float32, Float64
 };
@@ -21,6 +23,7 @@ enum class Dtype {
 // Compute element size for a given Dtype
 inline size_t dtype_size(Dtype dtype) {
     switch (dtype) {
+        case Dtype::UInt8:    return 1;
         case Dtype::Int16:    return 2;
         case Dtype::Int32:    return 4;
         case Dtype::Int64:    return 8;
@@ -83,12 +86,23 @@ public:
     // Default constructor
     Tensor() = default;
 
+    // Wraps existing memory without copying. `strides` are in elements
+    // (empty = row-major contiguous). Without a deleter the tensor borrows
+    // `data`, which must outlive it and every copy; with a deleter the
+    // tensor owns it and calls the deleter when the last copy is gone.
+    static Tensor from_blob(void* data, const Shape& shape, const Stride& strides,
+                            Dtype dtype, Storage::Deleter deleter = nullptr,
+                            const Device& device = Device());
+
     // Copy constructor (shares underlying data)
     Tensor(const Tensor& other) = default;
 
     // Move constructor
     Tensor(Tensor&& other) noexcept = default;
 
+    // Deep copy into freshly allocated, contiguous storage
+    Tensor clone() const;
+
     // Assignment operators
     Tensor& operator=(const Tensor& other) = default;
     Tensor& operator=(Tensor&& other) noexcept = default;
@@ -109,23 +123,63 @@ public:
     // Total memory size in bytes
     size_t nbytes() const { return numel() * dtype_size(dtype_); }
 
-    // Raw data access
+    // True for row-major layouts without gaps (always true for allocated tensors)
+    bool is_contiguous() const;
+
+    // Largest power of two (up to 4096) the data pointer is aligned to,
+    // so kernels can pick aligned fast paths for wrapped memory
+    size_t data_alignment() const { return storage_ ? storage_->alignment() : 0; }
+
+    // Raw data access (pages spilled storage back in). Mutable access bumps
+    // the storage version used by incremental checkpoints, and throws
+    // std::logic_error if the storage is read-only. The version moves when
+    // the pointer is taken, not when it is written through: after a
+    // checkpoint, call data() again before further writes, or the next
+    // incremental checkpoint may skip them.
     template <typename T>
     T* data() {
-        return reinterpret_cast<T*>(data_.get());
+        return storage_ ? reinterpret_cast<T*>(storage_->mutable_data()) : nullptr;
     }
 
     template <typename T>
     const T* data() const {
-        return reinterpret_cast<const T*>(data_.get());
+        return storage_ ? reinterpret_cast<const T*>(storage_->data()) : nullptr;
     }
 
+    // =========================
+    // Memory Management
+    // =========================
+
+    // Underlying storage (shared between copies of this tensor)
+    const std::shared_ptr<Storage>& storage() const { return storage_; }
+
+    // Allows the storage to be spilled to disk when the allocator's memory
+    // limit is exceeded (see TensorAllocator)
+    void set_spillable(bool spillable);
+
+    // False while the storage is spilled
+    bool is_resident() const;
+
+    // Compresses the storage in memory until next access (marks it cold).
+    // Returns the bytes saved.
+    size_t compress();
+
+    // True while the storage is held compressed
+    bool is_compressed() const;
+
+    // True once the storage is frozen (see Storage::set_read_only)
+    bool is_read_only() const { return storage_ && storage_->read_only(); }
+
+    // Keeps the storage resident while the returned pin is alive
+    StoragePin pin() const { return StoragePin(storage_); }
+
 private:
     // =========================
     // Helper Methods
     // =========================
     void compute_strides(); // Computes strides from shape
     void allocate_memory(); // Allocates memory based on device
+    void validate_shape() const; // Throws for empty or non-positive shapes
 
 private:
     // =========================
@@ -138,6 +192,6 @@ private:
     bool requires_grad_ = false;
     bool is_owner_ = false; // Tracks if tensor owns its memory
 
-    std::shared_ptr<uint8_t> data_; // Smart pointer for data
+    std::shared_ptr<Storage> storage_; // Shared backing memory
 };
 
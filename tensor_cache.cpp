@@ -0,0 +1,136 @@
+#include "tensor_cache.h"
+#include <iterator>
+
+// ========================================
+// Construction
+// ========================================
+TensorCache::TensorCache(size_t budget_bytes, size_t num_shards)
+    : budget_bytes_(budget_bytes)
+{
+    if (num_shards == 0) {
+        throw std::invalid_argument("TensorCache needs at least one shard.");
+    }
+    shards_.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+TensorCache::Shard& TensorCache::shard_for(const std::string& key) {
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+// ========================================
+// Lookup / insertion
+// ========================================
+std::shared_ptr<const Tensor> TensorCache::get(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    it->second->used = ++tick_;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    shard.oldest.store(shard.lru.back().used);
+    ++hits_;
+    return it->second->value;
+}
+
+std::shared_ptr<const Tensor> TensorCache::put(const std::string& key, Tensor value) {
+    const size_t bytes = value.nbytes();
+    if (value.storage()) value.storage()->set_read_only();
+    auto shared = std::make_shared<const Tensor>(std::move(value));
+    if (bytes > budget_bytes_) return shared;
+
+    {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) remove_locked(shard, it->second);
+        shard.lru.push_front(Entry{key, shared, bytes, ++tick_});
+        shard.index[key] = shard.lru.begin();
+        shard.bytes += bytes;
+        shard.oldest.store(shard.lru.back().used);
+        bytes_ += bytes;
+        ++insertions_;
+    }
+    evict_to_budget();
+    return shared;
+}
+
+std::shared_ptr<const Tensor> TensorCache::get_or_compute(
+    const std::string& key, const std::function<Tensor()>& compute) {
+    if (auto hit = get(key)) return hit;
+    return put(key, compute());
+}
+
+// ========================================
+// Eviction
+// ========================================
+void TensorCache::remove_locked(Shard& shard, std::list<Entry>::iterator it) {
+    shard.bytes -= it->bytes;
+    bytes_ -= it->bytes;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+    shard.oldest.store(shard.lru.empty() ? UINT64_MAX : shard.lru.back().used);
+}
+
+void TensorCache::evict_to_budget() {
+    while (bytes_.load() > budget_bytes_) {
+        Shard* victim = nullptr;
+        uint64_t oldest = UINT64_MAX;
+        for (auto& shard : shards_) {
+            const uint64_t tail = shard->oldest.load();
+            if (tail < oldest) {
+                oldest = tail;
+                victim = shard.get();
+            }
+        }
+        if (!victim) return;
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        // Another thread may have touched or evicted the tail meanwhile;
+        // the next round looks again
+        if (victim->lru.empty() || victim->lru.back().used != oldest) continue;
+        remove_locked(*victim, std::prev(victim->lru.end()));
+        ++evictions_;
+    }
+}
+
+// ========================================
+// Removal / statistics
+// ========================================
+bool TensorCache::erase(const std::string& key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return false;
+    remove_locked(shard, it->second);
+    return true;
+}
+
+void TensorCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        bytes_ -= shard->bytes;
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+        shard->oldest.store(UINT64_MAX);
+    }
+}
+
+TensorCache::Stats TensorCache::stats() const {
+    Stats s;
+    s.hits = hits_.load();
+    s.misses = misses_.load();
+    s.insertions = insertions_.load();
+    s.evictions = evictions_.load();
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        s.entries += shard->index.size();
+        s.bytes += shard->bytes;
+    }
+    return s;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "tensor.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// =============================
+// Tensor Cache
+// =============================
+
+// Thread-safe, memory-budgeted LRU cache of computed tensors.
+// Keys are hashed onto independent shards, each with its own lock and LRU
+// list, while the byte budget is global: any tensor up to the whole budget
+// can be cached, and eviction takes the oldest tail across all shards.
+// Entry sizes are taken from nbytes(). Cached tensors are handed out as
+// shared handles to frozen storage (see Storage::set_read_only), so an
+// evicted entry stays valid for callers still holding it.
+class TensorCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t insertions = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit TensorCache(size_t budget_bytes, size_t num_shards = 16);
+
+    TensorCache(const TensorCache&) = delete;
+    TensorCache& operator=(const TensorCache&) = delete;
+
+    // Returns the cached tensor, or nullptr on a miss
+    std::shared_ptr<const Tensor> get(const std::string& key);
+
+    // Inserts or replaces an entry and freezes its storage. Tensors larger
+    // than the whole budget are returned to the caller but not cached.
+    std::shared_ptr<const Tensor> put(const std::string& key, Tensor value);
+
+    // Returns the cached tensor or computes, caches and returns it.
+    // Concurrent misses on the same key may compute more than once.
+    std::shared_ptr<const Tensor> get_or_compute(const std::string& key,
+                                                 const std::function<Tensor()>& compute);
+
+    bool erase(const std::string& key);
+    void clear();
+
+    size_t budget_bytes() const { return budget_bytes_; }
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const Tensor> value;
+        size_t bytes;
+        uint64_t used; // tick of the last get or put
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // most recently used at the front
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        std::atomic<uint64_t> oldest{UINT64_MAX}; // tick of the LRU tail
+    };
+
+    Shard& shard_for(const std::string& key);
+
+    // Unlinks an entry and updates the byte counts (caller holds lock)
+    void remove_locked(Shard& shard, std::list<Entry>::iterator it);
+
+    // Evicts the oldest tail among all shards until the cache fits its
+    // budget. Takes one shard lock at a time; the caller holds none.
+    void evict_to_budget();
+
+    const size_t budget_bytes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<size_t> bytes_{0};
+    std::atomic<uint64_t> tick_{0};
+
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
+    std::atomic<size_t> insertions_{0};
+    std::atomic<size_t> evictions_{0};
+};
@@ -0,0 +1,178 @@
+#include "tensor_hash.h"
+#include "parallel.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+// Bytes per independently hashed chunk of a large tensor
+constexpr size_t kHashChunk = size_t(1) << 20;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ========================================
+// CRC32C implementations
+// ========================================
+uint32_t crc32c_table_entry(uint32_t i) {
+    for (int k = 0; k < 8; ++k) i = (i >> 1) ^ (0x82F63B78u & (0u - (i & 1u)));
+    return i;
+}
+
+uint32_t crc32c_scalar(const uint8_t* p, size_t n, uint32_t crc) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) t[i] = crc32c_table_entry(i);
+        return t;
+    }();
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFFu] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(const uint8_t* p, size_t n, uint32_t crc) {
+    uint64_t c = crc;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) c = _mm_crc32_u64(c, read64(p + i));
+    uint32_t c32 = static_cast<uint32_t>(c);
+    for (; i < n; ++i) c32 = _mm_crc32_u8(c32, p[i]);
+    return c32;
+}
+#endif
+
+} // namespace
+
+// ========================================
+// XXH64
+// ========================================
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // Four independent lanes keep the multipliers busy in parallel
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+
+    h += static_cast<uint64_t>(size);
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+    return avalanche(h);
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (cpu_features().sse42) return ~crc32c_sse42(p, size, crc);
+#endif
+    return ~crc32c_scalar(p, size, crc);
+}
+
+// ========================================
+// Tensor hashing
+// ========================================
+uint64_t hash_tensor(const Tensor& t) {
+    if (!t.is_contiguous()) {
+        throw std::invalid_argument("hash_tensor expects a contiguous tensor.");
+    }
+    // Metadata first, so equal bytes with different shapes do not collide
+    std::vector<int64_t> meta;
+    meta.reserve(t.shape().size() + 1);
+    meta.push_back(static_cast<int64_t>(t.dtype()));
+    for (auto d : t.shape()) meta.push_back(d);
+    const uint64_t seed = hash_bytes(meta.data(), meta.size() * sizeof(int64_t));
+
+    const StoragePin keep = t.pin();
+    const uint8_t* bytes = t.data<uint8_t>();
+    const size_t total = bytes ? t.nbytes() : 0;
+    if (total <= kHashChunk) return hash_bytes(bytes, total, seed);
+
+    const int64_t chunks = static_cast<int64_t>((total + kHashChunk - 1) / kHashChunk);
+    std::vector<uint64_t> digests(static_cast<size_t>(chunks));
+    parallel_for(0, chunks, 1, [&](int64_t b, int64_t e) {
+        for (int64_t i = b; i < e; ++i) {
+            const size_t off = static_cast<size_t>(i) * kHashChunk;
+            digests[i] = hash_bytes(bytes + off, std::min(kHashChunk, total - off), seed);
+        }
+    });
+    return hash_bytes(digests.data(), digests.size() * sizeof(uint64_t), seed);
+}
+
+bool tensor_content_equal(const Tensor& a, const Tensor& b) {
+    if (a.dtype() != b.dtype() || a.shape() != b.shape()) return false;
+    if (!a.is_contiguous() || !b.is_contiguous()) {
+        throw std::invalid_argument("tensor_content_equal expects contiguous tensors.");
+    }
+    const StoragePin keep_a = a.pin();
+    const StoragePin keep_b = b.pin();
+    const uint8_t* pa = a.data<uint8_t>();
+    const uint8_t* pb = b.data<uint8_t>();
+    if (pa == pb) return true;
+    if (!pa || !pb) return false;
+    return std::memcmp(pa, pb, a.nbytes()) == 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "tensor.h"
+
+// =============================
+// Content Hashing
+// =============================
+
+// 64-bit XXH64 hash of a byte range
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+
+// CRC32C (Castagnoli) checksum; uses the SSE4.2 crc32 instruction when available
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// Hash of a tensor's dtype, shape and contents. Large tensors are hashed in
+// fixed-size chunks on the thread pool, so the result does not depend on the
+// number of threads.
+uint64_t hash_tensor(const Tensor& t);
+
+// True when both tensors have the same dtype, shape and bytes
+bool tensor_content_equal(const Tensor& a, const Tensor& b);
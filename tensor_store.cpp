@@ -0,0 +1,84 @@
+#include "tensor_store.h"
+#include "tensor_hash.h"
+#include <algorithm>
+#include <vector>
+
+TensorStore& TensorStore::instance() {
+    static TensorStore store;
+    return store;
+}
+
+// ========================================
+// Intern: hash and compare outside the lock, insert on a checked miss
+// ========================================
+std::shared_ptr<const Tensor> TensorStore::intern(Tensor t) {
+    const uint64_t key = hash_tensor(t);
+    const auto shared = std::make_shared<const Tensor>(std::move(t));
+
+    // Collect unchecked live candidates under the lock, compare bytes
+    // without it, and repeat until a pass under the lock finds none left:
+    // another thread may have interned the same contents meanwhile
+    std::vector<std::shared_ptr<const Tensor>> checked;
+    std::vector<std::shared_ptr<const Tensor>> candidates;
+    for (;;) {
+        candidates.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto range = entries_.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                auto live = it->second.lock();
+                if (live && std::find(checked.begin(), checked.end(), live) == checked.end()) {
+                    candidates.push_back(std::move(live));
+                }
+            }
+            if (candidates.empty()) {
+                // Frozen only once it is the shared copy
+                if (shared->storage()) shared->storage()->set_read_only();
+                ++misses_;
+                entries_.emplace(key, shared);
+                if (++inserts_since_prune_ >= 64) prune_locked();
+                return shared;
+            }
+        }
+        for (const auto& c : candidates) {
+            if (tensor_content_equal(*c, *shared)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++hits_;
+                bytes_saved_ += shared->nbytes();
+                return c;
+            }
+            checked.push_back(c);
+        }
+    }
+}
+
+std::shared_ptr<const Tensor> TensorStore::find(uint64_t hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto range = entries_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (auto live = it->second.lock()) return live;
+    }
+    return nullptr;
+}
+
+void TensorStore::prune_locked() {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        it = it->second.expired() ? entries_.erase(it) : std::next(it);
+    }
+    inserts_since_prune_ = 0;
+}
+
+TensorStore::Stats TensorStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.hits = hits_;
+    s.misses = misses_;
+    s.bytes_saved = bytes_saved_;
+    for (const auto& e : entries_) {
+        if (auto live = e.second.lock()) {
+            ++s.entries;
+            s.resident_bytes += live->nbytes();
+        }
+    }
+    return s;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "tensor.h"
+#include <mutex>
+#include <unordered_map>
+
+// =============================
+// Content-Addressed Tensor Store
+// =============================
+
+// Process-wide deduplicating store. Tensors are keyed by hash_tensor() and
+// verified byte-for-byte before sharing, so identical weights loaded by
+// several models resolve to one resident copy. Entries are held weakly and
+// disappear once the last handle is released.
+class TensorStore {
+public:
+    struct Stats {
+        size_t hits = 0;          // intern() calls answered by a resident tensor
+        size_t misses = 0;        // intern() calls that added a new tensor
+        size_t bytes_saved = 0;   // bytes not kept resident thanks to hits
+        size_t entries = 0;       // live entries
+        size_t resident_bytes = 0;
+    };
+
+    static TensorStore& instance();
+
+    // Returns a shared read-only handle to a tensor with the same contents
+    // as `t`. If none is resident, `t` itself becomes the shared copy and its
+    // storage is frozen, so other aliases of `t` can no longer write to it.
+    std::shared_ptr<const Tensor> intern(Tensor t);
+
+    // Returns the resident tensor with the given content hash, if any
+    std::shared_ptr<const Tensor> find(uint64_t hash) const;
+
+    Stats stats() const;
+
+private:
+    TensorStore() = default;
+
+    // Drops expired entries (caller holds mutex_)
+    void prune_locked();
+
+    mutable std::mutex mutex_;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const Tensor>> entries_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t bytes_saved_ = 0;
+    size_t inserts_since_prune_ = 0;
+};
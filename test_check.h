@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// =============================
+// Test Check
+// =============================
+
+// Minimal assertion for the standalone test_*.cpp programs: reports the
+// failing expression and its location, then exits non-zero.
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond "\n"; \
+            std::exit(1);                                                            \
+        }                                                                            \
+    } while (0)
@@ -0,0 +1,109 @@
+#include "checkpoint.h"
+#include "tensor_hash.h"
+#include "test_check.h"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Rewriting a checkpoint name must not corrupt the new file or any other
+// checkpoint that refers into the old one, and stores the storage version
+// cannot see must still reach the next checkpoint.
+
+namespace {
+
+Tensor iota(size_t n) {
+    Tensor t(Shape({static_cast<int32_t>(n)}), Dtype::Float32);
+    for (size_t i = 0; i < n; ++i) t.data<float>()[i] = static_cast<float>(i);
+    return t;
+}
+
+bool loads_as(const std::string& path, const std::map<std::string, Tensor>& expected) {
+    const std::map<std::string, Tensor> loaded = load_checkpoint(path);
+    if (loaded.size() != expected.size()) return false;
+    for (const auto& kv : expected) {
+        auto it = loaded.find(kv.first);
+        if (it == loaded.end() || !tensor_content_equal(it->second, kv.second)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    char tmpl[] = "/tmp/test_checkpoint_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+    const size_t chunk = 1024;
+
+    // The same name over and over: unchanged and changed tensors both survive
+    {
+        CheckpointWriter writer(dir, chunk);
+        std::map<std::string, Tensor> state = {{"w", iota(4096)}, {"b", iota(100)}};
+        writer.write("latest", state);
+        CHECK(loads_as(dir + "/latest.ckpt", state));
+
+        state["w"].data<float>()[0] = -1.0f; // one chunk changes, "b" not at all
+        const CheckpointStats s = writer.write("latest", state);
+        CHECK(s.chunks_referenced == 0);
+        CHECK(loads_as(dir + "/latest.ckpt", state));
+
+        writer.write("latest", state);
+        CHECK(loads_as(dir + "/latest.ckpt", state));
+    }
+
+    // A name that a later checkpoint refers to cannot be replaced
+    {
+        CheckpointWriter writer(dir, chunk);
+        std::map<std::string, Tensor> state = {{"w", iota(4096)}};
+        writer.write("base", state);
+        state["w"].data<float>()[0] = 7.0f;
+        const CheckpointStats s = writer.write("next", state);
+        CHECK(s.chunks_referenced == 15); // all but the changed chunk
+
+        bool threw = false;
+        try {
+            writer.write("base", state);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(loads_as(dir + "/next.ckpt", state));
+
+        // Once the referring file is gone the name is free again
+        std::remove((dir + "/next.ckpt").c_str());
+        writer.write("base", state);
+        CHECK(loads_as(dir + "/base.ckpt", state));
+    }
+
+    // Stores into a from_blob buffer, and through a writable alias while it
+    // is registered, leave the version alone but are saved all the same
+    {
+        CheckpointWriter writer(dir, chunk);
+        std::vector<float> blob(2048, 1.0f);
+        std::map<std::string, Tensor> state = {
+            {"blob", Tensor::from_blob(blob.data(), Shape({2048}), {}, Dtype::Float32)},
+            {"w", iota(2048)}};
+        float* w = state["w"].data<float>();
+        Storage& storage = *state["w"].storage();
+        writer.write("first", state);
+
+        blob[100] = 5.0f;
+        storage.add_untracked_writer();
+        w[3] = 9.0f;
+        CheckpointStats s = writer.write("second", state);
+        CHECK(s.tensors_unchanged == 0);
+        CHECK(s.chunks_written == 2);
+        CHECK(loads_as(dir + "/second.ckpt", state));
+
+        w[5] = 11.0f;
+        storage.remove_untracked_writer();
+        s = writer.write("third", state);
+        CHECK(s.chunks_written == 1);
+        CHECK(loads_as(dir + "/third.ckpt", state));
+    }
+
+    for (const char* f : {"latest.ckpt", "base.ckpt", "first.ckpt", "second.ckpt", "third.ckpt"}) std::remove((dir + "/" + f).c_str());
+    std::remove(dir.c_str());
+    return 0;
+}
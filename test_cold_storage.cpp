@@ -0,0 +1,126 @@
+#include "allocator.h"
+#include "cold_storage.h"
+#include "compression.h"
+#include "test_check.h"
+#include <cstring>
+#include <random>
+#include <thread>
+
+// A compressed storage must come back byte for byte on the next data(), and
+// a scan must demote idle tracked storages while leaving pinned and recently
+// used ones resident.
+
+namespace {
+
+// Float32 values with few distinct exponents, which compress well
+Tensor compressible(int32_t n, float base) {
+    Tensor t(Shape({n}), Dtype::Float32);
+    for (int32_t i = 0; i < n; ++i) t.data<float>()[i] = base + static_cast<float>(i % 97);
+    return t;
+}
+
+std::vector<uint8_t> bytes_of(const Tensor& t) {
+    const uint8_t* p = t.data<uint8_t>();
+    return std::vector<uint8_t>(p, p + t.nbytes());
+}
+
+bool has_bytes(const Tensor& t, const std::vector<uint8_t>& expected) {
+    return t.nbytes() == expected.size() && std::memcmp(t.data<uint8_t>(), expected.data(), expected.size()) == 0;
+}
+
+} // namespace
+
+int main() {
+    TensorAllocator& alloc = TensorAllocator::instance();
+    std::mt19937 rng(19);
+
+    // Raw buffers: compressible and random data, odd sizes, every element size
+    for (size_t element_size : {1, 2, 4, 8}) {
+        for (size_t size : {size_t(0), size_t(1), size_t(4095), size_t(200000)}) {
+            std::vector<uint8_t> data(size);
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = i < size / 2 ? static_cast<uint8_t>(i % 7) : static_cast<uint8_t>(rng());
+            }
+            const CompressedBuffer packed = compress_bytes(data.data(), size, element_size);
+            CHECK(packed.raw_size == size && packed.element_size == element_size);
+            std::vector<uint8_t> restored(size + 1, 0xAB);
+            decompress_bytes(packed, restored.data());
+            CHECK(size == 0 || std::memcmp(restored.data(), data.data(), size) == 0);
+            CHECK(restored[size] == 0xAB);
+        }
+    }
+
+    // Compressing a storage frees its bytes; the next data() restores them
+    {
+        const Tensor t = compressible(1 << 16, 1000.0f);
+        const std::vector<uint8_t> expected = bytes_of(t);
+        const size_t compressions = alloc.stats().compress_count;
+        const size_t saved = t.storage()->compress(sizeof(float));
+        CHECK(saved > 0);
+        CHECK(t.storage()->state() == StorageState::Compressed);
+        CHECK(alloc.stats().compress_count == compressions + 1);
+        CHECK(has_bytes(t, expected));
+        CHECK(t.storage()->is_resident());
+
+        // Random bytes do not shrink and stay resident
+        Tensor noise(Shape({4096}), Dtype::UInt8);
+        for (size_t i = 0; i < noise.numel(); ++i) noise.data<uint8_t>()[i] = static_cast<uint8_t>(rng());
+        CHECK(noise.storage()->compress(1) == 0);
+        CHECK(noise.storage()->is_resident());
+
+        // Pinned and external storages are never compressed
+        {
+            const StoragePin pin = t.pin();
+            CHECK(t.storage()->compress(sizeof(float)) == 0);
+        }
+        std::vector<float> blob(4096, 1.0f);
+        const Tensor wrapped = Tensor::from_blob(blob.data(), Shape({4096}), {}, Dtype::Float32);
+        CHECK(wrapped.storage()->compress(sizeof(float)) == 0);
+    }
+
+    // Scans demote what has gone idle since the previous scan
+    {
+        ColdTensorManager& manager = ColdTensorManager::instance();
+        ColdPolicy policy;
+        policy.idle_after = std::chrono::milliseconds(200);
+        manager.set_policy(policy);
+
+        Tensor idle = compressible(1 << 15, 1.0f);
+        Tensor busy = compressible(1 << 15, 2.0f);
+        Tensor pinned = compressible(1 << 15, 3.0f);
+        const std::vector<uint8_t> idle_bytes = bytes_of(idle);
+        for (const Tensor* t : {&idle, &busy, &pinned}) manager.track(*t);
+        const StoragePin pin = pinned.pin();
+
+        CHECK(manager.scan() == 0); // everything was just used
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        busy.data<float>()[0] += 1.0f;
+        CHECK(manager.scan() > 0);
+        CHECK(idle.storage()->state() == StorageState::Compressed);
+        CHECK(busy.storage()->is_resident());
+        CHECK(pinned.storage()->is_resident());
+
+        // Transparent on the next read, after which the storage counts as used
+        CHECK(has_bytes(idle, idle_bytes));
+        CHECK(manager.scan() == 0);
+
+        // A custom policy replaces the idle test; the background scanner
+        // applies it
+        policy.should_demote = [&busy](const Storage& s, std::chrono::milliseconds) {
+            return &s == busy.storage().get();
+        };
+        policy.scan_interval = std::chrono::milliseconds(5);
+        manager.set_policy(policy);
+        manager.start();
+        for (int i = 0; i < 400 && busy.storage()->is_resident(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        manager.stop();
+        CHECK(busy.storage()->state() == StorageState::Compressed);
+        CHECK(idle.storage()->is_resident() && pinned.storage()->is_resident());
+        CHECK(busy.data<float>()[0] == 3.0f);
+
+        for (const Tensor* t : {&idle, &busy, &pinned}) manager.untrack(*t);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "embedding.h"
+#include "test_util.h"
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+// Repacking moves rows in and out of the hot region; lookups must return
+// the weights' rows before, after and while it happens.
+
+namespace {
+
+// Skewed ids: a tenth of them from the first `hot` rows
+std::vector<int64_t> skewed_ids(size_t n, int64_t rows, int64_t hot, std::mt19937& rng) {
+    std::uniform_int_distribution<int64_t> any(0, rows - 1);
+    std::uniform_int_distribution<int64_t> popular(0, hot - 1);
+    std::vector<int64_t> ids(n);
+    for (size_t i = 0; i < n; ++i) ids[i] = i % 10 == 0 ? any(rng) : popular(rng);
+    return ids;
+}
+
+bool rows_match(const Tensor& weights, const std::vector<int64_t>& ids, const float* got) {
+    const size_t dim = static_cast<size_t>(weights.shape()[1]);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const float* want = weights.data<float>() + static_cast<size_t>(ids[i]) * dim;
+        if (std::memcmp(want, got + i * dim, dim * sizeof(float)) != 0) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(17);
+    const int32_t rows = 1000, dim = 24;
+    const Tensor weights = random_tensor({rows, dim}, rng);
+    const Tensor original = weights.clone();
+
+    // Manual repacks, with the hot set shifting between them
+    {
+        HotEmbeddingTable::Options options;
+        options.hot_rows = 16;
+        HotEmbeddingTable table(weights, options);
+        CHECK(table.num_rows() == static_cast<size_t>(rows) && table.dim() == static_cast<size_t>(dim));
+
+        const std::vector<int64_t> ids = skewed_ids(4096, rows, 8, rng);
+        CHECK(rows_match(weights, ids, table.gather(ids).data<float>()));
+        CHECK(table.hot_slot(0) == -1);
+
+        table.repack();
+        CHECK(table.repack_count() == 1);
+        for (int64_t id = 0; id < 8; ++id) CHECK(table.hot_slot(id) >= 0);
+        CHECK(rows_match(weights, ids, table.gather(ids).data<float>()));
+
+        std::vector<int64_t> shifted = skewed_ids(8192, rows, 8, rng);
+        for (int64_t& id : shifted) id = rows - 1 - id;
+        table.gather(shifted);
+        table.repack();
+        CHECK(table.hot_slot(rows - 1) >= 0);
+        std::vector<float> out(ids.size() * dim);
+        table.gather_into(ids, out.data());
+        CHECK(rows_match(weights, ids, out.data()));
+        CHECK(rows_match(weights, shifted, table.gather(shifted).data<float>()));
+
+        bool threw = false;
+        try {
+            table.gather({0, rows});
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // Readers racing explicit and automatic repacks
+    {
+        HotEmbeddingTable::Options options;
+        options.hot_rows = 32;
+        options.repack_interval = 2048;
+        HotEmbeddingTable table(weights, options);
+        std::atomic<bool> done{false};
+        std::atomic<bool> ok{true};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t] {
+                std::mt19937 local(static_cast<uint32_t>(100 + t));
+                for (int i = 0; i < 200; ++i) {
+                    // Each reader's popular rows drift as it goes
+                    std::vector<int64_t> ids = skewed_ids(512, rows, 16, local);
+                    for (int64_t& id : ids) id = (id + i * 7 + t * 300) % rows;
+                    if (!rows_match(weights, ids, table.gather(ids).data<float>())) ok.store(false);
+                }
+            });
+        }
+        std::thread repacker([&] {
+            while (!done.load()) {
+                table.repack();
+                std::this_thread::yield();
+            }
+        });
+        for (auto& r : readers) r.join();
+        done.store(true);
+        repacker.join();
+        CHECK(ok.load());
+        CHECK(table.repack_count() > 1);
+    }
+
+    // The weights are shared, never written
+    CHECK(std::memcmp(weights.data<float>(), original.data<float>(), weights.nbytes()) == 0);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "pooling.h"
+#include "tensor_hash.h"
+#include "test_check.h"
+#include "thread_budget.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Scratch blocks are not inherited by a forked child, so the child's arena
+// must start empty instead of handing out pointers into unmapped memory.
+
+int main() {
+    Tensor x(Shape({1, 4, 48, 48}), Dtype::Float32);
+    for (size_t i = 0; i < x.numel(); ++i) x.data<float>()[i] = static_cast<float>((i * 7919) % 251);
+    Tensor x_last(Shape({1, 48, 48, 4}), Dtype::Float32);
+    for (size_t i = 0; i < x_last.numel(); ++i) x_last.data<float>()[i] = x.data<float>()[i];
+
+    // A wide window takes the separable path, which uses scratch rows, and
+    // channels-last argmax tracking uses scratch lanes
+    Pool2dParams params;
+    params.kernel_h = params.kernel_w = 7;
+    params.stride_h = params.stride_w = 1;
+    Tensor expected, expected_last, indices;
+    {
+        const ParallelismGuard inline_only(1); // scratch on this thread
+        expected = max_pool2d(x, params);
+        expected_last = max_pool2d(x_last, params, MemoryFormat::ChannelsLast, &indices);
+    }
+
+    const pid_t pid = ::fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        // The pool's workers are not inherited either; run on this thread
+        const ParallelismGuard inline_only(1);
+        const Tensor y = max_pool2d(x, params);
+        const Tensor y_last = max_pool2d(x_last, params, MemoryFormat::ChannelsLast, &indices);
+        ::_exit(tensor_content_equal(y, expected) && tensor_content_equal(y_last, expected_last) ? 0 : 1);
+    }
+    int status = 0;
+    CHECK(::waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    return 0;
+}
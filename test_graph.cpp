@@ -0,0 +1,81 @@
+#include "graph.h"
+#include "graph_passes.h"
+#include "test_util.h"
+#include <cstdio>
+#include <cstdlib>
+
+// optimize_graph must not change what a graph computes, and a graph saved
+// after optimizing must load back (copied or mapped) to the same results.
+
+namespace {
+
+// Conv + BatchNorm, a constant subexpression, a duplicated branch, layout
+// no-ops, a pool and Linear + Scale: something for every pass
+Graph model(std::mt19937& rng) {
+    Graph g;
+    const ValueId x = g.input("x", Shape({2, 3, 8, 8}));
+    ValueId h = g.conv2d(x, g.constant("conv.w", random_tensor({4, 3, 3, 3}, rng)),
+                         g.constant("conv.b", random_tensor({4}, rng)), 1, 1);
+    h = g.relu(random_batch_norm(g, h, "bn1", 4, rng));
+
+    // Same op on the same input twice
+    h = g.add(g.relu(h), g.relu(h));
+
+    Pool2dParams pool;
+    pool.kernel_h = pool.kernel_w = 2;
+    h = g.max_pool2d(h, pool);
+
+    // Identity transpose and a reshape to the same shape
+    h = g.transpose(h, {0, 1, 2, 3});
+    h = g.reshape(h, {2, 4, 4, 4});
+    h = g.reshape(g.reshape(h, {2, -1}), {2, 64});
+
+    // Weight computed from constants only
+    const ValueId w = g.add(g.constant("fc.w0", random_tensor({10, 64}, rng)),
+                            g.constant("fc.w1", random_tensor({10, 64}, rng)));
+    h = g.linear(h, w, g.constant("fc.b", random_tensor({10}, rng)));
+    h = g.scale(h, g.constant("fc.scale", random_tensor({10}, rng)),
+                g.constant("fc.shift", random_tensor({10}, rng)));
+    g.output("y", h);
+    return g;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(7);
+    const Graph original = model(rng);
+    const std::map<std::string, Tensor> inputs{{"x", random_tensor({2, 3, 8, 8}, rng)}};
+    const std::vector<Tensor> expected = run_graph(original, inputs);
+
+    Graph optimized = original;
+    const OptimizeStats stats = optimize_graph(optimized);
+    CHECK(stats.constants_folded > 0);
+    CHECK(stats.duplicates_removed > 0);
+    CHECK(stats.norms_folded > 0);
+    CHECK(stats.layout_ops_removed > 0);
+    CHECK(optimized.size() < original.size());
+    optimized.validate();
+    check_close(expected, run_graph(optimized, inputs));
+
+    char tmpl[] = "/tmp/test_graph_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+    const std::string path = dir + "/model.graph";
+    save_graph(optimized, path);
+    for (WeightLoading mode : {WeightLoading::Copy, WeightLoading::Map}) {
+        const Graph loaded = load_graph(path, mode);
+        CHECK(loaded.size() == optimized.size());
+        CHECK(loaded.outputs() == optimized.outputs());
+        for (size_t i = 0; i < loaded.size(); ++i) {
+            const Node& a = loaded.nodes()[i];
+            const Node& b = optimized.nodes()[i];
+            CHECK(a.op == b.op && a.inputs == b.inputs && a.attrs == b.attrs && a.name == b.name);
+        }
+        check_close(expected, run_graph(loaded, inputs));
+    }
+
+    std::remove((path + ".weights").c_str());
+    std::remove(path.c_str());
+    std::remove(dir.c_str());
+    return 0;
+}
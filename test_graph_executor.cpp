@@ -0,0 +1,95 @@
+#include "graph_executor.h"
+#include "test_util.h"
+#include <stdexcept>
+
+// GraphExecutor must return what run_graph returns, on every run, however
+// the ops of a branching graph end up spread over its lanes.
+
+namespace {
+
+// Four towers over a shared stem, joined pairwise; the stem and one tower
+// are outputs too, so values are read both by ops and by the caller. In a
+// broken graph the last tower scales by a constant swapped for an Int32
+// one, which passes validation and shape checks and only fails once its
+// op runs.
+Graph towers(std::mt19937& rng, bool broken = false) {
+    Graph g;
+    const ValueId x = g.input("x");
+    const ValueId stem = g.relu(g.linear(x, g.constant("stem.w", random_tensor({32, 16}, rng)),
+                                         g.constant("stem.b", random_tensor({32}, rng))));
+    std::vector<ValueId> heads;
+    for (int t = 0; t < 4; ++t) {
+        const std::string name = "tower" + std::to_string(t);
+        ValueId h = stem;
+        for (int l = 0; l < 3; ++l) {
+            const std::string layer = name + "." + std::to_string(l);
+            h = g.relu(g.linear(h, g.constant(layer + ".w", random_tensor({32, 32}, rng)),
+                                g.constant(layer + ".b", random_tensor({32}, rng))));
+            if (broken && t == 3 && l == 1) {
+                const ValueId scale = g.constant(layer + ".scale", random_tensor({32}, rng));
+                g.node(scale).value = Tensor(Shape({32}), Dtype::Int32);
+                h = g.scale(h, scale);
+            }
+        }
+        heads.push_back(h);
+    }
+    const ValueId joined = g.add(g.mul(heads[0], heads[1]), g.add(heads[2], heads[3]));
+    g.output("y", g.linear(joined, g.constant("head.w", random_tensor({8, 32}, rng))));
+    g.output("stem", stem);
+    g.output("tower2", heads[2]);
+    return g;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(3);
+    const Graph graph = towers(rng);
+    const Graph broken = towers(rng, true);
+
+    // One lane per tower, and one whose ops each get a single thread
+    GraphExecutor::Options wide;
+    wide.lanes = 4;
+    GraphExecutor::Options serial_ops;
+    serial_ops.lanes = 2;
+    serial_ops.cost_per_thread = int64_t(1) << 40;
+
+    for (const GraphExecutor::Options& options : {GraphExecutor::Options(), wide, serial_ops}) {
+        GraphExecutor executor(graph, options);
+        CHECK(executor.lanes() >= 1);
+
+        // Repeated runs, with the batch size changing in between
+        for (int32_t batch : {4, 4, 1, 64, 4}) {
+            const std::map<std::string, Tensor> inputs{{"x", random_tensor({batch, 16}, rng)}};
+            check_close(run_graph(graph, inputs), executor.run(inputs));
+        }
+
+        // A failed run leaves the executor usable
+        bool threw = false;
+        try {
+            executor.run({});
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        CHECK(threw);
+        const std::map<std::string, Tensor> inputs{{"x", random_tensor({4, 16}, rng)}};
+        check_close(run_graph(graph, inputs), executor.run(inputs));
+
+        CHECK(executor.stats().runs == 6);
+
+        // An op failing while the other towers are running fails the run
+        // once they are done, every time
+        GraphExecutor failing(broken, options);
+        for (int r = 0; r < 3; ++r) {
+            threw = false;
+            try {
+                failing.run(inputs);
+            } catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            CHECK(threw);
+        }
+        CHECK(failing.stats().runs == 3);
+    }
+    return 0;
+}
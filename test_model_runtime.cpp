@@ -0,0 +1,121 @@
+#include "model_runtime.h"
+#include "test_util.h"
+#include <cstdio>
+#include <cstdlib>
+
+// ModelRuntime must return what run_graph returns, request after request,
+// for every kernel it binds: Linear, folded BatchNorm and Scale, Conv2d,
+// both pools, views and ops computed in place.
+
+namespace {
+
+Graph mlp(std::mt19937& rng) {
+    Graph g;
+    ValueId h = g.input("x");
+    for (int l = 0; l < 3; ++l) {
+        const std::string name = "layer" + std::to_string(l);
+        const int32_t in = l == 0 ? 24 : 32;
+        h = g.linear(h, g.constant(name + ".w", random_tensor({32, in}, rng)),
+                     g.constant(name + ".b", random_tensor({32}, rng)));
+        h = g.relu(random_batch_norm(g, h, name, 32, rng));
+    }
+    const ValueId skip = h;
+    h = g.scale(g.linear(h, g.constant("head.w", random_tensor({32, 32}, rng))),
+                g.constant("head.scale", random_tensor({32}, rng)));
+    g.output("y", g.add(h, skip));
+    g.output("features", skip);
+    return g;
+}
+
+// Pools with padding, ceil mode and count_include_pad off, so the window
+// tables planned at load differ from plain kernel-sized tiles
+Graph cnn(std::mt19937& rng) {
+    Graph g;
+    ValueId h = g.input("x");
+    h = g.conv2d(h, g.constant("conv0.w", random_tensor({8, 3, 3, 3}, rng)),
+                 g.constant("conv0.b", random_tensor({8}, rng)), 1, 1);
+    h = g.relu(random_batch_norm(g, h, "bn0", 8, rng));
+    Pool2dParams max_pool;
+    max_pool.kernel_h = max_pool.kernel_w = 3;
+    max_pool.stride_h = max_pool.stride_w = 2;
+    max_pool.pad_h = max_pool.pad_w = 1;
+    max_pool.ceil_mode = true;
+    h = g.max_pool2d(h, max_pool);
+
+    h = g.conv2d(h, g.constant("conv1.w", random_tensor({8, 8, 3, 3}, rng)), kNoValue, 2, 1);
+    Pool2dParams avg_pool;
+    avg_pool.kernel_h = 2;
+    avg_pool.kernel_w = 3;
+    avg_pool.stride_h = 1;
+    avg_pool.stride_w = 2;
+    avg_pool.pad_w = 1;
+    avg_pool.count_include_pad = false;
+    const ValueId pooled = g.avg_pool2d(h, avg_pool);
+    g.output("pooled", pooled);
+
+    h = g.reshape(pooled, {-1, 8 * 2 * 2});
+    g.output("y", g.linear(h, g.constant("fc.w", random_tensor({5, 32}, rng)),
+                           g.constant("fc.b", random_tensor({5}, rng))));
+    return g;
+}
+
+// Several requests through both run() overloads
+void check_runtime(ModelRuntime& runtime, const Graph& graph, const std::vector<int32_t>& dims,
+                   std::mt19937& rng) {
+    for (int request = 0; request < 3; ++request) {
+        const std::map<std::string, Tensor> inputs{{"x", random_tensor(dims, rng)}};
+        check_close(run_graph(graph, inputs), runtime.run(inputs));
+    }
+    for (int request = 0; request < 2; ++request) {
+        const Tensor x = random_tensor(dims, rng);
+        Tensor& slot = runtime.input("x");
+        for (size_t i = 0; i < x.numel(); ++i) slot.data<float>()[i] = x.data<float>()[i];
+        check_close(run_graph(graph, {{"x", x}}), runtime.run());
+    }
+    CHECK(runtime.stats().runs == 5);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(5);
+    char tmpl[] = "/tmp/test_model_runtime_XXXXXX";
+    const std::string dir = mkdtemp(tmpl);
+    const std::string path = dir + "/model.graph";
+
+    const Graph head = mlp(rng);
+    const Graph image = cnn(rng);
+    const std::vector<std::pair<const Graph*, std::vector<int32_t>>> models{
+        {&head, {4, 24}}, {&head, {1, 24}}, {&image, {2, 3, 11, 13}}};
+    for (const auto& model : models) {
+        const Graph& graph = *model.first;
+        const Shape shape(model.second);
+
+        ModelRuntime in_memory(graph, {{"x", shape}});
+        CHECK(in_memory.stats().views + in_memory.stats().in_place > 0);
+        check_runtime(in_memory, graph, model.second, rng);
+
+        save_graph(graph, path);
+        ModelRuntime mapped(path, {{"x", shape}});
+        check_runtime(mapped, graph, model.second, rng);
+    }
+
+    // Saving over a model that is being served leaves its weights alone;
+    // the next load sees the new ones
+    {
+        const Graph next = mlp(rng);
+        const std::map<std::string, Tensor> inputs{{"x", random_tensor({4, 24}, rng)}};
+        save_graph(head, path);
+        ModelRuntime serving(path, {{"x", Shape({4, 24})}});
+        check_close(run_graph(head, inputs), serving.run(inputs));
+        save_graph(next, path);
+        check_close(run_graph(head, inputs), serving.run(inputs));
+        ModelRuntime reloaded(path, {{"x", Shape({4, 24})}});
+        check_close(run_graph(next, inputs), reloaded.run(inputs));
+    }
+
+    std::remove((path + ".weights").c_str());
+    std::remove(path.c_str());
+    std::remove(dir.c_str());
+    return 0;
+}
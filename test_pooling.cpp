@@ -0,0 +1,342 @@
+#include "index_dispatch.h"
+#include "pooling.h"
+#include "test_util.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <sys/mman.h>
+
+// Every pooling kernel must match a naive reference in both memory formats,
+// with max indices that drive the backward pass, at either index width.
+
+namespace {
+
+// Input range [start, end) of one output position along one axis, and the
+// divisor that axis contributes to average pooling
+struct Span {
+    int64_t start, end, count;
+};
+
+std::vector<Span> regular_spans(int64_t in, int32_t k, int32_t s, int32_t p, bool ceil_mode,
+                                bool count_include_pad) {
+    if (s == 0) s = k;
+    const double steps = static_cast<double>(in + 2 * p - k) / s;
+    int64_t out = static_cast<int64_t>(ceil_mode ? std::ceil(steps) : std::floor(steps)) + 1;
+    if (ceil_mode && (out - 1) * s >= in + p) --out;
+    std::vector<Span> spans;
+    for (int64_t o = 0; o < out; ++o) {
+        const int64_t start = o * s - p;
+        const int64_t end = std::min<int64_t>(start + k, in + p);
+        const int64_t clipped_start = std::max<int64_t>(start, 0);
+        const int64_t clipped_end = std::min(end, in);
+        spans.push_back({clipped_start, clipped_end,
+                         count_include_pad ? end - start : clipped_end - clipped_start});
+    }
+    return spans;
+}
+
+std::vector<Span> adaptive_spans(int64_t in, int64_t out) {
+    std::vector<Span> spans;
+    for (int64_t o = 0; o < out; ++o) {
+        const int64_t start = o * in / out;
+        const int64_t end = ((o + 1) * in + out - 1) / out;
+        spans.push_back({start, end, end - start});
+    }
+    return spans;
+}
+
+// Naive pooling of a channels-first tensor (1D inputs have H == 1); max
+// positions are h * W + w, the first maximum in row-major order
+Tensor reference_pool(const Tensor& x, const std::vector<Span>& rows, const std::vector<Span>& cols,
+                      bool max, Tensor* indices) {
+    const auto& d = x.shape();
+    const bool is_2d = d.size() == 4;
+    const int64_t planes = int64_t(d[0]) * d[1];
+    const int64_t W = d.back();
+    const int64_t H = is_2d ? d[2] : 1;
+    const int64_t OH = static_cast<int64_t>(rows.size()), OW = static_cast<int64_t>(cols.size());
+    std::vector<int32_t> out_dims{d[0], d[1]};
+    if (is_2d) out_dims.push_back(static_cast<int32_t>(OH));
+    out_dims.push_back(static_cast<int32_t>(OW));
+
+    Tensor out(Shape(out_dims), Dtype::Float32);
+    if (indices) *indices = Tensor(Shape(out_dims), Dtype::Int64);
+    const float* in = x.data<float>();
+    for (int64_t pl = 0; pl < planes; ++pl) {
+        for (int64_t oh = 0; oh < OH; ++oh) {
+            for (int64_t ow = 0; ow < OW; ++ow) {
+                float best = -std::numeric_limits<float>::infinity();
+                int64_t best_pos = -1;
+                double sum = 0.0;
+                for (int64_t h = rows[oh].start; h < rows[oh].end; ++h) {
+                    for (int64_t w = cols[ow].start; w < cols[ow].end; ++w) {
+                        const float v = in[pl * H * W + h * W + w];
+                        if (v > best) {
+                            best = v;
+                            best_pos = h * W + w;
+                        }
+                        sum += v;
+                    }
+                }
+                const int64_t o = pl * OH * OW + oh * OW + ow;
+                out.data<float>()[o] = max ? best
+                                           : static_cast<float>(sum / static_cast<double>(
+                                                 rows[oh].count * cols[ow].count));
+                if (indices) indices->data<int64_t>()[o] = best_pos;
+            }
+        }
+    }
+    return out;
+}
+
+// (N, C, S...) <-> (N, S..., C), for either element type
+template <typename T>
+Tensor permute_channels(const Tensor& x, bool to_last) {
+    const auto& d = x.shape();
+    std::vector<int32_t> dims = d;
+    if (to_last) {
+        std::rotate(dims.begin() + 1, dims.begin() + 2, dims.end());
+    } else {
+        std::rotate(dims.begin() + 1, dims.end() - 1, dims.end());
+    }
+    Tensor out(Shape(dims), x.dtype());
+    const int64_t N = d[0];
+    const int64_t C = to_last ? d[1] : d.back();
+    const int64_t S = static_cast<int64_t>(x.numel()) / (N * C);
+    const T* src = x.data<T>();
+    T* dst = out.data<T>();
+    for (int64_t n = 0; n < N; ++n) {
+        for (int64_t c = 0; c < C; ++c) {
+            for (int64_t s = 0; s < S; ++s) {
+                const int64_t first = (n * C + c) * S + s;
+                const int64_t last = (n * S + s) * C + c;
+                if (to_last) {
+                    dst[last] = src[first];
+                } else {
+                    dst[first] = src[last];
+                }
+            }
+        }
+    }
+    return out;
+}
+
+void check_indices(const Tensor& a, const Tensor& b) {
+    CHECK(a.shape() == b.shape());
+    for (size_t i = 0; i < a.numel(); ++i) CHECK(a.data<int64_t>()[i] == b.data<int64_t>()[i]);
+}
+
+// Runs a kernel on a channels-first input in `format` and returns its
+// output (and indices) in channels-first order
+template <typename Kernel>
+Tensor in_format(const Tensor& x, MemoryFormat format, Tensor* indices, Kernel kernel) {
+    if (format == MemoryFormat::ChannelsFirst) return kernel(x, format, indices);
+    Tensor idx;
+    const Tensor out = kernel(permute_channels<float>(x, true), format, indices ? &idx : nullptr);
+    if (indices) *indices = permute_channels<int64_t>(idx, false);
+    return permute_channels<float>(out, false);
+}
+
+// Backward of a max pooling in `format`, compared with a naive scatter
+void check_backward(const Tensor& x, const Tensor& indices, MemoryFormat format, std::mt19937& rng) {
+    const Tensor grad = random_tensor(indices.shape(), rng);
+    const int64_t planes = int64_t(x.shape()[0]) * x.shape()[1];
+    const int64_t in_plane = static_cast<int64_t>(x.numel()) / planes;
+    const int64_t out_plane = static_cast<int64_t>(grad.numel()) / planes;
+    Tensor expected(Shape(x.shape()), Dtype::Float32);
+    std::fill(expected.data<float>(), expected.data<float>() + expected.numel(), 0.0f);
+    for (int64_t pl = 0; pl < planes; ++pl) {
+        for (int64_t o = 0; o < out_plane; ++o) {
+            const int64_t k = pl * out_plane + o;
+            expected.data<float>()[pl * in_plane + indices.data<int64_t>()[k]] += grad.data<float>()[k];
+        }
+    }
+
+    Tensor got;
+    if (format == MemoryFormat::ChannelsFirst) {
+        got = max_pool2d_backward(grad, indices, Shape(x.shape()), format);
+    } else {
+        const Tensor cl_input = permute_channels<float>(x, true);
+        got = permute_channels<float>(max_pool2d_backward(permute_channels<float>(grad, true),
+                                                          permute_channels<int64_t>(indices, true),
+                                                          Shape(cl_input.shape()), format),
+                                      false);
+    }
+    check_close({expected}, {got});
+}
+
+bool backward_throws(const Tensor& x, const Tensor& indices, int64_t bad) {
+    Tensor corrupt = indices.clone();
+    corrupt.data<int64_t>()[corrupt.numel() / 2] = bad;
+    Tensor grad(Shape(indices.shape()), Dtype::Float32);
+    std::fill(grad.data<float>(), grad.data<float>() + grad.numel(), 1.0f);
+    try {
+        max_pool2d_backward(grad, corrupt, Shape(x.shape()));
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(11);
+    const MemoryFormat formats[] = {MemoryFormat::ChannelsFirst, MemoryFormat::ChannelsLast};
+
+    // 2D: a few channels, and enough of them for the vector channels-last
+    // path with a tail
+    Pool2dParams padded;
+    padded.kernel_h = padded.kernel_w = 3;
+    padded.stride_h = padded.stride_w = 2;
+    padded.pad_h = padded.pad_w = 1;
+    padded.ceil_mode = true;
+    padded.count_include_pad = false;
+    Pool2dParams uneven;
+    uneven.kernel_h = 2;
+    uneven.kernel_w = 3;
+    uneven.stride_h = 1;
+    uneven.stride_w = 2;
+    uneven.pad_w = 1;
+    Pool2dParams tiled;
+    tiled.kernel_h = tiled.kernel_w = 3;
+
+    for (const std::vector<int32_t>& dims : {std::vector<int32_t>{2, 3, 11, 13}, {1, 19, 9, 10}}) {
+        const Tensor x = random_tensor(dims, rng);
+        for (MemoryFormat format : formats) {
+            for (const Pool2dParams& params : {padded, uneven, tiled}) {
+                const std::vector<Span> rows = regular_spans(dims[2], params.kernel_h, params.stride_h,
+                                                             params.pad_h, params.ceil_mode,
+                                                             params.count_include_pad);
+                const std::vector<Span> cols = regular_spans(dims[3], params.kernel_w, params.stride_w,
+                                                             params.pad_w, params.ceil_mode,
+                                                             params.count_include_pad);
+                Tensor expected_idx, idx;
+                const Tensor expected_max = reference_pool(x, rows, cols, true, &expected_idx);
+                const Tensor max = in_format(x, format, &idx, [&](const Tensor& in, MemoryFormat f, Tensor* i) {
+                    return max_pool2d(in, params, f, i);
+                });
+                check_close({expected_max}, {max});
+                check_indices(expected_idx, idx);
+                check_backward(x, idx, format, rng);
+
+                const Tensor avg = in_format(x, format, nullptr, [&](const Tensor& in, MemoryFormat f, Tensor*) {
+                    return avg_pool2d(in, params, f);
+                });
+                check_close({reference_pool(x, rows, cols, false, nullptr)}, {avg});
+
+                // Planned and unplanned _into variants agree with the above
+                const Tensor cl_x = format == MemoryFormat::ChannelsFirst ? x : permute_channels<float>(x, true);
+                const Pool2dPlan plan = plan_pool2d(Shape(cl_x.shape()), params, format);
+                Tensor planned(Shape(plan.output_shape), Dtype::Float32);
+                Tensor unplanned(Shape(plan.output_shape), Dtype::Float32);
+                avg_pool2d_into(cl_x, plan, planned);
+                avg_pool2d_into(cl_x, params, unplanned, format);
+                check_close({avg_pool2d(cl_x, params, format)}, {planned});
+                check_close({planned}, {unplanned});
+                max_pool2d_into(cl_x, plan, planned);
+                check_close({max_pool2d(cl_x, params, format)}, {planned});
+            }
+
+            for (const std::pair<int32_t, int32_t>& out : {std::make_pair(4, 5), std::make_pair(1, 1),
+                                                           std::make_pair(dims[2], dims[3])}) {
+                const std::vector<Span> rows = adaptive_spans(dims[2], out.first);
+                const std::vector<Span> cols = adaptive_spans(dims[3], out.second);
+                Tensor expected_idx, idx;
+                const Tensor expected_max = reference_pool(x, rows, cols, true, &expected_idx);
+                const Tensor max = in_format(x, format, &idx, [&](const Tensor& in, MemoryFormat f, Tensor* i) {
+                    return adaptive_max_pool2d(in, out.first, out.second, f, i);
+                });
+                check_close({expected_max}, {max});
+                check_indices(expected_idx, idx);
+                check_backward(x, idx, format, rng);
+                const Tensor avg = in_format(x, format, nullptr, [&](const Tensor& in, MemoryFormat f, Tensor*) {
+                    return adaptive_avg_pool2d(in, out.first, out.second, f);
+                });
+                check_close({reference_pool(x, rows, cols, false, nullptr)}, {avg});
+            }
+        }
+    }
+
+    // 1D
+    {
+        const Tensor x = random_tensor({2, 19, 17}, rng);
+        Pool1dParams max_params;
+        max_params.kernel = 3;
+        max_params.stride = 2;
+        max_params.pad = 1;
+        max_params.ceil_mode = true;
+        Pool1dParams avg_params;
+        avg_params.kernel = 4;
+        avg_params.stride = 3;
+        avg_params.pad = 2;
+        avg_params.ceil_mode = true;
+        avg_params.count_include_pad = false;
+        const std::vector<Span> row = adaptive_spans(1, 1);
+        for (MemoryFormat format : formats) {
+            const std::vector<Span> max_cols =
+                regular_spans(17, max_params.kernel, max_params.stride, max_params.pad, true, true);
+            Tensor expected_idx, idx;
+            Tensor expected = reference_pool(x, row, max_cols, true, &expected_idx);
+            Tensor got = in_format(x, format, &idx, [&](const Tensor& in, MemoryFormat f, Tensor* i) {
+                return max_pool1d(in, max_params, f, i);
+            });
+            check_close({expected}, {got});
+            check_indices(expected_idx, idx);
+            check_backward(x, idx, format, rng);
+
+            const std::vector<Span> avg_cols =
+                regular_spans(17, avg_params.kernel, avg_params.stride, avg_params.pad, true, false);
+            got = in_format(x, format, nullptr, [&](const Tensor& in, MemoryFormat f, Tensor*) {
+                return avg_pool1d(in, avg_params, f);
+            });
+            check_close({reference_pool(x, row, avg_cols, false, nullptr)}, {got});
+
+            const std::vector<Span> adaptive_cols = adaptive_spans(17, 5);
+            expected = reference_pool(x, row, adaptive_cols, true, &expected_idx);
+            got = in_format(x, format, &idx, [&](const Tensor& in, MemoryFormat f, Tensor* i) {
+                return adaptive_max_pool1d(in, 5, f, i);
+            });
+            check_close({expected}, {got});
+            check_indices(expected_idx, idx);
+            got = in_format(x, format, nullptr, [&](const Tensor& in, MemoryFormat f, Tensor*) {
+                return adaptive_avg_pool1d(in, 5, f);
+            });
+            check_close({reference_pool(x, row, adaptive_cols, false, nullptr)}, {got});
+        }
+    }
+
+    // Indices outside the input plane are rejected, not scattered
+    {
+        const Tensor x = random_tensor({2, 3, 8, 8}, rng);
+        Tensor idx;
+        max_pool2d(x, tiled, MemoryFormat::ChannelsFirst, &idx);
+        CHECK(backward_throws(x, idx, 64));
+        CHECK(backward_throws(x, idx, -1));
+        CHECK(backward_throws(x, idx, int64_t(1) << 40));
+    }
+
+    // 64-bit indexing: more elements than an int32_t can address, mapped
+    // over the zero page so that only the page holding the maximum is
+    // backed by memory
+    {
+        const int32_t side = 32769;
+        const size_t plane = size_t(side) * side;
+        const size_t numel = 2 * plane;
+        CHECK(!fits_int32_index(static_cast<int64_t>(numel)));
+        void* mem = mmap(nullptr, numel * sizeof(float), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(mem != MAP_FAILED);
+        static_cast<float*>(mem)[numel - 3] = 2.0f;
+        {
+            const Tensor x = Tensor::from_blob(mem, Shape({2, 1, side, side}), {}, Dtype::Float32);
+            Tensor idx;
+            const Tensor y = adaptive_max_pool2d(x, 1, 1, MemoryFormat::ChannelsFirst, &idx);
+            CHECK(y.data<float>()[0] == 0.0f && y.data<float>()[1] == 2.0f);
+            CHECK(idx.data<int64_t>()[0] == 0);
+            CHECK(idx.data<int64_t>()[1] == static_cast<int64_t>(plane - 3));
+        }
+        munmap(mem, numel * sizeof(float));
+    }
+    return 0;
+}
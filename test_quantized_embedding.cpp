@@ -0,0 +1,165 @@
+#include "index_dispatch.h"
+#include "quantized_embedding.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <sys/mman.h>
+
+// Quantized tables must decode to within half a step of the weights they
+// were built from, and embedding_bag must pool exactly what a naive decode
+// of the fused rows gives, at 8 and 4 bits and either row addressing width.
+
+namespace {
+
+// Decodes one fused row by the documented layout
+std::vector<float> decode_row(const uint8_t* row, int bits, size_t dim) {
+    const size_t code_bytes = QuantizedEmbeddingTable::fused_row_bytes(dim, bits) - 2 * sizeof(float);
+    float scale, bias;
+    std::memcpy(&scale, row + code_bytes, sizeof(float));
+    std::memcpy(&bias, row + code_bytes + sizeof(float), sizeof(float));
+    std::vector<float> out(dim);
+    for (size_t d = 0; d < dim; ++d) {
+        const int code = bits == 8 ? row[d] : (d & 1) ? row[d / 2] >> 4 : row[d / 2] & 0x0F;
+        out[d] = scale * static_cast<float>(code) + bias;
+    }
+    return out;
+}
+
+Tensor reference_bag(const QuantizedEmbeddingTable& table, const std::vector<int64_t>& indices,
+                     const std::vector<int64_t>& offsets, BagMode mode,
+                     const std::vector<float>* weights) {
+    const size_t dim = table.dim();
+    Tensor out(Shape({static_cast<int32_t>(offsets.size()), static_cast<int32_t>(dim)}), Dtype::Float32);
+    const uint8_t* rows = table.fused_rows().data<uint8_t>();
+    for (size_t b = 0; b < offsets.size(); ++b) {
+        const int64_t begin = offsets[b];
+        const int64_t end = b + 1 < offsets.size() ? offsets[b + 1] : static_cast<int64_t>(indices.size());
+        std::vector<double> acc(dim, 0.0);
+        for (int64_t i = begin; i < end; ++i) {
+            const size_t r = static_cast<size_t>(indices[static_cast<size_t>(i)]);
+            const std::vector<float> row = decode_row(rows + r * table.row_bytes(), table.bits(), dim);
+            const float w = weights ? (*weights)[static_cast<size_t>(i)] : 1.0f;
+            for (size_t d = 0; d < dim; ++d) acc[d] += static_cast<double>(w) * row[d];
+        }
+        for (size_t d = 0; d < dim; ++d) {
+            if (mode == BagMode::Mean && end > begin) acc[d] /= static_cast<double>(end - begin);
+            out.data<float>()[b * dim + d] = static_cast<float>(acc[d]);
+        }
+    }
+    return out;
+}
+
+template <typename Exception>
+bool bag_throws(const QuantizedEmbeddingTable& table, const std::vector<int64_t>& indices,
+                const std::vector<int64_t>& offsets, const std::vector<float>* weights = nullptr) {
+    try {
+        table.embedding_bag(indices, offsets, BagMode::Sum, weights);
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(13);
+    const int32_t num_rows = 50;
+
+    // Odd and vector-width dims, so packed nibbles and SIMD tails are hit
+    for (int32_t dim : {37, 64}) {
+        const Tensor weights = random_tensor({num_rows, dim}, rng, -3.0f, 2.0f);
+        for (int bits : {8, 4}) {
+            const QuantizedEmbeddingTable table = QuantizedEmbeddingTable::quantize(weights, bits);
+            CHECK(table.bits() == bits && table.dim() == static_cast<size_t>(dim));
+            CHECK(table.num_rows() == static_cast<size_t>(num_rows));
+            CHECK(table.row_bytes() == static_cast<size_t>((dim * bits + 7) / 8) + 2 * sizeof(float));
+            CHECK(table.nbytes() == table.num_rows() * table.row_bytes());
+
+            // Each element within half a quantization step of its weight,
+            // and dequantize() equal to a decode of the fused rows
+            const Tensor decoded = table.dequantize();
+            const float levels = static_cast<float>((1 << bits) - 1);
+            for (int32_t r = 0; r < num_rows; ++r) {
+                const float* w = weights.data<float>() + r * dim;
+                const auto mm = std::minmax_element(w, w + dim);
+                const float half_step = 0.5f * (*mm.second - *mm.first) / levels;
+                const std::vector<float> row =
+                    decode_row(table.fused_rows().data<uint8_t>() + r * table.row_bytes(), bits, dim);
+                for (int32_t d = 0; d < dim; ++d) {
+                    const float got = decoded.data<float>()[r * dim + d];
+                    CHECK(std::fabs(got - w[d]) <= half_step * 1.001f + 1e-6f);
+                    CHECK(std::fabs(got - row[d]) <= 1e-5f * (1.0f + std::fabs(row[d])));
+                }
+            }
+
+            // Bags of varying size, an empty one, repeated rows
+            std::uniform_int_distribution<int64_t> pick(0, num_rows - 1);
+            std::vector<int64_t> indices(40);
+            for (auto& i : indices) i = pick(rng);
+            indices[5] = indices[6];
+            const std::vector<int64_t> offsets{0, 3, 3, 10, 11, 25};
+            std::vector<float> weights_per_sample(indices.size());
+            std::uniform_real_distribution<float> scale(-2.0f, 2.0f);
+            for (auto& w : weights_per_sample) w = scale(rng);
+
+            for (BagMode mode : {BagMode::Sum, BagMode::Mean}) {
+                const std::vector<float>* no_weights = nullptr;
+                for (const std::vector<float>* w : {no_weights, &std::as_const(weights_per_sample)}) {
+                    const Tensor got = table.embedding_bag(indices, offsets, mode, w);
+                    check_close({reference_bag(table, indices, offsets, mode, w)}, {got});
+                    for (int32_t d = 0; d < dim; ++d) CHECK(got.data<float>()[dim + d] == 0.0f);
+                }
+            }
+
+            // Rows wrapped from storage pool the same as the quantized table
+            const QuantizedEmbeddingTable wrapped(table.fused_rows().clone(), bits, static_cast<size_t>(dim));
+            check_close({table.embedding_bag(indices, offsets)}, {wrapped.embedding_bag(indices, offsets)});
+
+            CHECK(bag_throws<std::out_of_range>(table, {0, num_rows}, {0}));
+            CHECK(bag_throws<std::out_of_range>(table, {-1}, {0}));
+            CHECK(bag_throws<std::invalid_argument>(table, {0, 1}, {1, 0}));
+            CHECK(bag_throws<std::invalid_argument>(table, {0, 1}, {0, 3}));
+            CHECK(bag_throws<std::invalid_argument>(table, {0, 1}, {}));
+            const std::vector<float> one_weight{1.0f};
+            CHECK(bag_throws<std::invalid_argument>(table, {0, 1}, {0}, &one_weight));
+        }
+    }
+
+    // 64-bit row addressing: a table of more bytes than an int32_t can
+    // address, mapped over the zero page (all rows decode to zero) with
+    // only its last row written
+    {
+        const size_t dim = 64;
+        const size_t row_bytes = QuantizedEmbeddingTable::fused_row_bytes(dim, 8);
+        const size_t rows = (size_t(1) << 31) / row_bytes + 1;
+        const size_t nbytes = rows * row_bytes;
+        CHECK(!fits_int32_index(static_cast<int64_t>(nbytes)));
+        void* mem = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        CHECK(mem != MAP_FAILED);
+        uint8_t* last = static_cast<uint8_t*>(mem) + (rows - 1) * row_bytes;
+        const float scale = 0.5f, bias = -1.0f;
+        for (size_t d = 0; d < dim; ++d) last[d] = static_cast<uint8_t>(d);
+        std::memcpy(last + dim, &scale, sizeof(float));
+        std::memcpy(last + dim + sizeof(float), &bias, sizeof(float));
+        {
+            const QuantizedEmbeddingTable table(
+                Tensor::from_blob(mem, Shape({static_cast<int32_t>(rows), static_cast<int32_t>(row_bytes)}),
+                                  {}, Dtype::UInt8),
+                8, dim);
+            const int64_t last_row = static_cast<int64_t>(rows - 1);
+            const Tensor got = table.embedding_bag({last_row, 0, last_row}, {0, 1});
+            for (size_t d = 0; d < dim; ++d) {
+                const float value = scale * static_cast<float>(d) + bias;
+                CHECK(got.data<float>()[d] == value);
+                CHECK(got.data<float>()[dim + d] == value);
+            }
+        }
+        munmap(mem, nbytes);
+    }
+    return 0;
+}
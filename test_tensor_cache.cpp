@@ -0,0 +1,69 @@
+#include "tensor_cache.h"
+#include "test_check.h"
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// The byte budget is global across shards: an entry far larger than
+// budget / shards must still be cached, and the total never exceeds it.
+
+namespace {
+
+Tensor block(size_t bytes, float value) {
+    Tensor t(Shape({static_cast<int32_t>(bytes / sizeof(float))}), Dtype::Float32);
+    for (size_t i = 0; i < t.numel(); ++i) t.data<float>()[i] = value;
+    return t;
+}
+
+} // namespace
+
+int main() {
+    const size_t budget = 1 << 20, entry = 200 << 10; // five entries fit
+    TensorCache cache(budget, 16);
+
+    cache.put("big", block(entry, 1.0f));
+    CHECK(cache.get("big") != nullptr);
+
+    // Filling past the budget evicts the least recently used, whatever shard
+    for (int i = 0; i < 8; ++i) {
+        cache.put("k" + std::to_string(i), block(entry, static_cast<float>(i)));
+        CHECK(cache.get("big") != nullptr); // keep it the most recent
+    }
+    TensorCache::Stats s = cache.stats();
+    CHECK(s.bytes <= budget);
+    CHECK(s.entries == 5);
+    CHECK(s.evictions == 4);
+    CHECK(cache.get("k0") == nullptr);
+    CHECK(cache.get("k7") != nullptr);
+
+    // Larger than the whole budget: handed back, not cached
+    CHECK(cache.put("huge", block(budget + 4096, 2.0f)) != nullptr);
+    CHECK(cache.get("huge") == nullptr);
+
+    // Handles stay read-only even after copying the tensor out
+    Tensor copy = *cache.get("big");
+    bool threw = false;
+    try {
+        copy.data<float>()[0] = 0.0f;
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // Concurrent puts and gets keep the accounting consistent
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 200; ++i) {
+                const std::string key = "t" + std::to_string((t * 7 + i) % 23);
+                if (!cache.get(key)) cache.put(key, block(64 << 10, static_cast<float>(i)));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    s = cache.stats();
+    CHECK(s.bytes <= budget);
+    cache.clear();
+    CHECK(cache.stats().bytes == 0 && cache.stats().entries == 0);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "tensor_hash.h"
+#include "tensor_store.h"
+#include "test_check.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Interned tensors are shared between models, so no alias may write to them;
+// a tensor answered by another copy stays the caller's to write.
+
+namespace {
+
+Tensor iota(size_t n) {
+    Tensor t(Shape({static_cast<int32_t>(n)}), Dtype::Float32);
+    for (size_t i = 0; i < n; ++i) t.data<float>()[i] = static_cast<float>(i);
+    return t;
+}
+
+bool write_throws(Tensor t) {
+    try {
+        t.data<float>()[0] = -1.0f;
+    } catch (const std::logic_error&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    TensorStore& store = TensorStore::instance();
+    Tensor original = iota(64);
+    const std::shared_ptr<const Tensor> shared = store.intern(original);
+    CHECK(store.intern(iota(64)) == shared);
+
+    // Neither a copy of the handle's tensor nor the caller's alias can write
+    Tensor copy = *shared;
+    CHECK(copy.is_read_only());
+    CHECK(write_throws(copy));
+    CHECK(write_throws(original));
+    CHECK(shared->data<float>()[0] == 0.0f);
+
+    // Reading and cloning still work; a clone is writable again
+    Tensor clone = shared->clone();
+    CHECK(!clone.is_read_only());
+    clone.data<float>()[0] = 5.0f;
+    CHECK(!tensor_content_equal(clone, *shared));
+
+    // Racing interns of equal contents agree on one copy, and only that
+    // copy is frozen
+    for (int round = 0; round < 50; ++round) {
+        std::vector<Tensor> tensors;
+        for (int t = 0; t < 4; ++t) tensors.push_back(iota(static_cast<size_t>(1000 + round)));
+        std::vector<std::shared_ptr<const Tensor>> handles(tensors.size());
+        std::atomic<int> ready{0};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < tensors.size(); ++t) {
+            threads.emplace_back([&, t] {
+                ready.fetch_add(1);
+                while (ready.load() < static_cast<int>(tensors.size())) std::this_thread::yield();
+                handles[t] = store.intern(tensors[t]);
+            });
+        }
+        for (auto& th : threads) th.join();
+        for (size_t t = 0; t < tensors.size(); ++t) {
+            CHECK(handles[t] == handles[0]);
+            const bool is_shared = handles[0]->storage() == tensors[t].storage();
+            CHECK(tensors[t].is_read_only() == is_shared);
+        }
+    }
+    return 0;
+}
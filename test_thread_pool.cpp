@@ -0,0 +1,156 @@
+#include "parallel.h"
+#include "test_check.h"
+#include "thread_budget.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Every task of every run() executes exactly once, with concurrent callers
+// of mixed priority, errors reach the caller, helper caps and budget seats
+// hold, and dispatch onto the pool does not touch the heap.
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+// Runs `runs` jobs of `tasks` tasks on `pool` and checks each task ran once
+void check_runs(ThreadPool& pool, size_t runs, size_t tasks) {
+    std::vector<std::atomic<int>> hits(tasks);
+    for (size_t r = 0; r < runs; ++r) {
+        for (auto& h : hits) h.store(0, std::memory_order_relaxed);
+        pool.run(tasks, [&](size_t i) { hits[i].fetch_add(1, std::memory_order_relaxed); });
+        for (auto& h : hits) CHECK(h.load() == 1);
+    }
+}
+
+} // namespace
+
+void* operator new(size_t n) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main() {
+    set_thread_budget(4);
+    ThreadPool pool(4);
+
+    check_runs(pool, 200, 1);
+    check_runs(pool, 200, 3);
+    check_runs(pool, 200, 64);
+
+    // Concurrent callers at every priority share the workers
+    {
+        std::vector<std::thread> callers;
+        for (int t = 0; t < 6; ++t) {
+            callers.emplace_back([&pool, t] {
+                const PriorityScope scope(static_cast<TaskPriority>(t % 3));
+                check_runs(pool, 100, static_cast<size_t>(2 + t * 5));
+            });
+        }
+        for (auto& c : callers) c.join();
+        CHECK(pool.stats().queued == 0);
+    }
+
+    // The first error is rethrown once the job is done; the pool carries on
+    {
+        std::atomic<size_t> ran{0};
+        bool threw = false;
+        try {
+            pool.run(32, [&](size_t i) {
+                ran.fetch_add(1);
+                if (i == 5) throw std::runtime_error("task failed");
+            });
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(ran.load() == 32);
+        check_runs(pool, 10, 16);
+    }
+
+    // Capped helpers, and Low priority parallel_for cut into more chunks
+    // than it was granted threads, stay on the threads they may use
+    {
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        const auto record = [&] {
+            const std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        };
+        for (int r = 0; r < 20; ++r) {
+            threads.clear();
+            pool.run(16, [&](size_t) { record(); }, 1);
+            CHECK(threads.size() <= 2);
+        }
+
+        const PriorityScope low(TaskPriority::Low);
+        const ParallelismGuard two(2);
+        for (int r = 0; r < 20; ++r) {
+            threads.clear();
+            parallel_for(0, 64, 1, [&](int64_t, int64_t) { record(); });
+            CHECK(threads.size() <= 2);
+        }
+    }
+
+    // Seated threads count against the budget; a seated caller's
+    // parallel_for counts its seat as its own share
+    {
+        std::atomic<int> seated{0};
+        std::atomic<bool> done{false};
+        std::vector<std::thread> lanes;
+        for (int t = 0; t < 2; ++t) {
+            lanes.emplace_back([&] {
+                const BudgetSeat seat;
+                seated.fetch_add(1);
+                while (!done.load()) std::this_thread::yield();
+            });
+        }
+        while (seated.load() < 2) std::this_thread::yield();
+        size_t granted = acquire_threads(4);
+        CHECK(granted == 2);
+        release_threads(granted);
+        {
+            const BudgetSeat seat;
+            granted = acquire_threads(4);
+            CHECK(granted == 2);
+            release_threads(granted);
+        }
+        done.store(true);
+        for (auto& l : lanes) l.join();
+        granted = acquire_threads(4);
+        CHECK(granted == 4);
+        release_threads(granted);
+    }
+
+    // No heap use per run, through ThreadPool::run or parallel_for
+    {
+        std::vector<float> data(1 << 16, 1.0f);
+        const auto touch = [&data](int64_t b, int64_t e) {
+            for (int64_t i = b; i < e; ++i) data[static_cast<size_t>(i)] += 1.0f;
+        };
+        const std::function<void(size_t)> task = [&data](size_t i) { data[i] += 1.0f; };
+        const std::function<void(int64_t, int64_t)> chunk = touch;
+        pool.run(4, task);
+        parallel_for(0, static_cast<int64_t>(data.size()), 1024, chunk);
+        const size_t before = g_allocations.load();
+        for (int r = 0; r < 100; ++r) {
+            pool.run(4, task);
+            parallel_for(0, static_cast<int64_t>(data.size()), 1024, chunk);
+        }
+        CHECK(g_allocations.load() == before);
+        CHECK(default_thread_pool().size() >= 2);
+    }
+    return 0;
+}
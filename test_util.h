@@ -0,0 +1,45 @@
+#pragma once
+
+#include "graph.h"
+#include "test_check.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// =============================
+// Test Data
+// =============================
+
+// Float32 tensor of `dims` drawn uniformly from [lo, hi)
+inline Tensor random_tensor(std::vector<int32_t> dims, std::mt19937& rng,
+                            float lo = -1.0f, float hi = 1.0f) {
+    Tensor t{Shape(dims), Dtype::Float32};
+    std::uniform_real_distribution<float> dist(lo, hi);
+    float* p = t.data<float>();
+    for (size_t i = 0; i < t.numel(); ++i) p[i] = dist(rng);
+    return t;
+}
+
+// Inference BatchNorm over `channels` with random constant parameters named
+// after `name`; the variance stays well away from zero
+inline ValueId random_batch_norm(Graph& g, ValueId x, const std::string& name, int32_t channels,
+                                 std::mt19937& rng) {
+    return g.batch_norm(x, g.constant(name + ".gamma", random_tensor({channels}, rng)),
+                        g.constant(name + ".beta", random_tensor({channels}, rng)),
+                        g.constant(name + ".mean", random_tensor({channels}, rng)),
+                        g.constant(name + ".var", random_tensor({channels}, rng, 0.5f, 2.0f)));
+}
+
+// Same shapes, and every element within a relative 1e-4
+inline void check_close(const std::vector<Tensor>& a, const std::vector<Tensor>& b) {
+    CHECK(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        CHECK(a[i].shape() == b[i].shape());
+        const float* pa = a[i].data<float>();
+        const float* pb = b[i].data<float>();
+        for (size_t j = 0; j < a[i].numel(); ++j) {
+            CHECK(std::fabs(pa[j] - pb[j]) <= 1e-4f * (1.0f + std::fabs(pa[j])));
+        }
+    }
+}
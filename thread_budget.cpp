@@ -0,0 +1,217 @@
+#include "thread_budget.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <dlfcn.h>
+
+namespace {
+
+// ========================================
+// Helper: External runtime entry points
+// ========================================
+struct RuntimeSymbols {
+    int (*omp_get_max_threads)() = nullptr;
+    void (*omp_set_num_threads)(int) = nullptr;
+    int (*omp_in_parallel)() = nullptr;
+    void (*openblas_set_num_threads)(int) = nullptr;
+    void (*mkl_set_num_threads)(int) = nullptr;
+    int (*mkl_set_num_threads_local)(int) = nullptr;
+};
+
+template <typename F>
+void lookup(F*& fn, const char* name) {
+    fn = reinterpret_cast<F*>(::dlsym(RTLD_DEFAULT, name));
+}
+
+const RuntimeSymbols& symbols() {
+    static const RuntimeSymbols s = [] {
+        RuntimeSymbols r;
+        lookup(r.omp_get_max_threads, "omp_get_max_threads");
+        lookup(r.omp_set_num_threads, "omp_set_num_threads");
+        lookup(r.omp_in_parallel, "omp_in_parallel");
+        lookup(r.openblas_set_num_threads, "openblas_set_num_threads");
+        lookup(r.mkl_set_num_threads, "MKL_Set_Num_Threads");
+        lookup(r.mkl_set_num_threads_local, "MKL_Set_Num_Threads_Local");
+        return r;
+    }();
+    return s;
+}
+
+size_t env_threads(const char* name) {
+    const char* env = std::getenv(name);
+    if (!env) return 0;
+    const long n = std::strtol(env, nullptr, 10); // OMP_NUM_THREADS may be a list; take the first
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+size_t default_budget() {
+    if (size_t n = env_threads("TENSOR_NUM_THREADS")) return n;
+    if (size_t n = env_threads("OMP_NUM_THREADS")) return n;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ParallelBackend default_backend() {
+    const char* env = std::getenv("TENSOR_PARALLEL_BACKEND");
+#ifdef _OPENMP
+    if (env && std::strcmp(env, "openmp") == 0) return ParallelBackend::OpenMP;
+#else
+    (void)env;
+#endif
+    return ParallelBackend::Native;
+}
+
+struct BudgetState {
+    std::atomic<size_t> budget{default_budget()};
+    std::atomic<size_t> in_use{0};
+    std::atomic<ParallelBackend> backend{default_backend()};
+    std::atomic<bool> serialize_nested{true};
+    std::atomic<uint64_t> generation{0}; // bumped by set_thread_budget
+};
+
+BudgetState& state() {
+    static BudgetState s;
+    return s;
+}
+
+thread_local size_t tls_limit = 0;
+thread_local size_t tls_seats = 0;
+
+// omp_set_num_threads only sets the calling thread's nthreads ICV, so each
+// of our threads applies the budget itself the first time it runs a task
+// after a change
+void sync_openmp_budget(const RuntimeSymbols& s) {
+    thread_local uint64_t seen = 0;
+    const uint64_t generation = state().generation.load(std::memory_order_acquire);
+    if (generation == seen || !s.omp_set_num_threads) return;
+    seen = generation;
+    s.omp_set_num_threads(static_cast<int>(state().budget.load(std::memory_order_relaxed)));
+}
+
+} // namespace
+
+// ========================================
+// Detection / budget
+// ========================================
+const ExternalRuntimes& external_runtimes() {
+    static const ExternalRuntimes r = [] {
+        const RuntimeSymbols& s = symbols();
+        ExternalRuntimes out;
+        out.openmp = s.omp_get_max_threads != nullptr;
+        out.openblas = s.openblas_set_num_threads != nullptr;
+        out.mkl = s.mkl_set_num_threads != nullptr;
+        return out;
+    }();
+    return r;
+}
+
+size_t thread_budget() {
+    return state().budget.load(std::memory_order_relaxed);
+}
+
+void set_thread_budget(size_t threads) {
+    const size_t n = std::max<size_t>(threads, 1);
+    state().budget.store(n, std::memory_order_relaxed);
+    state().generation.fetch_add(1, std::memory_order_release);
+    const RuntimeSymbols& s = symbols();
+    sync_openmp_budget(s);
+    if (s.openblas_set_num_threads) s.openblas_set_num_threads(static_cast<int>(n));
+    if (s.mkl_set_num_threads) s.mkl_set_num_threads(static_cast<int>(n));
+}
+
+size_t acquire_threads(size_t wanted) {
+    // A seated caller already holds its own thread
+    const size_t seated = tls_seats > 0 ? 1 : 0;
+    BudgetState& st = state();
+    const size_t budget = st.budget.load(std::memory_order_relaxed);
+    size_t used = st.in_use.load(std::memory_order_relaxed);
+    for (;;) {
+        const size_t free = budget > used ? budget - used : 0;
+        const size_t extra = seated ? std::min(wanted > 0 ? wanted - 1 : 0, free)
+                                    : std::max<size_t>(1, std::min(wanted, free));
+        if (st.in_use.compare_exchange_weak(used, used + extra, std::memory_order_relaxed)) {
+            return extra + seated;
+        }
+    }
+}
+
+void release_threads(size_t granted) {
+    const size_t seated = tls_seats > 0 ? 1 : 0;
+    state().in_use.fetch_sub(granted - seated, std::memory_order_relaxed);
+}
+
+// ========================================
+// Backend selection
+// ========================================
+ParallelBackend parallel_backend() {
+    return state().backend.load(std::memory_order_relaxed);
+}
+
+void set_parallel_backend(ParallelBackend backend) {
+#ifndef _OPENMP
+    if (backend == ParallelBackend::OpenMP) {
+        throw std::runtime_error("The OpenMP backend requires building with OpenMP enabled.");
+    }
+#endif
+    state().backend.store(backend, std::memory_order_relaxed);
+}
+
+// ========================================
+// Scopes
+// ========================================
+ParallelismGuard::ParallelismGuard(size_t max_threads) : previous_(tls_limit) {
+    const size_t limit = std::max<size_t>(max_threads, 1);
+    tls_limit = previous_ == 0 ? limit : std::min(previous_, limit);
+}
+
+ParallelismGuard::~ParallelismGuard() {
+    tls_limit = previous_;
+}
+
+size_t parallelism_limit() {
+    return tls_limit;
+}
+
+BudgetSeat::BudgetSeat() {
+    if (tls_seats++ == 0) state().in_use.fetch_add(1, std::memory_order_relaxed);
+}
+
+BudgetSeat::~BudgetSeat() {
+    if (--tls_seats == 0) state().in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool in_external_parallel_region() {
+    const RuntimeSymbols& s = symbols();
+    return s.omp_in_parallel && s.omp_in_parallel() != 0;
+}
+
+void set_serialize_nested_runtimes(bool enable) {
+    state().serialize_nested.store(enable, std::memory_order_relaxed);
+}
+
+bool serialize_nested_runtimes() {
+    return state().serialize_nested.load(std::memory_order_relaxed);
+}
+
+NestedRuntimeScope::NestedRuntimeScope() {
+    const RuntimeSymbols& s = symbols();
+    sync_openmp_budget(s);
+    if (!serialize_nested_runtimes()) return;
+    if (s.omp_get_max_threads && s.omp_set_num_threads) {
+        omp_previous_ = s.omp_get_max_threads();
+        if (omp_previous_ != 1) s.omp_set_num_threads(1);
+    }
+    if (s.mkl_set_num_threads_local) mkl_previous_ = s.mkl_set_num_threads_local(1);
+    active_ = true;
+}
+
+NestedRuntimeScope::~NestedRuntimeScope() {
+    if (!active_) return;
+    const RuntimeSymbols& s = symbols();
+    if (s.omp_set_num_threads && omp_previous_ > 1) s.omp_set_num_threads(omp_previous_);
+    // 0 restores MKL's process-wide setting
+    if (s.mkl_set_num_threads_local) s.mkl_set_num_threads_local(mkl_previous_);
+}
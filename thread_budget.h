@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+
+// =============================
+// Thread Budget and Runtime Interop
+// =============================
+
+// Threading runtimes loaded into the process besides our own pool,
+// detected once by symbol lookup (none of them is a link dependency)
+struct ExternalRuntimes {
+    bool openmp = false;
+    bool openblas = false;
+    bool mkl = false;
+};
+
+const ExternalRuntimes& external_runtimes();
+
+// Process-wide number of threads compute may occupy at once. Defaults to
+// TENSOR_NUM_THREADS, else OMP_NUM_THREADS, else one per hardware thread.
+// Concurrent parallel_for calls share it rather than each using the whole
+// pool (High priority calls are exempt), and it is also handed to the
+// external runtimes.
+size_t thread_budget();
+
+// Changes the budget and forwards it to OpenMP, OpenBLAS and MKL when they
+// are loaded. OpenBLAS and MKL take it process-wide. OpenMP keeps the
+// thread count per thread: the calling thread gets it at once, and each
+// thread running parallel_for tasks picks it up at its next task. Other
+// threads keep their own OpenMP setting. The default pool is sized from
+// the budget when first used, so raising it later does not add workers.
+void set_thread_budget(size_t threads);
+
+// Where parallel_for runs its chunks. OpenMP is only available when the
+// library is compiled with OpenMP enabled; it lets a process that already
+// keeps an OpenMP team hot run our kernels on it instead of a second pool.
+// Defaults to TENSOR_PARALLEL_BACKEND (native or openmp).
+enum class ParallelBackend { Native, OpenMP };
+
+ParallelBackend parallel_backend();
+void set_parallel_backend(ParallelBackend backend); // throws if unavailable
+
+// Limits parallel_for on the calling thread to `max_threads` (1 = run
+// inline) for the lifetime of the guard. Guards nest; the tighter limit wins.
+class ParallelismGuard {
+public:
+    explicit ParallelismGuard(size_t max_threads);
+    ~ParallelismGuard();
+
+    ParallelismGuard(const ParallelismGuard&) = delete;
+    ParallelismGuard& operator=(const ParallelismGuard&) = delete;
+
+private:
+    size_t previous_;
+};
+
+// Current guard limit of the calling thread (0 = unlimited)
+size_t parallelism_limit();
+
+// Counts the calling thread against the budget for the lifetime of the
+// seat, for threads that run compute outside parallel_for (GraphExecutor
+// lanes run small ops inline). Like a parallel_for caller it is always
+// granted. parallel_for on a seated thread counts the seat as the caller's
+// share instead of taking another. Seats nest.
+class BudgetSeat {
+public:
+    BudgetSeat();
+    ~BudgetSeat();
+
+    BudgetSeat(const BudgetSeat&) = delete;
+    BudgetSeat& operator=(const BudgetSeat&) = delete;
+};
+
+// True while the calling thread is inside an OpenMP parallel region
+bool in_external_parallel_region();
+
+// When enabled (the default), OpenMP and MKL calls made from inside our
+// parallel tasks run single-threaded, so a BLAS call inside a kernel does
+// not fan out again on every pool thread.
+void set_serialize_nested_runtimes(bool enable);
+bool serialize_nested_runtimes();
+
+// ---- Used by parallel_for ----
+
+// Reserves up to `wanted` threads of the budget (the caller counts as one
+// and is always granted). Returns the number granted.
+size_t acquire_threads(size_t wanted);
+void release_threads(size_t granted);
+
+// Restricts OpenMP and MKL to one thread on the calling thread for the
+// scope, restoring the previous settings afterwards
+class NestedRuntimeScope {
+public:
+    NestedRuntimeScope();
+    ~NestedRuntimeScope();
+
+    NestedRuntimeScope(const NestedRuntimeScope&) = delete;
+    NestedRuntimeScope& operator=(const NestedRuntimeScope&) = delete;
+
+private:
+    int omp_previous_ = 0;
+    int mkl_previous_ = 0;
+    bool active_ = false;
+};
@@ -0,0 +1,394 @@
+#include "thread_pool.h"
+#include "thread_budget.h"
+#include "topology.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+thread_local bool tls_in_parallel = false;
+thread_local TaskPriority tls_priority = TaskPriority::Normal;
+
+size_t priority_index(TaskPriority p) { return static_cast<size_t>(p); }
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - since).count());
+}
+
+// ========================================
+// Helper: Spin-then-park primitives
+// ========================================
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, expected,
+              nullptr, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>* addr, int count) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, count,
+              nullptr, nullptr, 0);
+}
+
+// Spins until ready() or `spin_ns` have passed (forever when spin_ns < 0).
+// Returns ready().
+template <typename Ready>
+bool spin_until(Ready&& ready, int64_t spin_ns) {
+    if (ready()) return true;
+    if (spin_ns == 0) return false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(spin_ns);
+    for (uint32_t i = 1;; ++i) {
+        if (ready()) return true;
+        cpu_relax();
+        if (spin_ns > 0 && i % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+            return ready();
+        }
+    }
+}
+
+void pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+}
+
+} // namespace
+
+// ========================================
+// ThreadPool: jobs
+// ========================================
+// Completion is a countdown the caller spins on and, past the spin window,
+// parks on.
+struct ThreadPool::Job {
+    const std::function<void(size_t)>* fn = nullptr;
+    uint32_t num_tasks = 0;
+    TaskPriority priority = TaskPriority::Normal;
+    std::atomic<uint32_t> next{0};
+    std::atomic<uint32_t> remaining{0};
+    std::atomic<bool> caller_parked{false};
+    std::atomic<uint64_t>* busy_ns = nullptr;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    // Queue bookkeeping, under the pool's mutex_
+    Job* next_queued = nullptr;
+    size_t helpers_waiting = 0;
+    // Helpers that took the job and may still be inside drain()
+    std::atomic<uint32_t> helpers_active{0};
+
+    // Claims and runs tasks until none are left. Helpers pass the pool's
+    // queue counters and stop early when higher priority work is waiting;
+    // the caller passes null and always finishes the job.
+    void drain(const std::atomic<size_t>* queued) {
+        const bool was_parallel = tls_in_parallel;
+        const TaskPriority was_priority = tls_priority;
+        tls_in_parallel = true;
+        tls_priority = priority;
+        const auto start = std::chrono::steady_clock::now();
+        bool ran = false;
+        uint32_t i;
+        while (!(queued && preempted(queued)) && (i = next.fetch_add(1)) < num_tasks) {
+            ran = true;
+            try {
+                (*fn)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+            }
+            if (remaining.fetch_sub(1) == 1 && caller_parked.load()) {
+                futex_wake(&remaining, 1);
+            }
+        }
+        if (ran) busy_ns->fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+        tls_in_parallel = was_parallel;
+        tls_priority = was_priority;
+    }
+
+    bool preempted(const std::atomic<size_t>* queued) const {
+        for (size_t p = 0; p < priority_index(priority); ++p) {
+            if (queued[p].load(std::memory_order_relaxed) > 0) return true;
+        }
+        return false;
+    }
+
+    void wait(int64_t spin_ns) {
+        if (spin_until([this] { return remaining.load(std::memory_order_acquire) == 0; }, spin_ns)) {
+            return;
+        }
+        caller_parked.store(true);
+        for (uint32_t left; (left = remaining.load()) != 0;) futex_wait(&remaining, left);
+    }
+
+    // A helper leaves drain() just after the last task it ran; the job must
+    // outlive that
+    void wait_for_helpers() const {
+        for (uint32_t i = 1; helpers_active.load(std::memory_order_acquire) != 0; ++i) {
+            if (i % 64 == 0) {
+                std::this_thread::yield();
+            } else {
+                cpu_relax();
+            }
+        }
+    }
+};
+
+// ========================================
+// Priority scopes
+// ========================================
+PriorityScope::PriorityScope(TaskPriority priority) : previous_(tls_priority) {
+    tls_priority = priority;
+}
+
+PriorityScope::~PriorityScope() {
+    tls_priority = previous_;
+}
+
+TaskPriority current_task_priority() {
+    return tls_priority;
+}
+
+// ========================================
+// ThreadPool: construction / teardown
+// ========================================
+ThreadPool::ThreadPool(size_t num_threads, size_t reserved_workers)
+    : num_threads_(num_threads > 0 ? num_threads : 1),
+      reserved_(std::min(reserved_workers, num_threads_ - 1)),
+      created_(std::chrono::steady_clock::now()) {
+    // Spinning only pays when every pool thread can have a core of its own
+    const bool oversubscribed = num_threads_ > std::max(1u, std::thread::hardware_concurrency());
+    spin_ns_.store(oversubscribed ? 0 : IdlePolicy().spin.count());
+}
+
+void ThreadPool::start() {
+    std::call_once(start_once_, [this] {
+        workers_.reserve(num_threads_ - 1);
+        for (size_t i = 0; i + 1 < num_threads_; ++i) {
+            workers_.emplace_back([this, i] { worker_loop(i); });
+        }
+        started_.store(true, std::memory_order_release);
+    });
+}
+
+ThreadPool::~ThreadPool() {
+    stop_.store(true);
+    wake_workers();
+    for (auto& w : workers_) w.join();
+}
+
+void ThreadPool::set_reserved_workers(size_t n) {
+    reserved_.store(std::min(n, num_threads_ - 1), std::memory_order_relaxed);
+    wake_workers();
+}
+
+void ThreadPool::set_idle_policy(const IdlePolicy& policy) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cpus_ = policy.cpus;
+    }
+    spin_ns_.store(policy.spin.count());
+    poll_.store(policy.poll);
+    wake_workers(); // parked workers pick up the new policy
+}
+
+IdlePolicy ThreadPool::idle_policy() const {
+    IdlePolicy p;
+    p.spin = std::chrono::nanoseconds(spin_ns_.load());
+    p.poll = poll_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    p.cpus = cpus_;
+    return p;
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+    Stats s;
+    s.jobs = jobs_.load(std::memory_order_relaxed);
+    s.tasks = tasks_.load(std::memory_order_relaxed);
+    for (const auto& q : queued_) s.queued += q.load(std::memory_order_relaxed);
+    s.busy_ns = busy_ns_.load(std::memory_order_relaxed);
+    s.uptime_ns = elapsed_ns(created_);
+    if (s.uptime_ns > 0) {
+        s.utilization = static_cast<double>(s.busy_ns) /
+                        (static_cast<double>(s.uptime_ns) * static_cast<double>(num_threads_));
+    }
+    return s;
+}
+
+// ========================================
+// ThreadPool: workers
+// ========================================
+// Workers [0, reserved) serve High work only
+bool ThreadPool::has_task_for(size_t index) const {
+    const size_t last = index < reserved_.load(std::memory_order_relaxed) ? 1 : kNumPriorities;
+    for (size_t p = 0; p < last; ++p) {
+        if (queued_[p].load() > 0) return true;
+    }
+    return false;
+}
+
+void ThreadPool::wake_workers() {
+    wake_seq_.fetch_add(1);
+    if (sleepers_.load() > 0) futex_wake(&wake_seq_, INT_MAX);
+}
+
+// Returns false once the pool is stopping
+bool ThreadPool::wait_for_work(size_t index) {
+    for (;;) {
+        const auto ready = [&] { return stop_.load(std::memory_order_relaxed) || has_task_for(index); };
+        const int64_t spin = poll_.load(std::memory_order_relaxed) ? -1 : spin_ns_.load(std::memory_order_relaxed);
+        if (spin_until(ready, spin)) return !stop_.load();
+
+        // Park. Registering as a sleeper before the final check pairs with
+        // submitters bumping wake_seq_ before reading sleepers_.
+        const uint32_t seq = wake_seq_.load();
+        sleepers_.fetch_add(1);
+        if (!ready()) futex_wait(&wake_seq_, seq);
+        sleepers_.fetch_sub(1);
+    }
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!cpus_.empty()) pin_current_thread(cpus_[index % cpus_.size()]);
+    }
+    while (wait_for_work(index)) {
+        Job* job = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const size_t last = index < reserved_.load(std::memory_order_relaxed) ? 1 : kNumPriorities;
+            for (size_t p = 0; p < last; ++p) {
+                JobQueue& queue = queues_[p];
+                if (!queue.head) continue;
+                job = queue.head;
+                job->helpers_active.fetch_add(1);
+                if (--job->helpers_waiting == 0) {
+                    queue.head = job->next_queued;
+                    if (!queue.head) queue.tail = nullptr;
+                }
+                queued_[p].fetch_sub(1);
+                break;
+            }
+        }
+        if (!job) continue; // another worker may have taken it first
+        job->drain(queued_);
+        job->helpers_active.fetch_sub(1, std::memory_order_release); // last use of the job
+    }
+}
+
+// ========================================
+// ThreadPool: fork/join execution
+// ========================================
+void ThreadPool::run(size_t num_tasks, const std::function<void(size_t)>& fn, size_t max_helpers) {
+    if (num_tasks == 0) return;
+    jobs_.fetch_add(1, std::memory_order_relaxed);
+    tasks_.fetch_add(num_tasks, std::memory_order_relaxed);
+
+    // Nested parallelism and single tasks run inline on the caller. Nested
+    // calls are already counted as busy time by the enclosing task.
+    if (num_tasks == 1 || num_threads_ == 1 || max_helpers == 0 || tls_in_parallel) {
+        const bool was_parallel = tls_in_parallel;
+        const auto start = std::chrono::steady_clock::now();
+        tls_in_parallel = true;
+        try {
+            for (size_t i = 0; i < num_tasks; ++i) fn(i);
+        } catch (...) {
+            tls_in_parallel = was_parallel;
+            if (!was_parallel) busy_ns_.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+            throw;
+        }
+        tls_in_parallel = was_parallel;
+        if (!was_parallel) busy_ns_.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+        return;
+    }
+    if (num_tasks > UINT32_MAX) {
+        throw std::invalid_argument("ThreadPool::run supports at most 2^32 - 1 tasks.");
+    }
+
+    start();
+    Job job;
+    job.fn = &fn;
+    job.num_tasks = static_cast<uint32_t>(num_tasks);
+    job.remaining.store(job.num_tasks);
+    job.priority = tls_priority;
+    job.busy_ns = &busy_ns_;
+
+    const size_t p = priority_index(job.priority);
+    const size_t helpers = std::min({workers_.size(), num_tasks - 1, max_helpers});
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job.helpers_waiting = helpers;
+        JobQueue& queue = queues_[p];
+        if (queue.tail) {
+            queue.tail->next_queued = &job;
+        } else {
+            queue.head = &job;
+        }
+        queue.tail = &job;
+        queued_[p].fetch_add(helpers);
+    }
+    wake_workers();
+
+    job.drain(nullptr);
+    job.wait(poll_.load(std::memory_order_relaxed) ? -1 : spin_ns_.load(std::memory_order_relaxed));
+
+    // Helpers no worker picked up would only find the job done; drop them
+    // so they neither count as queued nor preempt lower priority work
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (job.helpers_waiting > 0) {
+            JobQueue& queue = queues_[p];
+            Job* prev = nullptr;
+            for (Job* j = queue.head; j != &job; j = j->next_queued) prev = j;
+            (prev ? prev->next_queued : queue.head) = job.next_queued;
+            if (queue.tail == &job) queue.tail = prev;
+            queued_[p].fetch_sub(job.helpers_waiting);
+            job.helpers_waiting = 0;
+        }
+    }
+    job.wait_for_helpers();
+    if (job.error) std::rethrow_exception(job.error);
+}
+
+bool ThreadPool::in_parallel_region() {
+    return tls_in_parallel;
+}
+
+ThreadPool& default_thread_pool() {
+    static ThreadPool pool(thread_budget(), [] {
+        const char* reserved = std::getenv("TENSOR_LATENCY_WORKERS");
+        return reserved ? std::strtoul(reserved, nullptr, 10) : 0;
+    }());
+    static std::once_flag configure;
+    std::call_once(configure, [] {
+        IdlePolicy policy = pool.idle_policy();
+        if (const char* spin = std::getenv("TENSOR_POOL_SPIN_US")) {
+            policy.spin = std::chrono::microseconds(std::strtol(spin, nullptr, 10));
+        }
+        if (const char* cpus = std::getenv("TENSOR_POOL_CPUS")) {
+            policy.cpus = parse_cpu_list(cpus);
+            policy.poll = !policy.cpus.empty();
+        }
+        pool.set_idle_policy(policy);
+    });
+    return pool;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+// =============================
+// Thread Pool
+// =============================
+
+// Scheduling class of pool work. High is for latency-critical requests,
+// Low for background batch jobs.
+enum class TaskPriority { High = 0, Normal = 1, Low = 2 };
+
+// Sets the priority of the pool work started by the calling thread for
+// the lifetime of the scope (default Normal)
+class PriorityScope {
+public:
+    explicit PriorityScope(TaskPriority priority);
+    ~PriorityScope();
+
+    PriorityScope(const PriorityScope&) = delete;
+    PriorityScope& operator=(const PriorityScope&) = delete;
+
+private:
+    TaskPriority previous_;
+};
+
+TaskPriority current_task_priority();
+
+// How idle workers wait for work. A worker busy-spins for `spin` after
+// running out of work, so back-to-back parallel kernels are picked up
+// without a wake-up, then parks on a futex. `poll` never parks: combined
+// with `cpus` (workers pinned round-robin to these CPUs, ideally isolated
+// ones) it gives the lowest dispatch latency at the cost of burning the
+// cores.
+//
+// TENSOR_POOL_SPIN_US overrides the default spin window.
+struct IdlePolicy {
+    std::chrono::nanoseconds spin = std::chrono::microseconds(50);
+    bool poll = false;
+    std::vector<int> cpus;
+};
+
+// Fixed-size pool of worker threads used by the parallel CPU kernels.
+// The calling thread always takes part in the work, so a pool of size N
+// runs N-1 background workers. Workers are spawned on the first run()
+// that can use them (or by start()), so short-lived processes that never
+// run parallel work never pay for thread creation.
+//
+// Queued work is served in priority order. Between tasks, a worker helping
+// with a job checks whether work of a higher class is waiting and, if so,
+// leaves the job to its caller and the other helpers. Low work thus only
+// occupies workers that would otherwise be idle. Some workers can also be
+// reserved for High work alone.
+class ThreadPool {
+public:
+    // Busy time is summed over every thread while it runs tasks, so
+    // utilization is the share of the pool's thread time spent working
+    // since it was created.
+    struct Stats {
+        size_t jobs = 0;   // run() calls
+        size_t tasks = 0;
+        size_t queued = 0; // helpers of unfinished run() calls waiting for a worker
+        uint64_t busy_ns = 0;
+        uint64_t uptime_ns = 0;
+        double utilization = 0.0;
+    };
+
+    // `reserved_workers` workers serve High priority work only
+    explicit ThreadPool(size_t num_threads, size_t reserved_workers = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads that execute work (workers + caller)
+    size_t size() const { return num_threads_; }
+
+    // Spawns the workers now instead of on first use
+    void start();
+    bool started() const { return started_.load(std::memory_order_acquire); }
+
+    // Runs fn(0) .. fn(num_tasks - 1) across the pool and blocks until all
+    // tasks are done. The first exception thrown by a task is rethrown here.
+    // At most `max_helpers` workers join the caller. Submitting does not
+    // allocate.
+    void run(size_t num_tasks, const std::function<void(size_t)>& fn,
+             size_t max_helpers = SIZE_MAX);
+
+    // True when called from inside a task of any pool
+    static bool in_parallel_region();
+
+    // Reserves `n` workers (capped at size() - 1) for High priority work
+    void set_reserved_workers(size_t n);
+    size_t reserved_workers() const { return reserved_.load(std::memory_order_relaxed); }
+
+    // Spin and poll settings apply immediately; pinning applies to workers
+    // started afterwards
+    void set_idle_policy(const IdlePolicy& policy);
+    IdlePolicy idle_policy() const;
+
+    Stats stats() const;
+
+private:
+    void worker_loop(size_t index);
+    bool has_task_for(size_t index) const;
+    bool wait_for_work(size_t index);
+    void wake_workers();
+
+    static constexpr size_t kNumPriorities = 3;
+
+    const size_t num_threads_;
+    std::once_flag start_once_;
+    std::atomic<bool> started_{false};
+    std::vector<std::thread> workers_;
+    // Shared state of one run() call, on the caller's stack
+    struct Job;
+
+    // run() calls still waiting for helpers, oldest first. Jobs link
+    // themselves in, so submitting work does not allocate.
+    struct JobQueue {
+        Job* head = nullptr;
+        Job* tail = nullptr;
+    };
+
+    JobQueue queues_[kNumPriorities];
+    std::atomic<size_t> queued_[kNumPriorities] = {}; // helpers waiting in queues_
+    std::atomic<size_t> reserved_{0};
+    mutable std::mutex mutex_;
+    std::atomic<bool> stop_{false};
+
+    // Idle workers park on wake_seq_, which every submission bumps
+    std::atomic<uint32_t> wake_seq_{0};
+    std::atomic<uint32_t> sleepers_{0};
+    std::atomic<int64_t> spin_ns_;
+    std::atomic<bool> poll_{false};
+    std::vector<int> cpus_;
+
+    const std::chrono::steady_clock::time_point created_;
+    std::atomic<size_t> jobs_{0};
+    std::atomic<size_t> tasks_{0};
+    std::atomic<uint64_t> busy_ns_{0};
+};
+
+// Process-wide pool, created on first use with thread_budget() threads and
+// TENSOR_LATENCY_WORKERS workers reserved for High priority work.
+// TENSOR_POOL_SPIN_US sets the spin window; TENSOR_POOL_CPUS (a list such
+// as "2-5,8") pins the workers there in polling mode.
+ThreadPool& default_thread_pool();
@@ -0,0 +1,320 @@
+#include "topology.h"
+#include "cancellation.h"
+#include "named_pools.h"
+#include "parallel.h"
+#include "thread_budget.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <sched.h>
+
+namespace {
+
+// ========================================
+// Helper: sysfs parsing
+// ========================================
+const char* const kCpuRoot = "/sys/devices/system/cpu/";
+const char* const kNodeRoot = "/sys/devices/system/node/";
+
+// First line of a sysfs attribute, or "" when it does not exist
+std::string read_attribute(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// Lowest CPU of a sysfs CPU list attribute, or `fallback`
+int first_cpu_of(const std::string& path, int fallback) {
+    const std::vector<int> cpus = parse_cpu_list(read_attribute(path));
+    return cpus.empty() ? fallback : *std::min_element(cpus.begin(), cpus.end());
+}
+
+std::vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    if (cpus.empty()) {
+        const int n = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int c = 0; c < n; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// L3 domain of a CPU: the cache index of level 3, else its package
+int l3_domain_of(int cpu) {
+    const std::string base = kCpuRoot + ("cpu" + std::to_string(cpu)) + "/";
+    for (int index = 0; index < 8; ++index) {
+        const std::string cache = base + "cache/index" + std::to_string(index) + "/";
+        const std::string level = read_attribute(cache + "level");
+        if (level.empty()) break;
+        if (level == "3") return first_cpu_of(cache + "shared_cpu_list", cpu);
+    }
+    return first_cpu_of(base + "topology/core_siblings_list", cpu);
+}
+
+// cpu -> node from each node's cpulist
+std::map<int, int> node_of_cpus() {
+    std::map<int, int> nodes;
+    const std::vector<int> online = parse_cpu_list(read_attribute(std::string(kNodeRoot) + "online"));
+    for (int node : online) {
+        const std::string list = read_attribute(kNodeRoot + ("node" + std::to_string(node)) + "/cpulist");
+        for (int cpu : parse_cpu_list(list)) nodes[cpu] = node;
+    }
+    return nodes;
+}
+
+CpuTopology discover_topology() {
+    CpuTopology topo;
+    const std::map<int, int> nodes = node_of_cpus();
+    for (int cpu : allowed_cpus()) {
+        CpuInfo info;
+        info.cpu = cpu;
+        const std::string base = kCpuRoot + ("cpu" + std::to_string(cpu)) + "/";
+        info.core = first_cpu_of(base + "topology/thread_siblings_list", cpu);
+        info.l3 = l3_domain_of(cpu);
+        const auto node = nodes.find(cpu);
+        info.node = node != nodes.end() ? node->second : 0;
+        topo.cpus.push_back(info);
+    }
+    std::sort(topo.cpus.begin(), topo.cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        return std::tie(a.node, a.l3, a.core, a.cpu) < std::tie(b.node, b.l3, b.core, b.cpu);
+    });
+
+    std::set<int> cores, l3s, node_ids;
+    for (const CpuInfo& c : topo.cpus) {
+        cores.insert(c.core);
+        l3s.insert(c.l3);
+        node_ids.insert(c.node);
+    }
+    topo.num_cores = static_cast<int>(cores.size());
+    topo.num_l3_domains = static_cast<int>(l3s.size());
+    topo.num_nodes = static_cast<int>(node_ids.size());
+    return topo;
+}
+
+// ========================================
+// Helper: Physical core slots
+// ========================================
+// One entry per physical core in topology order, plus the slot of every
+// CPU (hyperthread siblings map to their core's slot)
+struct CoreSlots {
+    std::vector<CpuInfo> cores;
+    std::vector<int> slot_of_cpu;
+
+    int slot_for(int cpu) const {
+        return cpu >= 0 && cpu < static_cast<int>(slot_of_cpu.size()) ? slot_of_cpu[cpu] : -1;
+    }
+};
+
+const CoreSlots& core_slots() {
+    static const CoreSlots slots = [] {
+        CoreSlots s;
+        const CpuTopology& topo = cpu_topology();
+        std::map<int, int> slot_of_core;
+        int max_cpu = 0;
+        for (const CpuInfo& c : topo.cpus) {
+            if (slot_of_core.emplace(c.core, static_cast<int>(s.cores.size())).second) {
+                s.cores.push_back(c);
+            }
+            max_cpu = std::max(max_cpu, c.cpu);
+        }
+        s.slot_of_cpu.assign(max_cpu + 1, -1);
+        for (const CpuInfo& c : topo.cpus) s.slot_of_cpu[c.cpu] = slot_of_core[c.core];
+        return s;
+    }();
+    return slots;
+}
+
+// Claim flags of a parallel_for_tiles call, one bit per core slot, kept
+// on the caller's stack
+constexpr size_t kClaimWords = (CPU_SETSIZE + 63) / 64;
+using ClaimSet = std::atomic<uint64_t>[kClaimWords];
+
+// Claims the unclaimed range nearest to `home`: outward within the same L3
+// domain, then the same node, then anywhere. Returns -1 when none is left.
+int claim_range(ClaimSet& claimed, int home) {
+    const std::vector<CpuInfo>& cores = core_slots().cores;
+    const int n = static_cast<int>(cores.size());
+    const auto try_claim = [&](int i) {
+        const uint64_t bit = uint64_t(1) << (i % 64);
+        return !(claimed[i / 64].load(std::memory_order_relaxed) & bit) &&
+               !(claimed[i / 64].fetch_or(bit) & bit);
+    };
+    if (home >= 0 && try_claim(home)) return home;
+    if (home < 0) home = 0;
+
+    const CpuInfo& own = cores[home];
+    const auto same_l3 = [&](int i) { return cores[i].l3 == own.l3; };
+    const auto same_node = [&](int i) { return cores[i].node == own.node; };
+    const auto anywhere = [](int) { return true; };
+    const auto scan = [&](const auto& near) {
+        for (int d = 0; d < n; ++d) {
+            for (int i : {home + d, home - d - 1}) {
+                if (i >= 0 && i < n && near(i) && try_claim(i)) return i;
+            }
+        }
+        return -1;
+    };
+    int i = scan(same_l3);
+    if (i < 0) i = scan(same_node);
+    if (i < 0) i = scan(anywhere);
+    return i;
+}
+
+// Range `i` of partition_tiles(num_tiles), without building the list
+TileRange tile_range(int64_t num_tiles, int64_t i) {
+    const std::vector<CpuInfo>& cores = core_slots().cores;
+    const int64_t n = static_cast<int64_t>(cores.size());
+    const int64_t base = std::max<int64_t>(num_tiles, 0) / n;
+    const int64_t extra = std::max<int64_t>(num_tiles, 0) % n;
+    TileRange r;
+    r.cpu = cores[i].cpu;
+    r.l3 = cores[i].l3;
+    r.node = cores[i].node;
+    r.begin = i * base + std::min(i, extra);
+    r.end = r.begin + base + (i < extra ? 1 : 0);
+    return r;
+}
+
+} // namespace
+
+// ========================================
+// Topology discovery
+// ========================================
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        const std::string item = list.substr(pos, end - pos);
+        if (!item.empty()) {
+            const size_t dash = item.find('-');
+            const int first = std::atoi(item.c_str());
+            const int last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+            for (int c = first; c <= last; ++c) cpus.push_back(c);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+const CpuTopology& cpu_topology() {
+    static const CpuTopology topo = discover_topology();
+    return topo;
+}
+
+std::vector<int> CpuTopology::one_per_core() const {
+    std::vector<int> out;
+    std::set<int> seen;
+    for (const CpuInfo& c : cpus) {
+        if (seen.insert(c.core).second) out.push_back(c.cpu);
+    }
+    return out;
+}
+
+// ========================================
+// Topology-aware tiling
+// ========================================
+std::vector<TileRange> partition_tiles(int64_t num_tiles) {
+    std::vector<TileRange> ranges(core_slots().cores.size());
+    for (size_t i = 0; i < ranges.size(); ++i) ranges[i] = tile_range(num_tiles, static_cast<int64_t>(i));
+    return ranges;
+}
+
+ThreadPool& core_thread_pool() {
+    static ThreadPool pool(core_slots().cores.size());
+    static std::once_flag configure;
+    std::call_once(configure, [] {
+        // Worker i gets core i + 1. Callers are not pinned; core 0 is left
+        // for them, though each takes the range of whatever core it runs on.
+        IdlePolicy policy = pool.idle_policy();
+        policy.cpus.clear();
+        const std::vector<CpuInfo>& cores = core_slots().cores;
+        for (size_t i = 1; i < cores.size(); ++i) policy.cpus.push_back(cores[i].cpu);
+        pool.set_idle_policy(policy);
+    });
+    return pool;
+}
+
+void parallel_for_tiles(int64_t num_tiles, const std::function<void(int64_t, int64_t)>& fn) {
+    if (num_tiles <= 0) return;
+    // A PoolScope's pool owns its CPUs; parallel_for already runs there
+    if (in_pool_scope()) {
+        parallel_for(0, num_tiles, 1, fn);
+        return;
+    }
+    // Ranges are computed on the fly rather than listed, so a call does not
+    // allocate
+    const size_t num_ranges = core_slots().cores.size();
+    const size_t busy = static_cast<size_t>(std::min<int64_t>(num_tiles, static_cast<int64_t>(num_ranges)));
+    if (busy == 1 || ThreadPool::in_parallel_region() || in_external_parallel_region()) {
+        for (size_t i = 0; i < busy; ++i) {
+            throw_if_cancelled();
+            const TileRange r = tile_range(num_tiles, static_cast<int64_t>(i));
+            fn(r.begin, r.end);
+        }
+        return;
+    }
+
+    ThreadPool& pool = core_thread_pool();
+    size_t wanted = std::min(busy, pool.size());
+    if (size_t limit = parallelism_limit()) wanted = std::min(wanted, limit);
+    const bool budgeted = current_task_priority() != TaskPriority::High;
+    const size_t granted = budgeted ? acquire_threads(wanted) : wanted;
+
+    // Ranges past `busy` are empty and start out claimed
+    ClaimSet claimed;
+    for (size_t w = 0; w < kClaimWords; ++w) {
+        uint64_t bits = 0;
+        for (size_t b = 0; b < 64; ++b) {
+            if (w * 64 + b >= busy) bits |= uint64_t(1) << b;
+        }
+        claimed[w].store(bits, std::memory_order_relaxed);
+    }
+    // One reference, so the task fits in std::function's inline storage
+    const struct {
+        int64_t num_tiles;
+        ClaimSet& claimed;
+        std::shared_ptr<const CancellationScope::Chain> cancel_chain;
+        const std::function<void(int64_t, int64_t)>& fn;
+    } call{num_tiles, claimed, CancellationScope::current(), fn};
+
+    const auto task = [&call](size_t) {
+        NestedRuntimeScope nested;
+        const int home = core_slots().slot_for(::sched_getcpu());
+        const auto run_ranges = [&] {
+            for (int i; (i = claim_range(call.claimed, home)) >= 0;) {
+                throw_if_cancelled();
+                const TileRange r = tile_range(call.num_tiles, i);
+                call.fn(r.begin, r.end);
+            }
+        };
+        if (call.cancel_chain) {
+            CancellationScope inherited(call.cancel_chain);
+            run_ranges();
+        } else {
+            run_ranges();
+        }
+    };
+    try {
+        pool.run(granted, task);
+    } catch (...) {
+        if (budgeted) release_threads(granted);
+        throw;
+    }
+    if (budgeted) release_threads(granted);
+}
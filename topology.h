@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// =============================
+// CPU Topology
+// =============================
+
+// One logical CPU the process may run on. Cores and L3 domains are
+// identified by the lowest CPU number they contain, nodes by NUMA node id.
+struct CpuInfo {
+    int cpu = 0;
+    int core = 0;  // physical core (hyperthread siblings share it)
+    int l3 = 0;    // last-level cache domain (CCX on chiplet parts)
+    int node = 0;  // NUMA node
+};
+
+struct CpuTopology {
+    std::vector<CpuInfo> cpus; // sorted by node, then L3 domain, then core
+    int num_cores = 0;
+    int num_l3_domains = 0;
+    int num_nodes = 0;
+
+    // One CPU per physical core, in the same node / L3 / core order
+    std::vector<int> one_per_core() const;
+};
+
+// Topology of the CPUs in the process's affinity mask, read from sysfs
+// once. Without sysfs every CPU is its own core in a single domain.
+const CpuTopology& cpu_topology();
+
+// Parses a kernel CPU list such as "0-3,8,10-11"
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// =============================
+// Topology-aware tiling
+// =============================
+
+// Range of tiles assigned to one physical core
+struct TileRange {
+    int cpu = 0;
+    int l3 = 0;
+    int node = 0;
+    int64_t begin = 0;
+    int64_t end = 0;
+};
+
+// Splits [0, num_tiles) into one contiguous range per physical core.
+// Because cores are ordered node, then L3 domain, then core, each node and
+// each L3 domain receives one contiguous block of tiles in proportion to
+// its core count, so neighbouring tiles (which tend to share halos and
+// weights) stay on cores that share a cache.
+std::vector<TileRange> partition_tiles(int64_t num_tiles);
+
+// Pool with one thread per physical core, its workers pinned in topology
+// order (hyperthread siblings are left idle for SIMD-heavy kernels)
+ThreadPool& core_thread_pool();
+
+// Runs fn(begin, end) for each range of partition_tiles(num_tiles) on the
+// core pool. Each thread, the unpinned caller included, takes the range of
+// the core it runs on first and then helps with unclaimed ranges, nearest
+// (same L3, then same node) first.
+// Threads come out of thread_budget() like parallel_for's, and the
+// calling thread's ParallelismGuard applies. Inside a PoolScope the tiles
+// go to parallel_for on the scope's pool instead. Nested calls run inline.
+void parallel_for_tiles(int64_t num_tiles, const std::function<void(int64_t, int64_t)>& fn);
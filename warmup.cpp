@@ -0,0 +1,32 @@
+#include "warmup.h"
+#include "allocator.h"
+#include "copy_engine.h"
+#include "cpu_features.h"
+#include "isa_dispatch.h"
+#include "scratch_arena.h"
+#include "tensor_hash.h"
+#include "thread_pool.h"
+#include "topology.h"
+
+void warmup() {
+    // Dispatch decisions
+    cpu_features();
+    cpu_topology();
+    max_isa_level();
+    avx512_threshold_bytes();
+    copy_thresholds();
+    const uint8_t probe[64] = {};
+    crc32c(probe, sizeof(probe));
+
+    // Memory
+    TensorAllocator::instance();
+
+    // Threads, each with its first scratch block mapped. Tasks are claimed
+    // dynamically, so an arena is warmed on most, not necessarily all, workers.
+    ThreadPool& pool = default_thread_pool();
+    pool.start();
+    pool.run(pool.size(), [](size_t) {
+        ScratchScope scratch;
+        scratch.alloc<uint8_t>(1);
+    });
+}
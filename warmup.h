@@ -0,0 +1,12 @@
+#pragma once
+
+// =============================
+// Warmup
+// =============================
+
+// Everything in the library initializes lazily on first use: CPU feature
+// detection, ISA calibration, thread pool workers, scratch arenas and the
+// allocator. That keeps process start cheap but moves the cost onto the
+// first op. Latency-sensitive services call warmup() once at start-up to
+// pay it up front instead. Safe to call more than once.
+void warmup();
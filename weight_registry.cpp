@@ -0,0 +1,211 @@
+#include "weight_registry.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// ========================================
+// Helper: Epoch domain shared by all registries
+// ========================================
+// Each reading thread owns one slot holding the epoch it entered in, or 0
+// while it holds no snapshot. Slots live in blocks that are allocated on
+// demand and never freed, so the reclaimer can scan them without locking.
+constexpr size_t kSlotsPerBlock = 64;
+constexpr size_t kMaxBlocks = 1024;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> in_use{false};
+};
+
+struct EpochDomain {
+    std::atomic<uint64_t> epoch{1};
+    std::atomic<ReaderSlot*> blocks[kMaxBlocks] = {};
+    std::atomic<size_t> num_blocks{0};
+    std::mutex grow_mutex;
+
+    ReaderSlot* acquire_slot() {
+        for (;;) {
+            const size_t n = num_blocks.load(std::memory_order_acquire);
+            for (size_t b = 0; b < n; ++b) {
+                ReaderSlot* block = blocks[b].load(std::memory_order_acquire);
+                for (size_t i = 0; i < kSlotsPerBlock; ++i) {
+                    bool expected = false;
+                    if (!block[i].in_use.load(std::memory_order_relaxed) &&
+                        block[i].in_use.compare_exchange_strong(expected, true)) {
+                        return &block[i];
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(grow_mutex);
+            if (num_blocks.load() != n) continue; // another thread grew it
+            if (n == kMaxBlocks) {
+                throw std::runtime_error("WeightRegistry: too many concurrent reader threads.");
+            }
+            blocks[n].store(new ReaderSlot[kSlotsPerBlock], std::memory_order_release);
+            num_blocks.store(n + 1, std::memory_order_release);
+        }
+    }
+
+    // Lowest epoch a reader is in, or UINT64_MAX when none is reading
+    uint64_t min_reader_epoch() const {
+        uint64_t min = UINT64_MAX;
+        const size_t n = num_blocks.load(std::memory_order_acquire);
+        for (size_t b = 0; b < n; ++b) {
+            const ReaderSlot* block = blocks[b].load(std::memory_order_acquire);
+            for (size_t i = 0; i < kSlotsPerBlock; ++i) {
+                const uint64_t e = block[i].epoch.load();
+                if (e != 0) min = std::min(min, e);
+            }
+        }
+        return min;
+    }
+};
+
+// Never destroyed: reader threads may release their slot during exit
+EpochDomain& domain() {
+    static EpochDomain* d = new EpochDomain;
+    return *d;
+}
+
+struct ThreadReader {
+    ReaderSlot* slot = nullptr;
+    int depth = 0;
+
+    ~ThreadReader() {
+        if (slot) slot->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local ThreadReader tls_reader;
+
+// Only the outermost snapshot of a thread announces an epoch. The store
+// must be ordered before the reader loads the version pointer (seq_cst),
+// pairing with the writer's exchange and epoch increment.
+void enter_read() {
+    ThreadReader& r = tls_reader;
+    if (r.depth++ > 0) return;
+    if (!r.slot) {
+        try {
+            r.slot = domain().acquire_slot();
+        } catch (...) {
+            --r.depth;
+            throw;
+        }
+    }
+    r.slot->epoch.store(domain().epoch.load());
+}
+
+void exit_read() {
+    ThreadReader& r = tls_reader;
+    if (--r.depth == 0) r.slot->epoch.store(0, std::memory_order_release);
+}
+
+} // namespace
+
+// ========================================
+// Snapshot
+// ========================================
+WeightRegistry::Snapshot::Snapshot(Snapshot&& other) noexcept : version_(other.version_) {
+    other.version_ = nullptr;
+}
+
+WeightRegistry::Snapshot::~Snapshot() {
+    if (version_) exit_read();
+}
+
+const Tensor& WeightRegistry::Snapshot::at(const std::string& name) const {
+    const Tensor* t = find(name);
+    if (!t) throw std::out_of_range("Unknown weight '" + name + "'.");
+    return *t;
+}
+
+const Tensor* WeightRegistry::Snapshot::find(const std::string& name) const {
+    auto it = version_->weights.find(name);
+    return it == version_->weights.end() ? nullptr : &it->second;
+}
+
+// ========================================
+// WeightRegistry: readers
+// ========================================
+WeightRegistry::WeightRegistry(Weights initial)
+    : current_(new Version{0, std::move(initial)}) {}
+
+WeightRegistry::~WeightRegistry() {
+    for (const Retired& r : retired_) delete r.version;
+    delete current_.load();
+}
+
+WeightRegistry::Snapshot WeightRegistry::snapshot() const {
+    enter_read();
+    return Snapshot(current_.load());
+}
+
+// ========================================
+// WeightRegistry: writers
+// ========================================
+uint64_t WeightRegistry::publish(Weights weights) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return publish_locked(std::move(weights));
+}
+
+uint64_t WeightRegistry::update(const std::string& name, Tensor weight) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    // Only writers replace current_, so it is stable under the lock. Tensors
+    // share storage; only the handles are copied.
+    Weights weights = current_.load()->weights;
+    weights[name] = std::move(weight);
+    return publish_locked(std::move(weights));
+}
+
+uint64_t WeightRegistry::publish_locked(Weights weights) {
+    const uint64_t number = current_.load()->number + 1;
+    const Version* old = current_.exchange(new Version{number, std::move(weights)});
+    // Readers that announce a later epoch load the new pointer
+    const uint64_t epoch = domain().epoch.fetch_add(1);
+    retired_.push_back({old, epoch});
+    ++published_;
+    reclaim_locked();
+    return number;
+}
+
+size_t WeightRegistry::reclaim() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    return reclaim_locked();
+}
+
+size_t WeightRegistry::reclaim_locked() {
+    if (retired_.empty()) return 0;
+    // A version retired at epoch e is unreachable once every reader
+    // entered after e
+    const uint64_t min_epoch = domain().min_reader_epoch();
+    auto keep = std::partition(retired_.begin(), retired_.end(),
+                               [&](const Retired& r) { return r.epoch >= min_epoch; });
+    const size_t freed = static_cast<size_t>(retired_.end() - keep);
+    for (auto it = keep; it != retired_.end(); ++it) delete it->version;
+    retired_.erase(keep, retired_.end());
+    reclaimed_ += freed;
+    return freed;
+}
+
+void WeightRegistry::synchronize() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            reclaim_locked();
+            if (retired_.empty()) return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+WeightRegistry::Stats WeightRegistry::stats() const {
+    Stats s;
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    s.version = current_.load()->number;
+    s.published = published_;
+    s.retired = retired_.size();
+    s.reclaimed = reclaimed_;
+    return s;
+}
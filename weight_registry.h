@@ -0,0 +1,107 @@
+#pragma once
+
+#include "tensor.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// =============================
+// Weight Registry
+// =============================
+
+// Versioned set of named weights that can be replaced while inference is
+// running. Readers take a Snapshot without locking: they announce the
+// current epoch in a per-thread slot and load the current version pointer,
+// which costs two atomic operations. publish() installs a new version with
+// one atomic exchange and retires the old one. A retired version is
+// destroyed (dropping its references to tensor storage) only once every
+// reader that entered in an older epoch has released its snapshot. That
+// happens on the writer's side, so updates never stall requests.
+//
+// Tensors copied out of a snapshot keep their storage alive on their own
+// and stay valid after the snapshot is released.
+class WeightRegistry {
+public:
+    using Weights = std::unordered_map<std::string, Tensor>;
+
+    struct Version {
+        uint64_t number = 0;
+        Weights weights;
+    };
+
+    // Read guard pinning one version. Snapshots on the same thread nest
+    // and must be released in reverse order; do not hand them to another
+    // thread.
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot();
+
+        const Version& version() const { return *version_; }
+        uint64_t number() const { return version_->number; }
+
+        // Throws std::out_of_range for unknown names
+        const Tensor& at(const std::string& name) const;
+        // nullptr for unknown names
+        const Tensor* find(const std::string& name) const;
+
+    private:
+        friend class WeightRegistry;
+        explicit Snapshot(const Version* version) : version_(version) {}
+
+        const Version* version_;
+    };
+
+    struct Stats {
+        uint64_t version = 0;   // number of the current version
+        size_t published = 0;
+        size_t retired = 0;     // old versions still waiting for readers
+        size_t reclaimed = 0;
+    };
+
+    explicit WeightRegistry(Weights initial = {});
+    // No snapshot of this registry may be alive
+    ~WeightRegistry();
+
+    WeightRegistry(const WeightRegistry&) = delete;
+    WeightRegistry& operator=(const WeightRegistry&) = delete;
+
+    Snapshot snapshot() const;
+
+    // Installs a new version and returns its number. Old versions no
+    // reader can still see are destroyed before returning.
+    uint64_t publish(Weights weights);
+
+    // Publishes the current weights with one tensor added or replaced
+    uint64_t update(const std::string& name, Tensor weight);
+
+    // Destroys retired versions no reader can still see; returns how many
+    size_t reclaim();
+
+    // Blocks until every retired version has been destroyed, i.e. until
+    // the readers of older versions are done. Never call it while holding a
+    // snapshot.
+    void synchronize();
+
+    Stats stats() const;
+
+private:
+    struct Retired {
+        const Version* version;
+        uint64_t epoch;
+    };
+
+    // Caller holds write_mutex_
+    uint64_t publish_locked(Weights weights);
+    size_t reclaim_locked();
+
+    std::atomic<const Version*> current_;
+    mutable std::mutex write_mutex_;
+    std::vector<Retired> retired_;
+    size_t published_ = 0;
+    size_t reclaimed_ = 0;
+};